@@ -8,14 +8,16 @@ out vec3 normal;
 out vec2 uv0;
 
 uniform mat4 u_model = mat4(1.0);
-uniform mat4 u_viewProjection = mat4(1.0);
+
+#include "globals.glsl"
+#include "vertex_decode.glsl"
 
 void main()
 {
-    normal = attribNormal;
+    normal = decodeDirection(attribNormal);
     uv0 = attribUV0;
 
     mat4 mvp = u_viewProjection * u_model;
 
-    gl_Position = mvp * vec4(attribPosition, 1.0);
+    gl_Position = mvp * vec4(decodePosition(attribPosition), 1.0);
 }
@@ -8,8 +8,7 @@ uniform vec4 u_gridColorBackground = vec4(0.8, 0.0, 0.5, 1.0);
 uniform vec4 u_gridColorForeground = vec4(1.0, 0.2, 1.0, 1.0);
 uniform float u_gridSize = 100.0;
 
-uniform vec2 u_resolution;
-
+#include "globals.glsl"
 #include "checkerboard.glsl"
 
 void main()
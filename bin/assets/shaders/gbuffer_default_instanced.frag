@@ -0,0 +1,11 @@
+#version 330
+
+flat in vec4 instanceTint;
+flat in vec2 instanceSurface;
+
+#include "gbuffer_fragment.glsl"
+
+void main()
+{
+    writeGBuffer(instanceTint, instanceSurface.x, instanceSurface.y);
+}
@@ -0,0 +1,22 @@
+#version 330
+
+// @NOTE - per instance attributes, layout has to match RenderQueueInstanceData
+layout(location = 4) in mat4 attribInstanceModel;
+layout(location = 8) in vec4 attribInstanceTint;
+layout(location = 9) in vec4 attribInstanceSurface;
+layout(location = 10) in vec4 attribInstancePositionOffset;
+layout(location = 11) in vec4 attribInstancePositionScale;
+
+flat out vec4 instanceTint;
+flat out vec2 instanceSurface;
+
+#include "gbuffer_vertex.glsl"
+
+void main()
+{
+    instanceTint = attribInstanceTint;
+    instanceSurface = attribInstanceSurface.xy;
+
+    writeVertex(attribInstanceModel, attribInstancePositionOffset.xyz, attribInstancePositionScale.xyz,
+                attribInstancePositionOffset.w > 0.5);
+}
@@ -0,0 +1,74 @@
+in vec3 normal;
+in vec3 tangent;
+in vec2 uv0;
+in mat3 tbn;
+
+layout (location = 0) out vec4 albedoBuffer;
+layout (location = 1) out vec4 normalBuffer;
+layout (location = 2) out vec4 surfaceBuffer;
+
+// @NOTE - filled by OpenGLMaterial from reflected offsets, block is bound to UniformBlockBinding::materialData by OpenGLProgram
+// members can't have initializers, defaults are set by the material
+layout(std140) uniform MaterialData
+{
+    vec4 u_tint;
+    float u_roughness;
+    float u_metallic;
+};
+
+// @NOTE - HAS_* defines are injected by ProgramLoader, material picks the variant matching its textures (see ShaderFeature)
+#ifdef HAS_BASE_COLOR_MAP
+uniform sampler2D u_baseColor;
+#endif
+
+#ifdef HAS_NORMAL_MAP
+uniform sampler2D u_normalMap;
+#endif
+
+#ifdef HAS_ROUGHNESS_MAP
+uniform sampler2D u_roughnessMap;
+#endif
+
+#ifdef HAS_METALLIC_MAP
+uniform sampler2D u_metallicMap;
+#endif
+
+// @NOTE - it comes directly from gltf loader, green channel contains roughness and blue channel contains metalness
+#ifdef HAS_ROUGHNESS_METALLIC_MAP
+uniform sampler2D u_roughnessMetallicMap;
+#endif
+
+void writeGBuffer(vec4 tint, float roughnessValue, float metallicValue)
+{
+    vec4 albedo = tint;
+#ifdef HAS_BASE_COLOR_MAP
+    albedo *= texture2D(u_baseColor, uv0);
+#endif
+
+    vec3 surfaceNormal = normal;
+#ifdef HAS_NORMAL_MAP
+    vec3 normalMapValue = normalize(texture2D(u_normalMap, uv0).xyz * 2.0 - 1.0);
+    surfaceNormal = normalize(tbn * normalMapValue);
+#endif
+
+    float roughness = roughnessValue;
+    float metallic = metallicValue;
+
+#ifdef HAS_ROUGHNESS_METALLIC_MAP
+    vec3 roughnessMetallic = texture2D(u_roughnessMetallicMap, uv0).rgb;
+    roughness = roughnessMetallic.g;
+    metallic = roughnessMetallic.b;
+#else
+#ifdef HAS_ROUGHNESS_MAP
+    roughness = texture2D(u_roughnessMap, uv0).r;
+#endif
+
+#ifdef HAS_METALLIC_MAP
+    metallic = texture2D(u_metallicMap, uv0).r;
+#endif
+#endif
+
+    albedoBuffer = albedo;
+    normalBuffer = vec4(surfaceNormal * 0.5 + 0.5, 1.0);
+    surfaceBuffer = vec4(roughness, metallic, 0, 0);
+}
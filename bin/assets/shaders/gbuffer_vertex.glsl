@@ -0,0 +1,29 @@
+layout(location = 0) in vec3 attribPosition;
+layout(location = 1) in vec3 attribNormal;
+layout(location = 2) in vec3 attribTangent;
+layout(location = 3) in vec2 attribUV0;
+
+out vec3 normal;
+out vec3 tangent;
+out vec2 uv0;
+out mat3 tbn;
+
+#include "globals.glsl"
+#include "vertex_decode.glsl"
+
+void writeVertex(mat4 model, vec3 positionOffset, vec3 positionScale, bool octahedralNormals)
+{
+    mat3 model3 = mat3(model);
+
+    normal = normalize(model3 * decodeDirection(attribNormal, octahedralNormals));
+    tangent = normalize(model3 * decodeDirection(attribTangent, octahedralNormals));
+    tangent = normalize(tangent - dot(tangent, normal) * normal);
+
+    vec3 bitangent = normalize(cross(tangent, normal));
+    tbn = mat3(tangent, bitangent, normal);
+
+    uv0 = attribUV0;
+
+    mat4 mvp = u_viewProjection * model;
+    gl_Position = mvp * vec4(decodePosition(attribPosition, positionOffset, positionScale), 1.0);
+}
@@ -6,12 +6,14 @@ layout (location = 1) in vec3 attribNormal;
 out vec3 normal;
 
 uniform mat4 u_model = mat4(1.0);
-uniform mat4 u_viewProjection = mat4(1.0);
+
+#include "globals.glsl"
+#include "vertex_decode.glsl"
 
 void main()
 {
-    normal = normalize(vec3(u_model * vec4(attribNormal, 0.0)));
+    normal = normalize(vec3(u_model * vec4(decodeDirection(attribNormal), 0.0)));
 
     mat4 mvp = u_viewProjection * u_model;
-    gl_Position = mvp * vec4(attribPosition, 1.0);
+    gl_Position = mvp * vec4(decodePosition(attribPosition), 1.0);
 }
@@ -1,2 +1,16 @@
-uniform vec2 u_resolution;
-uniform mat4 u_viewProjection = mat4(1.0);
\ No newline at end of file
+// @NOTE - layout has to match OpenGLFrameData, block is bound to UniformBlockBinding::frameData by OpenGLProgram
+layout(std140) uniform FrameData
+{
+    mat4 u_view;
+    mat4 u_projection;
+    mat4 u_viewProjection;
+
+    mat4 u_viewInv;
+    mat4 u_projectionInv;
+    mat4 u_viewProjectionInv;
+
+    vec3 u_cameraPosition;
+    vec3 u_cameraDirection;
+
+    vec2 u_resolution;
+};
@@ -11,9 +11,7 @@ uniform sampler2D u_surface;
 uniform sampler2D u_depth;
 uniform samplerCube u_irradiance;
 
-uniform vec3 u_cameraPosition;
-uniform mat4 u_viewProjectionInv;
-
+#include "globals.glsl"
 #include "utils.glsl"
 #include "depth_utils.glsl"
 
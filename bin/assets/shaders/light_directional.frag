@@ -14,11 +14,7 @@ uniform vec3 u_direction = vec3(1, -0.5, 1);
 uniform vec3 u_color = vec3(1, 1, 1);
 uniform float u_intensity = 1.0;
 
-uniform vec3 u_cameraPosition;
-uniform vec3 u_cameraDirection;
-
-uniform mat4 u_viewProjectionInv;
-
+#include "globals.glsl"
 #include "utils.glsl"
 #include "depth_utils.glsl"
 
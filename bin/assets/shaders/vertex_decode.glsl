@@ -0,0 +1,41 @@
+// @NOTE - has to match VertexDecodeParameters, defaults describe float attributes
+uniform vec3 u_positionOffset = vec3(0.0);
+uniform vec3 u_positionScale = vec3(1.0);
+uniform bool u_octahedralNormals = false;
+
+// quantized positions are normalized to [-1, 1] within mesh bounding box
+vec3 decodePosition(vec3 position, vec3 offset, vec3 scale)
+{
+    return offset + position * scale;
+}
+
+vec2 signNotZero(vec2 value)
+{
+    return vec2(value.x >= 0.0 ? 1.0 : -1.0, value.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 octahedralDecode(vec2 encoded)
+{
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (direction.z < 0.0)
+    {
+        direction.xy = (1.0 - abs(direction.yx)) * signNotZero(direction.xy);
+    }
+
+    return normalize(direction);
+}
+
+vec3 decodeDirection(vec3 direction, bool octahedral)
+{
+    return octahedral ? octahedralDecode(direction.xy) : direction;
+}
+
+vec3 decodePosition(vec3 position)
+{
+    return decodePosition(position, u_positionOffset, u_positionScale);
+}
+
+vec3 decodeDirection(vec3 direction)
+{
+    return decodeDirection(direction, u_octahedralNormals);
+}
@@ -10,10 +10,11 @@ namespace BGLRenderer
     AssetManager::AssetManager(const std::shared_ptr<AssetContentLoader>& contentLoader) :
         _contentLoader(contentLoader),
         _assetFileChangesObserver(contentLoader),
-        _programAssetManager(std::make_shared<ProgramAssetManager>(std::make_shared<ProgramLoader>(_contentLoader), std::make_shared<ObjectInMemoryCache<std::string, OpenGLProgram>>())),
-        _textureAssetManager(std::make_shared<TextureAssetManager>(std::make_shared<TextureLoader>(_contentLoader), std::make_shared<ObjectInMemoryCache<std::string, OpenGLTexture2D>>())),
-        _materialAssetManager(std::make_shared<MaterialAssetManager>(std::make_shared<MaterialLoader>(_contentLoader, _textureAssetManager, _programAssetManager), std::make_shared<ObjectInMemoryCache<std::string, OpenGLMaterial>>())),
-        _modelAssetManager(std::make_shared<ModelAssetManager>(std::make_shared<ModelLoader>(_contentLoader, _textureAssetManager, _materialAssetManager), std::make_shared<ObjectInMemoryCache<std::string, OpenGLRenderObject>>())),
+        _programAssetManager(std::make_shared<ProgramAssetManager>(std::make_shared<ProgramLoader>(_contentLoader), std::make_shared<ObjectInMemoryCache<StringId, OpenGLProgram>>())),
+        _textureAssetManager(std::make_shared<TextureAssetManager>(std::make_shared<TextureLoader>(_contentLoader), std::make_shared<ObjectInMemoryCache<StringId, OpenGLTexture2D>>())),
+        _materialAssetManager(std::make_shared<MaterialAssetManager>(std::make_shared<MaterialLoader>(_contentLoader, _textureAssetManager, _programAssetManager), std::make_shared<ObjectInMemoryCache<StringId, OpenGLMaterial>>())),
+        _modelLoader(std::make_shared<ModelLoader>(_contentLoader, _textureAssetManager, _materialAssetManager)),
+        _modelAssetManager(std::make_shared<ModelAssetManager>(_modelLoader, std::make_shared<ObjectInMemoryCache<StringId, OpenGLRenderObject>>())),
         _configLoader(_contentLoader),
         _sceneLoader(_contentLoader, _modelAssetManager, _materialAssetManager, _programAssetManager)
     {
@@ -22,6 +23,10 @@ namespace BGLRenderer
     void AssetManager::tick()
     {
         _assetFileChangesObserver.tick();
+        _programAssetManager->loader()->tick();
+
+        // reloaded shaders may include files which weren't used before
+        observeDiscoveredShaderFiles();
     }
 
     void AssetManager::registerAsset(const std::string& name, const std::shared_ptr<OpenGLTexture2D>& texture)
@@ -44,25 +49,82 @@ namespace BGLRenderer
         _materialAssetManager->registerAsset(name, material);
     }
 
+    void AssetManager::setGeometryArena(const std::shared_ptr<OpenGLGeometryArena>& arena)
+    {
+        _modelLoader->setGeometryArena(arena);
+    }
+
     std::shared_ptr<OpenGLProgram> AssetManager::getProgram(const std::string& name)
     {
         return getProgram(name + ".vert", name + ".frag");
     }
 
     std::shared_ptr<OpenGLProgram> AssetManager::getProgram(const std::string& vertexShaderName, const std::string& fragmentShaderName)
+    {
+        return getProgram(vertexShaderName, fragmentShaderName, 0);
+    }
+
+    std::shared_ptr<OpenGLProgram> AssetManager::getProgram(const std::string& vertexShaderName, const std::string& fragmentShaderName,
+                                                            std::uint32_t featureMask)
     {
         ProgramShaderNames names{vertexShaderName, fragmentShaderName};
 
-        if (_programAssetManager->exists(names))
+        if (_programAssetManager->exists(names, featureMask))
         {
-            return _programAssetManager->get(names);
+            return _programAssetManager->get(names, featureMask);
         }
 
-        std::shared_ptr<OpenGLProgram> program = _programAssetManager->get(names);
-        addProgramShadersListeners(program, names.vertex, names.fragment);
+        std::shared_ptr<OpenGLProgram> program = _programAssetManager->get(names, featureMask);
+        observeDiscoveredShaderFiles();
+
+        std::uint32_t variantBaseId = featureMask == 0
+                                          ? program->uniqueId()
+                                          : getProgram(vertexShaderName, fragmentShaderName, 0)->variantBaseId();
+
+        program->setVariantSource(featureMask, variantBaseId, [this, names](std::uint32_t variantFeatureMask)
+        {
+            return getProgram(names.vertex, names.fragment, variantFeatureMask);
+        });
+
         return program;
     }
 
+    std::shared_ptr<OpenGLProgram> AssetManager::getProgramStage(const std::string& shaderName)
+    {
+        std::shared_ptr<OpenGLProgram> stage = _programAssetManager->getStage(shaderName);
+        observeDiscoveredShaderFiles();
+        return stage;
+    }
+
+    std::shared_ptr<OpenGLProgramPipeline> AssetManager::getProgramPipeline(const std::string& vertexShaderName,
+                                                                            const std::string& fragmentShaderName)
+    {
+        ProgramShaderNames names{vertexShaderName, fragmentShaderName};
+        StringId id = ProgramAssetManager::assetId(names);
+
+        auto it = _programPipelines.find(id);
+        if (it != _programPipelines.end())
+        {
+            return it->second;
+        }
+
+        std::shared_ptr<OpenGLProgramPipeline> pipeline;
+        std::string name = ProgramAssetManager::assetName(names);
+
+        if (OpenGLProgramPipeline::supported())
+        {
+            pipeline = std::make_shared<OpenGLProgramPipeline>(name, getProgramStage(vertexShaderName),
+                                                               getProgramStage(fragmentShaderName));
+        }
+        else
+        {
+            pipeline = std::make_shared<OpenGLProgramPipeline>(name, getProgram(vertexShaderName, fragmentShaderName));
+        }
+
+        _programPipelines[id] = pipeline;
+        return pipeline;
+    }
+
     std::shared_ptr<OpenGLTexture2D> AssetManager::getTexture2D(const std::string& name)
     {
         return _textureAssetManager->get(name);
@@ -73,9 +135,10 @@ namespace BGLRenderer
         return _textureAssetManager->getHDR(name);
     }
 
-    std::shared_ptr<OpenGLRenderObject> AssetManager::getModel(const std::string& name, const std::shared_ptr<OpenGLProgram>& program)
+    std::shared_ptr<OpenGLRenderObject> AssetManager::getModel(const std::string& name, const std::shared_ptr<OpenGLProgram>& program,
+                                                               const ModelLoadOptions& options)
     {
-        return _modelAssetManager->get(name, program);
+        return _modelAssetManager->get(name, program, options);
     }
 
     std::shared_ptr<OpenGLMaterial> AssetManager::getMaterial(const std::string& name)
@@ -107,23 +170,18 @@ namespace BGLRenderer
         return Private::logger;
     }
 
-    void AssetManager::addProgramShadersListeners(const std::shared_ptr<OpenGLProgram>& program, const std::string& vertexShaderName, const std::string& fragmentShaderName)
+    void AssetManager::observeDiscoveredShaderFiles()
     {
-        logger().debug("Listening to file changes on: \"{}\"", vertexShaderName);
-        _assetFileChangesObserver.listenFileChanged(vertexShaderName, [program=program, &logger=logger(), &programAssetManager=_programAssetManager](const AssetFileChangedEvent& ev)
-        {
-            std::string shaderName = ev.path.string();
-            logger.debug("Vertex shader file changed, trying to update: {}", shaderName);
-            programAssetManager->loader()->tryToUpdateVertexShader(program, shaderName);
-        });
-
-        logger().debug("Listening to file changes on: \"{}\"", fragmentShaderName);
-        _assetFileChangesObserver.listenFileChanged(fragmentShaderName, [program=program, &logger=logger(), &programAssetManager=_programAssetManager](const AssetFileChangedEvent& ev)
+        for (const std::string& shaderFile: _programAssetManager->loader()->takeDiscoveredShaderFiles())
         {
-            std::string shaderName = ev.path.string();
-            logger.debug("Fragment shader file changed, trying to update: {}", shaderName);
-            programAssetManager->loader()->tryToUpdateFragmentShader(program, shaderName);
-        });
+            logger().debug("Listening to file changes on: \"{}\"", shaderFile);
+            _assetFileChangesObserver.listenFileChanged(shaderFile, [&logger=logger(), &programAssetManager=_programAssetManager](const AssetFileChangedEvent& ev)
+            {
+                std::string shaderName = ev.path.string();
+                logger.debug("Shader file changed, trying to update dependent programs: {}", shaderName);
+                programAssetManager->loader()->shaderFileChanged(shaderName);
+            });
+        }
     }
 
     void AssetManager::addMaterialListener(const std::shared_ptr<OpenGLMaterial>& material, const std::string& name)
@@ -16,6 +16,7 @@
 
 #include <Graphics/OpenGLRenderObject.h>
 #include <Graphics/Resources/OpenGLProgram.h>
+#include <Graphics/Resources/OpenGLProgramPipeline.h>
 #include <Graphics/Resources/OpenGLTexture2D.h>
 
 #include <World/Scene.h>
@@ -48,11 +49,25 @@ namespace BGLRenderer
         /// the generated name will be: "shaders/basic.vert+shaders/basic.frag"
         std::shared_ptr<OpenGLProgram> getProgram(const std::string& vertexShaderName, const std::string& fragmentShaderName);
 
+        /// @brief Loads or returns existing variant of the program, see ShaderFeature for available bits.
+        /// Programs returned by getProgram can create their variants on demand (OpenGLProgram::variant)
+        std::shared_ptr<OpenGLProgram> getProgram(const std::string& vertexShaderName, const std::string& fragmentShaderName,
+                                                  std::uint32_t featureMask);
+
+        /// @brief Loads or returns existing separable stage, every shader file is compiled once and shared by all pipelines
+        std::shared_ptr<OpenGLProgram> getProgramStage(const std::string& shaderName);
+
+        /// @brief Loads or returns existing pipeline composed from cached stages.
+        /// Falls back to pipeline wrapping regular program when separable programs are not supported
+        std::shared_ptr<OpenGLProgramPipeline> getProgramPipeline(const std::string& vertexShaderName,
+                                                                  const std::string& fragmentShaderName);
+
         std::shared_ptr<OpenGLTexture2D> getTexture2D(const std::string& name);
         std::shared_ptr<OpenGLTexture2D> getTexture2DHDR(const std::string& name);
 
         /// @brief Loads or return existing model with given name, uses given program to create materials when loading model
-        std::shared_ptr<OpenGLRenderObject> getModel(const std::string& name, const std::shared_ptr<OpenGLProgram>& program);
+        std::shared_ptr<OpenGLRenderObject> getModel(const std::string& name, const std::shared_ptr<OpenGLProgram>& program,
+                                                     const ModelLoadOptions& options = {});
 
         std::shared_ptr<OpenGLMaterial> getMaterial(const std::string& name);
 
@@ -60,6 +75,11 @@ namespace BGLRenderer
 
         std::shared_ptr<Config> getConfig(const std::string& name);
 
+        /// @brief Models loaded after this call store their meshes also in the given arena
+        void setGeometryArena(const std::shared_ptr<OpenGLGeometryArena>& arena);
+
+        inline const std::shared_ptr<ProgramLoader>& programLoader() const { return _programAssetManager->loader(); }
+
         static Log& logger();
 
     private:
@@ -67,13 +87,16 @@ namespace BGLRenderer
         AssetFileChangesObserver _assetFileChangesObserver;
 
         std::shared_ptr<ProgramAssetManager> _programAssetManager;
+        std::unordered_map<StringId, std::shared_ptr<OpenGLProgramPipeline>> _programPipelines;
         std::shared_ptr<TextureAssetManager> _textureAssetManager;
         std::shared_ptr<MaterialAssetManager> _materialAssetManager;
+        std::shared_ptr<ModelLoader> _modelLoader;
         std::shared_ptr<ModelAssetManager> _modelAssetManager;
         ConfigLoader _configLoader;
         SceneLoader _sceneLoader;
 
-        void addProgramShadersListeners(const std::shared_ptr<OpenGLProgram>& program, const std::string& vertexShaderName, const std::string& fragmentShaderName);
+        /// @brief Shader and include files are observed once, program loader knows which programs depend on them
+        void observeDiscoveredShaderFiles();
         void addMaterialListener(const std::shared_ptr<OpenGLMaterial>& material, const std::string& name);
         void addSceneListener(const std::shared_ptr<Scene>& scene, const std::string& name);
     };
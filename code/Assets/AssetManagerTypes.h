@@ -8,11 +8,28 @@
 #include <Graphics/OpenGLRenderObject.h>
 
 #include <Foundation/ObjectInMemoryCache.h>
+#include <Foundation/StringId.h>
 
 namespace BGLRenderer
 {
-    typedef std::shared_ptr<ObjectInMemoryCache<std::string, OpenGLProgram>> OpenGLProgramsCache;
-    typedef std::shared_ptr<ObjectInMemoryCache<std::string, OpenGLTexture2D>> OpenGLTexture2DCache;
-    typedef std::shared_ptr<ObjectInMemoryCache<std::string, OpenGLRenderObject>> OpenGLRenderObjectCache;
-    typedef std::shared_ptr<ObjectInMemoryCache<std::string, OpenGLMaterial>> OpenGLMaterialCache;
+    typedef std::shared_ptr<ObjectInMemoryCache<StringId, OpenGLProgram>> OpenGLProgramsCache;
+    typedef std::shared_ptr<ObjectInMemoryCache<StringId, OpenGLTexture2D>> OpenGLTexture2DCache;
+    typedef std::shared_ptr<ObjectInMemoryCache<StringId, OpenGLRenderObject>> OpenGLRenderObjectCache;
+    typedef std::shared_ptr<ObjectInMemoryCache<StringId, OpenGLMaterial>> OpenGLMaterialCache;
+
+    /// @brief Options are part of model's cache id, so users asking for different options get separate copies
+    struct ModelLoadOptions
+    {
+        /// @brief Attributes that are not part of the layout are neither generated nor uploaded
+        VertexLayout vertexLayout = VertexLayout::standard();
+
+        /// @brief Stores vertexLayout attributes in compressed formats (see VertexLayout::compressed)
+        /// and uses 16-bit indices when vertex count allows it
+        bool compressVertices = true;
+
+        /// @brief Nothing reads geometry after upload by default, bounds are computed during loading
+        MeshDataRetention retention = MeshDataRetention::discard;
+
+        bool operator==(const ModelLoadOptions& other) const = default;
+    };
 }
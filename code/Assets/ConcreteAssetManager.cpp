@@ -7,24 +7,28 @@
 #include "ModelLoader.h"
 #include "TextureLoader.h"
 
+#include <array>
+#include <charconv>
+
 namespace BGLRenderer
 {
     void TextureAssetManager::registerAsset(const std::string& name, const std::shared_ptr<OpenGLTexture2D>& asset)
     {
-        if (_assetCache->exists(name))
+        StringId id(name);
+        if (_assetCache->exists(id))
         {
             AssetManager::logger().error("Texture with given name \"{}\" is already registered!", name);
             return;
         }
 
-        _assetCache->set(name, asset);
+        _assetCache->set(id, asset);
     }
 
     std::shared_ptr<OpenGLTexture2D> TextureAssetManager::get(const std::string& name)
     {
-        if (_assetCache->exists(name))
+        if (std::shared_ptr<AssetType> asset = _assetCache->get(StringId(name)))
         {
-            return _assetCache->get(name);
+            return asset;
         }
 
         AssetManager::logger().debug("Loading texture from: {}", name);
@@ -43,9 +47,9 @@ namespace BGLRenderer
 
     std::shared_ptr<OpenGLTexture2D> TextureAssetManager::getHDR(const std::string& name)
     {
-        if (_assetCache->exists(name))
+        if (std::shared_ptr<AssetType> asset = _assetCache->get(StringId(name)))
         {
-            return _assetCache->get(name);
+            return asset;
         }
 
         AssetManager::logger().debug("Loading texture from: {}", name);
@@ -64,51 +68,99 @@ namespace BGLRenderer
 
     void ProgramAssetManager::registerAsset(const std::string& name, const std::shared_ptr<OpenGLProgram>& program)
     {
-        if (_assetCache->exists(name))
+        registerAsset(StringId(name), program);
+    }
+
+    void ProgramAssetManager::registerAsset(const ProgramShaderNames& name, const std::shared_ptr<OpenGLProgram>& program)
+    {
+        registerAsset(assetId(name), program);
+    }
+
+    void ProgramAssetManager::registerAsset(StringId id, const std::shared_ptr<OpenGLProgram>& program)
+    {
+        if (_assetCache->exists(id))
         {
-            AssetManager::logger().error("Program with given name \"{}\" is already registered!", name);
+            AssetManager::logger().error("Program with given name \"{}\" is already registered!", id.debugString());
             return;
         }
 
-        _assetCache->set(name, program);
+        _assetCache->set(id, program);
     }
 
-    void ProgramAssetManager::registerAsset(const ProgramShaderNames& name, const std::shared_ptr<OpenGLProgram>& program)
+    std::shared_ptr<OpenGLProgram> ProgramAssetManager::get(const ProgramShaderNames& name, std::uint32_t featureMask)
     {
-        std::string assetName = name.vertex + "+" + name.fragment;
-        registerAsset(assetName, program);
+        StringId programId = assetId(name, featureMask);
+
+        if (std::shared_ptr<OpenGLProgram> program = _assetCache->get(programId))
+        {
+            return program;
+        }
+
+        std::shared_ptr<OpenGLProgram> program = _assetLoader->load(name.vertex, name.fragment, featureMask);
+        registerAsset(programId, program);
+        return program;
     }
 
-    std::shared_ptr<OpenGLProgram> ProgramAssetManager::get(const ProgramShaderNames& name)
+    std::shared_ptr<OpenGLProgram> ProgramAssetManager::getStage(const std::string& shaderName)
+    {
+        if (std::shared_ptr<OpenGLProgram> program = _assetCache->get(StringId(shaderName)))
+        {
+            return program;
+        }
+
+        std::shared_ptr<OpenGLProgram> program = _assetLoader->loadStage(shaderName);
+        registerAsset(shaderName, program);
+        return program;
+    }
+
+    std::string ProgramAssetManager::assetName(const ProgramShaderNames& name, std::uint32_t featureMask)
     {
         std::string programName = name.vertex + "+" + name.fragment;
 
-        if (_assetCache->exists(programName))
+        if (featureMask != 0)
         {
-            return _assetCache->get(programName);
+            programName += std::format("#{:x}", featureMask);
         }
 
-        std::shared_ptr<OpenGLProgram> program = _assetLoader->load(name.vertex, name.fragment);
-        registerAsset(programName, program);
-        return program;
+        return programName;
+    }
+
+    StringId ProgramAssetManager::assetId(const ProgramShaderNames& name, std::uint32_t featureMask)
+    {
+        StringId id = StringId::fromHash(fnv1a64(name.vertex)).append("+").append(name.fragment);
+
+        if (featureMask != 0)
+        {
+            std::array<char, 8> digits{};
+            auto [end, error] = std::to_chars(digits.data(), digits.data() + digits.size(), featureMask, 16);
+            id = id.append("#").append(std::string_view(digits.data(), end));
+        }
+
+        if constexpr (Debug::stringIdNames)
+        {
+            StringId::registerName(id, assetName(name, featureMask));
+        }
+
+        return id;
     }
 
     void MaterialAssetManager::registerAsset(const std::string& name, const std::shared_ptr<OpenGLMaterial>& material)
     {
-        if (_assetCache->exists(name))
+        StringId id(name);
+        if (_assetCache->exists(id))
         {
             AssetManager::logger().error("Material with given name \"{}\" is already registered!", name);
             return;
         }
 
-        _assetCache->set(name, material);
+        _assetCache->set(id, material);
     }
 
     std::shared_ptr<OpenGLMaterial> MaterialAssetManager::get(const std::string& name)
     {
-        if (_assetCache->exists(name))
+        if (std::shared_ptr<AssetType> asset = _assetCache->get(StringId(name)))
         {
-            return _assetCache->get(name);
+            return asset;
         }
 
         std::shared_ptr<OpenGLMaterial> material = _assetLoader->load(name);
@@ -125,20 +177,21 @@ namespace BGLRenderer
 
     void ModelAssetManager::registerAsset(const std::string& name, const std::shared_ptr<OpenGLRenderObject>& model)
     {
-        if (_assetCache->exists(name))
+        StringId id(name);
+        if (_assetCache->exists(id))
         {
             AssetManager::logger().error("Model with given name \"{}\" is already registered!", name);
             return;
         }
 
-        _assetCache->set(name, model);
+        _assetCache->set(id, model);
     }
 
     std::shared_ptr<OpenGLRenderObject> ModelAssetManager::get(const std::string& name)
     {
-        if (_assetCache->exists(name))
+        if (std::shared_ptr<AssetType> asset = _assetCache->get(StringId(name)))
         {
-            return _assetCache->get(name);
+            return asset;
         }
 
         std::shared_ptr<OpenGLRenderObject> renderObject = _assetLoader->load(name);
@@ -152,21 +205,81 @@ namespace BGLRenderer
         return renderObject;
     }
 
-    std::shared_ptr<OpenGLRenderObject> ModelAssetManager::get(const std::string& name, const std::shared_ptr<OpenGLProgram>& program)
+    std::shared_ptr<OpenGLRenderObject> ModelAssetManager::get(const std::string& name, const std::shared_ptr<OpenGLProgram>& program,
+                                                               const ModelLoadOptions& options)
     {
-        if (_assetCache->exists(name))
+        // meshes of a cached model may use other layout or have their CPU data discarded already
+        const StringId id = assetId(name, options);
+        if (std::shared_ptr<AssetType> asset = _assetCache->get(id))
         {
-            return _assetCache->get(name);
+            return asset;
         }
 
-        std::shared_ptr<OpenGLRenderObject> renderObject = _assetLoader->load(name, program);
+        std::shared_ptr<OpenGLRenderObject> renderObject = _assetLoader->load(name, program, nullptr, options);
         if (renderObject == nullptr)
         {
             AssetManager::logger().error("Couldn't find model: \"{}\"", name);
             return nullptr;
         }
 
-        registerAsset(name, renderObject);
+        _assetCache->set(id, renderObject);
         return renderObject;
     }
+
+    std::string ModelAssetManager::assetName(const std::string& name, const ModelLoadOptions& options)
+    {
+        if (options == ModelLoadOptions{})
+        {
+            return name;
+        }
+
+        std::string modelName = std::format("{}#{}{}", name, options.compressVertices ? 'c' : 'r',
+                                            static_cast<int>(options.retention));
+
+        for (const VertexAttributeFormat& attribute: options.vertexLayout.attributes())
+        {
+            modelName += std::format("#{}.{}.{:x}.{}", attribute.location, attribute.components, attribute.type,
+                                     attribute.normalized);
+        }
+
+        return modelName;
+    }
+
+    StringId ModelAssetManager::assetId(const std::string& name, const ModelLoadOptions& options)
+    {
+        StringId id(name);
+        if (options == ModelLoadOptions{})
+        {
+            return id;
+        }
+
+        auto appendNumber = [&](std::uint32_t value, int base)
+        {
+            std::array<char, 8> digits{};
+            auto [end, error] = std::to_chars(digits.data(), digits.data() + digits.size(), value, base);
+            id = id.append(std::string_view(digits.data(), end));
+        };
+
+        id = id.append("#").append(options.compressVertices ? "c" : "r");
+        appendNumber(static_cast<std::uint32_t>(options.retention), 10);
+
+        for (const VertexAttributeFormat& attribute: options.vertexLayout.attributes())
+        {
+            id = id.append("#");
+            appendNumber(attribute.location, 10);
+            id = id.append(".");
+            appendNumber(static_cast<std::uint32_t>(attribute.components), 10);
+            id = id.append(".");
+            appendNumber(attribute.type, 16);
+            id = id.append(".");
+            appendNumber(attribute.normalized, 10);
+        }
+
+        if constexpr (Debug::stringIdNames)
+        {
+            StringId::registerName(id, assetName(name, options));
+        }
+
+        return id;
+    }
 }
@@ -2,9 +2,11 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 
 #include <Foundation/Base.h>
 #include <Foundation/ObjectInMemoryCache.h>
+#include <Foundation/StringId.h>
 #include "AssetManagerTypes.h"
 
 namespace BGLRenderer
@@ -20,7 +22,7 @@ namespace BGLRenderer
         std::string fragment;
     };
 
-    template<class TAssetLoader, class TAsset, class TAssetID=std::string>
+    template<class TAssetLoader, class TAsset, class TAssetID=StringId>
     class ConcreteAssetManager
     {
     public:
@@ -29,29 +31,30 @@ namespace BGLRenderer
 
     public:
         ConcreteAssetManager(const std::shared_ptr<TAssetLoader>& assetLoader,
-                             const std::shared_ptr<ObjectInMemoryCache<std::string, TAsset> >& assetCache) :
+                             const std::shared_ptr<ObjectInMemoryCache<TAssetID, TAsset> >& assetCache) :
             _assetLoader(assetLoader),
             _assetCache(assetCache)
         {
         }
 
-        inline bool exists(const TAssetID& name)
+        /// @brief Names are only hashed, cache lookups never copy or concatenate strings
+        inline bool exists(std::string_view name)
         {
-            return _assetCache->exists(name);
+            return _assetCache->exists(TAssetID(name));
         }
 
         inline const std::shared_ptr<TAssetLoader>& loader() { return _assetLoader; }
 
     protected:
         std::shared_ptr<TAssetLoader> _assetLoader;
-        std::shared_ptr<ObjectInMemoryCache<std::string, TAsset> > _assetCache;
+        std::shared_ptr<ObjectInMemoryCache<TAssetID, TAsset> > _assetCache;
     };
 
     class TextureAssetManager : public ConcreteAssetManager<TextureLoader, OpenGLTexture2D>
     {
     public:
         TextureAssetManager(const std::shared_ptr<AssetLoaderType>& assetLoader,
-                            const std::shared_ptr<ObjectInMemoryCache<std::string, AssetType> >& assetCache) :
+                            const std::shared_ptr<ObjectInMemoryCache<StringId, AssetType> >& assetCache) :
             ConcreteAssetManager(assetLoader, assetCache)
         {
         }
@@ -66,28 +69,38 @@ namespace BGLRenderer
     {
     public:
         ProgramAssetManager(const std::shared_ptr<AssetLoaderType>& assetLoader,
-                            const std::shared_ptr<ObjectInMemoryCache<std::string, AssetType> >& assetCache) :
+                            const std::shared_ptr<ObjectInMemoryCache<StringId, AssetType> >& assetCache) :
             ConcreteAssetManager(assetLoader, assetCache)
         {
         }
 
         void registerAsset(const std::string& name, const std::shared_ptr<OpenGLProgram>& program);
         void registerAsset(const ProgramShaderNames& name, const std::shared_ptr<OpenGLProgram>& program);
+        void registerAsset(StringId id, const std::shared_ptr<OpenGLProgram>& program);
 
-        std::shared_ptr<OpenGLProgram> get(const ProgramShaderNames& name);
+        /// @brief Variants are cached separately for every (shaders, feature mask) pair
+        std::shared_ptr<OpenGLProgram> get(const ProgramShaderNames& name, std::uint32_t featureMask = 0);
 
-        inline bool exists(const ProgramShaderNames& name) const
+        inline bool exists(const ProgramShaderNames& name, std::uint32_t featureMask = 0) const
         {
-            const std::string programName = name.vertex + "+" + name.fragment;
-            return _assetCache->exists(programName);
+            return _assetCache->exists(assetId(name, featureMask));
         }
+
+        /// @brief Separable program with single stage, cached under the shader name
+        std::shared_ptr<OpenGLProgram> getStage(const std::string& shaderName);
+
+        /// @brief Feature mask is appended as hex number, e.g. "shaders/a.vert+shaders/a.frag#3"
+        static std::string assetName(const ProgramShaderNames& name, std::uint32_t featureMask = 0);
+
+        /// @brief Id of assetName() built by hashing the parts in place
+        static StringId assetId(const ProgramShaderNames& name, std::uint32_t featureMask = 0);
     };
 
     class MaterialAssetManager : public ConcreteAssetManager<MaterialLoader, OpenGLMaterial>
     {
     public:
         MaterialAssetManager(const std::shared_ptr<AssetLoaderType>& assetLoader,
-                             const std::shared_ptr<ObjectInMemoryCache<std::string, AssetType> >& assetCache) :
+                             const std::shared_ptr<ObjectInMemoryCache<StringId, AssetType> >& assetCache) :
             ConcreteAssetManager(assetLoader, assetCache)
         {
         }
@@ -100,7 +113,7 @@ namespace BGLRenderer
     {
     public:
         ModelAssetManager(const std::shared_ptr<AssetLoaderType>& assetLoader,
-                          const std::shared_ptr<ObjectInMemoryCache<std::string, AssetType> >& assetCache) :
+                          const std::shared_ptr<ObjectInMemoryCache<StringId, AssetType> >& assetCache) :
             ConcreteAssetManager(assetLoader, assetCache)
         {
         }
@@ -108,6 +121,13 @@ namespace BGLRenderer
         void registerAsset(const std::string& name, const std::shared_ptr<OpenGLRenderObject>& model);
 
         std::shared_ptr<OpenGLRenderObject> get(const std::string& name);
-        std::shared_ptr<OpenGLRenderObject> get(const std::string& name, const std::shared_ptr<OpenGLProgram>& program);
+        std::shared_ptr<OpenGLRenderObject> get(const std::string& name, const std::shared_ptr<OpenGLProgram>& program,
+                                                const ModelLoadOptions& options = {});
+
+        /// @brief Plain name for default options, so registerAsset and get(name) share the entry with them
+        static std::string assetName(const std::string& name, const ModelLoadOptions& options);
+
+        /// @brief Id of assetName() built by hashing the parts in place
+        static StringId assetId(const std::string& name, const ModelLoadOptions& options);
     };
 }
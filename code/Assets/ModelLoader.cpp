@@ -28,8 +28,14 @@ namespace BGLRenderer
 
     std::shared_ptr<OpenGLRenderObject> ModelLoader::load(const std::string& name,
                                                           const std::shared_ptr<OpenGLProgram>& program,
-                                                          const std::shared_ptr<OpenGLMaterial>& forceMaterial)
+                                                          const std::shared_ptr<OpenGLMaterial>& forceMaterial,
+                                                          const ModelLoadOptions& loadOptions)
     {
+        const VertexLayout layout = loadOptions.compressVertices
+                                        ? loadOptions.vertexLayout.compressed()
+                                        : loadOptions.vertexLayout;
+        ASSERT(layout.has(VertexAttributeLocation::position), "Model vertex layout requires positions");
+
         HighResolutionTimer loadingTimer;
 
         std::string path = "assets/" + name;
@@ -116,30 +122,60 @@ namespace BGLRenderer
                     indices.push_back(static_cast<GLuint>(index));
                 }
 
-                std::shared_ptr<OpenGLMesh> openGLMesh = std::make_shared<OpenGLMesh>();
-                openGLMesh->setVertices(positions.data(), static_cast<GLuint>(positions.size()));
+                // tangents require normals and uvs even if they are not part of the layout
+                const bool needsTangents = layout.has(VertexAttributeLocation::tangent);
+                const bool needsNormals = layout.has(VertexAttributeLocation::normal) || needsTangents;
+                const bool needsUVs = layout.has(VertexAttributeLocation::uv0) || needsTangents;
 
-                if (normals.empty())
+                if (needsNormals && normals.empty())
                 {
                     _logger.debug("Generating normals for \"{}\", primitive index: {}", name, primitiveIndex);
                     OpenGLMesh::calculateNormals(normals, positions, indices);
                 }
-                openGLMesh->setNormals(normals.data(), static_cast<GLuint>(normals.size()));
 
-                if (uvs0.empty())
+                if (needsUVs && uvs0.empty())
                 {
                     uvs0.resize(positions.size() / 3 * 2, 0.0f);
                 }
-                openGLMesh->setUVs0(uvs0.data(), static_cast<GLuint>(uvs0.size()));
 
-                if (tangents.empty())
+                if (needsTangents && tangents.empty())
                 {
                     _logger.debug("Generating tangents for \"{}\", primitive index: {}", name, primitiveIndex);
                     OpenGLMesh::calculateTangents(tangents, positions, normals, uvs0, indices);
                 }
-                openGLMesh->setTangents(tangents.data(), static_cast<GLuint>(tangents.size()));
 
-                openGLMesh->setIndices(indices.data(), static_cast<GLuint>(indices.size()));
+                const std::size_t vertexCount = positions.size() / 3;
+
+                VertexStreams streams{};
+                streams.positions = positions.data();
+                streams.normals = normals.empty() ? nullptr : normals.data();
+                streams.tangents = tangents.empty() ? nullptr : tangents.data();
+                streams.uvs0 = uvs0.empty() ? nullptr : uvs0.data();
+
+                // quantized positions are stored relative to the bounding box
+                MeshBounds bounds = MeshBounds::fromPositions(positions);
+                std::vector<std::uint8_t> vertexData = layout.interleave(streams, vertexCount, bounds.box);
+
+                std::shared_ptr<OpenGLMesh> openGLMesh = std::make_shared<OpenGLMesh>();
+
+                // arena stores meshes of its own layout only, other meshes get buffers of their own
+                if (_geometryArena != nullptr && layout == _geometryArena->vertexLayout() && !indices.empty())
+                {
+                    openGLMesh->setArenaGeometry(_geometryArena, vertexData.data(), static_cast<GLuint>(vertexCount),
+                                                 VertexDecodeParameters::forLayout(layout, bounds.box),
+                                                 indices.data(), static_cast<GLuint>(indices.size()));
+                }
+                else
+                {
+                    openGLMesh->setVertexData(layout, vertexData.data(), static_cast<GLuint>(vertexCount),
+                                              VertexDecodeParameters::forLayout(layout, bounds.box));
+                    openGLMesh->setIndices(indices.data(), static_cast<GLuint>(indices.size()),
+                                           loadOptions.compressVertices);
+                }
+
+                openGLMesh->setBounds(bounds);
+
+                openGLMesh->applyRetention(loadOptions.retention);
 
                 RenderObjectSubmesh submesh;
                 submesh.material = openGLMaterial;
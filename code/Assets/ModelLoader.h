@@ -19,7 +19,11 @@ namespace BGLRenderer
 
         std::shared_ptr<OpenGLRenderObject> load(const std::string& name);
         std::shared_ptr<OpenGLRenderObject> load(const std::string& name, const std::shared_ptr<OpenGLProgram>& program,
-                                                 const std::shared_ptr<OpenGLMaterial>& forceMaterial = nullptr);
+                                                 const std::shared_ptr<OpenGLMaterial>& forceMaterial = nullptr,
+                                                 const ModelLoadOptions& options = {});
+
+        /// @brief Meshes loaded after this call are also stored in the arena, nullptr disables it
+        inline void setGeometryArena(const std::shared_ptr<OpenGLGeometryArena>& arena) { _geometryArena = arena; }
 
     private:
         Log _logger{"Model Loader"};
@@ -27,6 +31,7 @@ namespace BGLRenderer
         std::shared_ptr<AssetContentLoader> _contentLoader;
         std::shared_ptr<TextureAssetManager> _textureAssetManager;
         std::shared_ptr<MaterialAssetManager> _materialAssetManager;
+        std::shared_ptr<OpenGLGeometryArena> _geometryArena = nullptr;
 
         void loadMaterialFromCGLTFMaterial(const std::string& modelName, const std::shared_ptr<OpenGLMaterial>& target,
                                            const std::string& basePath, const cgltf_material* material);
@@ -0,0 +1,122 @@
+﻿#include "ProgramBinaryCache.h"
+
+#include <Foundation/Hash.h>
+
+#include <fstream>
+
+namespace BGLRenderer
+{
+    ProgramBinaryCache::ProgramBinaryCache(const std::filesystem::path& cacheFolderPath) :
+        _cacheFolderPath(cacheFolderPath)
+    {
+    }
+
+    std::uint64_t ProgramBinaryCache::key(const std::string& vertexShaderCode, const std::string& fragmentShaderCode)
+    {
+        // separator keeps "ab"+"c" and "a"+"bc" apart
+        std::uint64_t hash = fnv1a64(vertexShaderCode, contextHash());
+        hash = fnv1a64(std::string_view("\0", 1), hash);
+        return fnv1a64(fragmentShaderCode, hash);
+    }
+
+    bool ProgramBinaryCache::load(std::uint64_t key, OpenGLProgramBinary& binary)
+    {
+        std::filesystem::path path = filePath(key);
+
+        std::ifstream is(path, std::ios::binary);
+        if (!is.is_open())
+        {
+            _stats.misses++;
+            return false;
+        }
+
+        FileHeader header{};
+        is.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        if (is.gcount() != sizeof(header) || header.magic != fileMagic || header.version != fileVersion ||
+            header.key != key || header.size == 0)
+        {
+            _logger.warning("Ignoring invalid program binary: {}", path.string());
+            _stats.misses++;
+            return false;
+        }
+
+        binary.format = static_cast<GLenum>(header.format);
+        binary.data.resize(header.size);
+        is.read(reinterpret_cast<char*>(binary.data.data()), header.size);
+
+        if (static_cast<std::uint32_t>(is.gcount()) != header.size)
+        {
+            _logger.warning("Program binary is truncated: {}", path.string());
+            _stats.misses++;
+            return false;
+        }
+
+        _stats.hits++;
+        return true;
+    }
+
+    void ProgramBinaryCache::store(std::uint64_t key, const OpenGLProgramBinary& binary)
+    {
+        std::error_code errorCode;
+        std::filesystem::create_directories(_cacheFolderPath, errorCode);
+
+        if (errorCode)
+        {
+            _logger.error("Couldn't create program cache folder {}: {}", _cacheFolderPath.string(), errorCode.message());
+            return;
+        }
+
+        std::filesystem::path path = filePath(key);
+
+        std::ofstream os(path, std::ios::binary | std::ios::trunc);
+        if (!os.is_open())
+        {
+            _logger.error("Couldn't open file for writing: {}", path.string());
+            return;
+        }
+
+        FileHeader header{fileMagic, fileVersion, key, static_cast<std::uint32_t>(binary.format),
+                          static_cast<std::uint32_t>(binary.data.size())};
+
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        os.write(reinterpret_cast<const char*>(binary.data.data()), static_cast<std::streamsize>(binary.data.size()));
+
+        _stats.stored++;
+    }
+
+    void ProgramBinaryCache::reject(std::uint64_t key)
+    {
+        _stats.hits--;
+        _stats.rejected++;
+
+        std::error_code errorCode;
+        std::filesystem::remove(filePath(key), errorCode);
+    }
+
+    std::filesystem::path ProgramBinaryCache::filePath(std::uint64_t key) const
+    {
+        return _cacheFolderPath / std::format("{:016x}.bin", key);
+    }
+
+    std::uint64_t ProgramBinaryCache::contextHash()
+    {
+        if (_contextHashComputed)
+        {
+            return _contextHash;
+        }
+
+        auto glString = [](GLenum name)
+        {
+            const GLubyte* value = glGetString(name);
+            return value != nullptr ? std::string_view(reinterpret_cast<const char*>(value)) : std::string_view();
+        };
+
+        _contextHash = fnv1a64(glString(GL_VENDOR));
+        _contextHash = fnv1a64(glString(GL_RENDERER), _contextHash);
+        _contextHash = fnv1a64(glString(GL_VERSION), _contextHash);
+        _contextHashComputed = true;
+
+        return _contextHash;
+    }
+}
@@ -0,0 +1,65 @@
+﻿#pragma once
+
+#include <Foundation/Base.h>
+#include <Foundation/Log.h>
+
+#include <Graphics/Resources/OpenGLProgram.h>
+
+#include <filesystem>
+#include <string>
+
+namespace BGLRenderer
+{
+    struct ProgramBinaryCacheStats
+    {
+        int hits = 0;
+        int misses = 0;
+        int rejected = 0;
+        int stored = 0;
+    };
+
+    /// @brief Stores linked program binaries on disk, one file per key.
+    /// Key covers preprocessed source of both stages and GL vendor, renderer and version,
+    /// so driver updates and shader edits never load stale binaries
+    class ProgramBinaryCache
+    {
+    public:
+        ProgramBinaryCache(const std::filesystem::path& cacheFolderPath = "./cache/programs/");
+
+        std::uint64_t key(const std::string& vertexShaderCode, const std::string& fragmentShaderCode);
+
+        bool load(std::uint64_t key, OpenGLProgramBinary& binary);
+        void store(std::uint64_t key, const OpenGLProgramBinary& binary);
+
+        /// @brief Called when driver rejects loaded binary, file is overwritten by the next store anyway
+        void reject(std::uint64_t key);
+
+        inline const ProgramBinaryCacheStats& stats() const { return _stats; }
+
+    private:
+        Log _logger{"ProgramBinaryCache"};
+
+        std::filesystem::path _cacheFolderPath;
+        ProgramBinaryCacheStats _stats;
+
+        bool _contextHashComputed = false;
+        std::uint64_t _contextHash = 0;
+
+        struct FileHeader
+        {
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint64_t key;
+            std::uint32_t format;
+            std::uint32_t size;
+        };
+
+        static constexpr std::uint32_t fileMagic = 0x50474C42; // "BGLP"
+        static constexpr std::uint32_t fileVersion = 1;
+
+        std::filesystem::path filePath(std::uint64_t key) const;
+
+        /// @brief Context strings are read lazily, GL context doesn't have to exist when cache is created
+        std::uint64_t contextHash();
+    };
+}
@@ -1,5 +1,10 @@
 ﻿#include "ProgramLoader.h"
 
+#include <Foundation/Timer.h>
+#include <Graphics/ShaderFeatures.h>
+
+#include <utility>
+
 namespace BGLRenderer
 {
     ProgramLoader::ProgramLoader(const std::shared_ptr<AssetContentLoader>& contentLoader) :
@@ -7,48 +12,454 @@ namespace BGLRenderer
     {
     }
 
-    std::shared_ptr<OpenGLProgram> ProgramLoader::load(const std::string& vertexShaderName, const std::string& fragmentShaderName)
+    std::shared_ptr<OpenGLProgram> ProgramLoader::load(const std::string& vertexShaderName, const std::string& fragmentShaderName,
+                                                       std::uint32_t featureMask)
     {
-        std::string vertexShaderCode = loadShaderSourceCode(vertexShaderName);
-        std::string fragmentShaderCode = loadShaderSourceCode(fragmentShaderName);
+        HighResolutionTimer loadTimer;
+
+        std::string vertexShaderCode = loadShaderSourceCode(vertexShaderName, featureMask);
+        std::string fragmentShaderCode = loadShaderSourceCode(fragmentShaderName, featureMask);
+
+        std::string programName = std::format("{}+{}", vertexShaderName, fragmentShaderName);
+        if (featureMask != 0)
+        {
+            programName += std::format("#{:x}", featureMask);
+        }
+
+        std::shared_ptr<OpenGLProgram> program;
+
+        if (!OpenGLProgram::binariesSupported())
+        {
+            program = std::make_shared<OpenGLProgram>(programName, vertexShaderCode, fragmentShaderCode);
+        }
+        else
+        {
+            std::uint64_t binaryKey = _binaryCache.key(vertexShaderCode, fragmentShaderCode);
+            OpenGLProgramBinary binary;
+
+            if (_binaryCache.load(binaryKey, binary))
+            {
+                program = std::make_shared<OpenGLProgram>(programName, vertexShaderCode, fragmentShaderCode, binary);
+
+                if (!program->loadedFromBinary())
+                {
+                    _binaryCache.reject(binaryKey);
+                }
+            }
+            else
+            {
+                program = std::make_shared<OpenGLProgram>(programName, vertexShaderCode, fragmentShaderCode);
+            }
+        }
+
+        _loadedPrograms.push_back({program, vertexShaderName, fragmentShaderName});
+
+        // binary is stored once the link is done
+        if (program->hasPendingLink())
+        {
+            _pendingPrograms.push_back(program);
+        }
+
+        double loadTime = loadTimer.elapsedMilliseconds();
+        _totalLoadTime += loadTime;
+
+        _logger.debug("Program \"{}\" {} in {:.2f} ms", programName,
+                      program->loadedFromBinary() ? "loaded from binary" : "submitted", loadTime);
 
-        std::shared_ptr<OpenGLProgram> program = std::make_shared<OpenGLProgram>(std::format("{}+{}", vertexShaderName, fragmentShaderName), vertexShaderCode, fragmentShaderCode);
         return program;
     }
 
-    bool ProgramLoader::tryToUpdateVertexShader(const std::shared_ptr<OpenGLProgram>& program, const std::string& shaderName)
+    std::shared_ptr<OpenGLProgram> ProgramLoader::loadStage(const std::string& shaderName)
     {
-        std::string compiledShaderSource = loadShaderSourceCode(shaderName);
+        HighResolutionTimer loadTimer;
+
+        std::filesystem::path extension = std::filesystem::path(shaderName).extension();
+        GLenum stage = extension == ".vert" ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER;
 
-        if (compiledShaderSource.empty())
+        if (extension != ".vert" && extension != ".frag")
         {
-            return false;
+            _logger.error("Cannot deduce stage of \"{}\", expected \".vert\" or \".frag\" extension", shaderName);
+        }
+
+        std::string shaderCode = loadShaderSourceCode(shaderName);
+        std::shared_ptr<OpenGLProgram> program = std::make_shared<OpenGLProgram>(shaderName, stage, shaderCode);
+
+        if (stage == GL_VERTEX_SHADER)
+        {
+            _loadedPrograms.push_back({program, shaderName, {}});
+        }
+        else
+        {
+            _loadedPrograms.push_back({program, {}, shaderName});
+        }
+
+        _pendingPrograms.push_back(program);
+
+        double loadTime = loadTimer.elapsedMilliseconds();
+        _totalLoadTime += loadTime;
+
+        _logger.debug("Program stage \"{}\" submitted in {:.2f} ms", shaderName, loadTime);
+
+        return program;
+    }
+
+    void ProgramLoader::tick()
+    {
+        // every file changed since the last tick is already invalidated, so each program is relinked once
+        if (_reloadRequested)
+        {
+            reloadChangedPrograms();
+        }
+
+        if (_pendingPrograms.empty())
+        {
+            return;
+        }
+
+        HighResolutionTimer tickTimer;
+
+        // without completion status every poll blocks, so only a few links are completed per frame
+        const bool parallelCompile = OpenGLProgram::parallelCompileSupported();
+        std::size_t blockingLinks = 0;
+
+        // linked publisher may load other programs, those are appended to the emptied list
+        std::vector<std::weak_ptr<OpenGLProgram>> pendingPrograms = std::exchange(_pendingPrograms, {});
+
+        std::erase_if(pendingPrograms, [&](const std::weak_ptr<OpenGLProgram>& pendingProgram)
+        {
+            std::shared_ptr<OpenGLProgram> program = pendingProgram.lock();
+            if (program == nullptr)
+            {
+                return true;
+            }
+
+            if (!parallelCompile && program->hasPendingLink())
+            {
+                if (blockingLinks == blockingLinksPerTick)
+                {
+                    return false;
+                }
+
+                blockingLinks++;
+            }
+
+            if (!program->pollLink())
+            {
+                return false;
+            }
+
+            programLinkDone(program);
+            return true;
+        });
+
+        _pendingPrograms.insert(_pendingPrograms.begin(), pendingPrograms.begin(), pendingPrograms.end());
+
+        _totalLoadTime += tickTimer.elapsedMilliseconds();
+    }
+
+    void ProgramLoader::finishPendingPrograms()
+    {
+        HighResolutionTimer finishTimer;
+
+        while (!_pendingPrograms.empty())
+        {
+            std::vector<std::weak_ptr<OpenGLProgram>> pendingPrograms = std::exchange(_pendingPrograms, {});
+
+            for (const std::weak_ptr<OpenGLProgram>& pendingProgram: pendingPrograms)
+            {
+                if (std::shared_ptr<OpenGLProgram> program = pendingProgram.lock())
+                {
+                    program->finishLink();
+                    programLinkDone(program);
+                }
+            }
+        }
+
+        _totalLoadTime += finishTimer.elapsedMilliseconds();
+    }
+
+    void ProgramLoader::programLinkDone(const std::shared_ptr<OpenGLProgram>& program)
+    {
+        if (program->isSeparable())
+        {
+            return;
+        }
+
+        OpenGLProgramBinary binary;
+
+        // sources are the ones which were linked, so the key matches the next load of the same program
+        if (program->getBinary(binary))
+        {
+            _binaryCache.store(_binaryCache.key(program->vertexShaderCode(), program->fragmentShaderCode()), binary);
+        }
+    }
+
+    void ProgramLoader::shaderFileChanged(const std::filesystem::path& path)
+    {
+        std::string changedKey = shaderFileKey(path);
+
+        // walk reversed include graph, so files which include the changed one indirectly are found as well
+        std::unordered_set<std::string> changedFiles;
+        std::vector<std::string> filesToVisit{changedKey};
+
+        while (!filesToVisit.empty())
+        {
+            std::string key = std::move(filesToVisit.back());
+            filesToVisit.pop_back();
+
+            if (!changedFiles.insert(key).second)
+            {
+                continue;
+            }
+
+            auto it = _includedBy.find(key);
+            if (it != _includedBy.end())
+            {
+                filesToVisit.insert(filesToVisit.end(), it->second.begin(), it->second.end());
+            }
+        }
+
+        for (const std::string& key: changedFiles)
+        {
+            forgetPreprocessedFile(key);
+        }
+
+        for (LoadedProgram& loadedProgram: _loadedPrograms)
+        {
+            if (changedFiles.contains(shaderFileKey(loadedProgram.vertexShaderName)) ||
+                changedFiles.contains(shaderFileKey(loadedProgram.fragmentShaderName)))
+            {
+                loadedProgram.reloadRequested = true;
+                _reloadRequested = true;
+            }
         }
 
-        return program->tryToUpdateVertexShader(compiledShaderSource);
+        _logger.debug("Shader file \"{}\" changed, {} dependent file(s) invalidated", changedKey, changedFiles.size() - 1);
     }
 
-    bool ProgramLoader::tryToUpdateFragmentShader(const std::shared_ptr<OpenGLProgram>& program, const std::string& shaderName)
+    std::vector<std::string> ProgramLoader::takeDiscoveredShaderFiles()
     {
-        std::string compiledShaderSource = loadShaderSourceCode(shaderName);
+        return std::exchange(_discoveredShaderFiles, {});
+    }
+
+    void ProgramLoader::reloadChangedPrograms()
+    {
+        _reloadRequested = false;
+
+        std::erase_if(_loadedPrograms, [](const LoadedProgram& loadedProgram)
+        {
+            return loadedProgram.program.expired();
+        });
+
+        int submittedCount = 0;
 
-        if (compiledShaderSource.empty())
+        for (LoadedProgram& loadedProgram: _loadedPrograms)
+        {
+            if (!loadedProgram.reloadRequested)
+            {
+                continue;
+            }
+
+            loadedProgram.reloadRequested = false;
+            std::shared_ptr<OpenGLProgram> program = loadedProgram.program.lock();
+
+            // unchanged includes come from the cache, only invalidated files are read again
+            std::string vertexShaderCode;
+            if (!loadedProgram.vertexShaderName.empty())
+            {
+                vertexShaderCode = loadShaderSourceCode(loadedProgram.vertexShaderName, program->featureMask());
+
+                if (vertexShaderCode.empty())
+                {
+                    continue;
+                }
+            }
+
+            std::string fragmentShaderCode;
+            if (!loadedProgram.fragmentShaderName.empty())
+            {
+                fragmentShaderCode = loadShaderSourceCode(loadedProgram.fragmentShaderName, program->featureMask());
+
+                if (fragmentShaderCode.empty())
+                {
+                    continue;
+                }
+            }
+
+            // programs with pending link are already tracked
+            const bool tracked = program->hasPendingLink();
+
+            if (!program->tryToUpdateShaders(vertexShaderCode, fragmentShaderCode))
+            {
+                continue;
+            }
+
+            if (!tracked)
+            {
+                _pendingPrograms.push_back(program);
+            }
+
+            submittedCount++;
+        }
+
+        _logger.debug("Submitted relink of {} program(s)", submittedCount);
+    }
+
+    std::string ProgramLoader::shaderFileKey(const std::filesystem::path& path)
+    {
+        return path.lexically_normal().generic_string();
+    }
+
+    bool ProgramLoader::isPreprocessedFileUpToDate(const std::string& key, std::unordered_set<std::string>& visited)
+    {
+        // cached graph is acyclic, but checking every file once is also cheaper for shared includes
+        if (!visited.insert(key).second)
+        {
+            return true;
+        }
+
+        auto it = _preprocessedFiles.find(key);
+        if (it == _preprocessedFiles.end())
         {
             return false;
         }
 
-        return program->tryToUpdateFragmentShader(compiledShaderSource);
+        if (!_contentLoader->fileExists(key) || _contentLoader->getLastWriteTime(key) != it->second.writeTime)
+        {
+            return false;
+        }
+
+        return std::ranges::all_of(it->second.includes, [&](const std::string& include)
+        {
+            return isPreprocessedFileUpToDate(include, visited);
+        });
+    }
+
+    void ProgramLoader::forgetPreprocessedFile(const std::string& key)
+    {
+        auto it = _preprocessedFiles.find(key);
+        if (it == _preprocessedFiles.end())
+        {
+            return;
+        }
+
+        for (const std::string& include: it->second.includes)
+        {
+            _includedBy[include].erase(key);
+        }
+
+        _preprocessedFiles.erase(it);
     }
 
     std::string ProgramLoader::loadShaderSourceCode(const std::filesystem::path& shaderName)
     {
-        std::vector<std::uint8_t> shaderContent = _contentLoader->load(shaderName);
+        std::string source;
+        tryLoadShaderSourceCode(shaderName, source);
+
+        return source;
+    }
+
+    bool ProgramLoader::tryLoadShaderSourceCode(const std::filesystem::path& shaderName, std::string& source)
+    {
+        std::string key = shaderFileKey(shaderName);
+
+        std::unordered_set<std::string> visited;
+        if (isPreprocessedFileUpToDate(key, visited))
+        {
+            _preprocessorStats.cacheHits++;
+            source = _preprocessedFiles[key].source;
+            return true;
+        }
+
+        if (std::ranges::find(_includeStack, key) != _includeStack.end())
+        {
+            _logger.error("Include cycle detected, \"{}\" is already being expanded", key);
+            return false;
+        }
+
+        // files which failed to load aren't cached, so they are read again once they exist
+        if (!_contentLoader->fileExists(key))
+        {
+            _logger.error("Shader file \"{}\" doesn't exist", key);
+            return false;
+        }
+
+        PreprocessedShaderFile preprocessedFile{};
+        preprocessedFile.writeTime = _contentLoader->getLastWriteTime(key);
+
+        std::vector<std::uint8_t> shaderContent = _contentLoader->load(key);
         std::string shaderContentString = std::string(shaderContent.begin(), shaderContent.end());
 
-        return compileShaderSourceCode(shaderContentString, shaderName.parent_path());
+        bool includesLoaded = true;
+        _includeStack.push_back(key);
+        preprocessedFile.source = compileShaderSourceCode(shaderContentString, std::filesystem::path(key).parent_path(),
+                                                          preprocessedFile.includes, includesLoaded);
+        _includeStack.pop_back();
+
+        _preprocessorStats.filesPreprocessed++;
+
+        // edges of the previous version may point to files which are no longer included
+        if (_preprocessedFiles.contains(key))
+        {
+            forgetPreprocessedFile(key);
+        }
+
+        if (_knownShaderFiles.insert(key).second)
+        {
+            _discoveredShaderFiles.push_back(key);
+        }
+
+        // incomplete source isn't cached, it's preprocessed again (and reports the error) until includes are fixed
+        if (!includesLoaded)
+        {
+            source = std::move(preprocessedFile.source);
+            return false;
+        }
+
+        for (const std::string& include: preprocessedFile.includes)
+        {
+            _includedBy[include].insert(key);
+        }
+
+        auto [it, inserted] = _preprocessedFiles.insert_or_assign(key, std::move(preprocessedFile));
+        (void)inserted;
+
+        source = it->second.source;
+        return true;
     }
 
-    std::string ProgramLoader::compileShaderSourceCode(const std::string& inputCode, const std::filesystem::path& includeFileDirectory)
+    std::string ProgramLoader::loadShaderSourceCode(const std::filesystem::path& shaderName, std::uint32_t featureMask)
+    {
+        std::string source = loadShaderSourceCode(shaderName);
+
+        if (!source.empty())
+        {
+            injectFeatureDefines(source, featureMask);
+        }
+
+        return source;
+    }
+
+    void ProgramLoader::injectFeatureDefines(std::string& source, std::uint32_t featureMask)
+    {
+        if (featureMask == 0)
+        {
+            return;
+        }
+
+        // defines have to follow "#version", which must be the first directive in the shader
+        std::size_t insertPosition = 0;
+        if (source.starts_with("#version"))
+        {
+            std::size_t versionLineEnd = source.find('\n');
+            insertPosition = versionLineEnd == std::string::npos ? source.length() : versionLineEnd + 1;
+        }
+
+        source.insert(insertPosition, shaderFeatureDefines(featureMask));
+    }
+
+    std::string ProgramLoader::compileShaderSourceCode(const std::string& inputCode, const std::filesystem::path& includeFileDirectory,
+                                                       std::vector<std::string>& includes, bool& includesLoaded)
     {
         std::size_t lineStart = 0;
         std::uint32_t lineNumber = 0;
@@ -73,13 +484,21 @@ namespace BGLRenderer
                 {
                     std::filesystem::path includePath = includeFileDirectory / parseIncludeDirectiveLine(line, lineNumber);
 
+                    std::string includeFileCompiledSource;
+
                     if (includePath.empty())
                     {
                         _logger.error("Failed to parse include directive at line {}", lineNumber);
+                        includesLoaded = false;
+                    }
+                    else if (!tryLoadShaderSourceCode(includePath, includeFileCompiledSource))
+                    {
+                        // edge of a missing or cyclic include would make the cached graph lie
+                        includesLoaded = false;
                     }
                     else
                     {
-                        std::string includeFileCompiledSource = loadShaderSourceCode(includePath);
+                        includes.push_back(shaderFileKey(includePath));
 
                         result += std::format("/// MARK - begin of \"{}\" include file\n", includePath.string());
                         result += includeFileCompiledSource;
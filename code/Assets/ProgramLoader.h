@@ -1,29 +1,125 @@
 ﻿#pragma once
 
 #include "AssetContentLoader.h"
+#include "ProgramBinaryCache.h"
 #include <Graphics/Resources/OpenGLProgram.h>
 
+#include <unordered_set>
+
 namespace BGLRenderer
 {
+    struct ShaderPreprocessorStats
+    {
+        int filesPreprocessed = 0;
+        int cacheHits = 0;
+    };
+
     class ProgramLoader
     {
     public:
         ProgramLoader(const std::shared_ptr<AssetContentLoader>& contentLoader);
         ~ProgramLoader() = default;
 
-        std::shared_ptr<OpenGLProgram> load(const std::string& vertexShaderName, const std::string& fragmentShaderName);
+        /// @brief Every ShaderFeature in the mask is defined in both stages right after "#version" line.
+        /// Programs which aren't loaded from binary cache are returned pending, tick completes them
+        std::shared_ptr<OpenGLProgram> load(const std::string& vertexShaderName, const std::string& fragmentShaderName,
+                                            std::uint32_t featureMask = 0);
+
+        /// @brief Loads separable program with one stage, stage type is taken from the extension (".vert" or ".frag").
+        /// Stages aren't stored in the binary cache, single stage compiles are cheap compared to full links
+        std::shared_ptr<OpenGLProgram> loadStage(const std::string& shaderName);
+
+        /// @brief Drops preprocessed sources of the file and of every file including it, loaded programs
+        /// built from them are reloaded together on the next tick
+        void shaderFileChanged(const std::filesystem::path& path);
+
+        /// @brief Returns shader and include files preprocessed for the first time since the last call,
+        /// so the caller can start observing them
+        std::vector<std::string> takeDiscoveredShaderFiles();
 
-        bool tryToUpdateVertexShader(const std::shared_ptr<OpenGLProgram>& program, const std::string& shaderName);
-        bool tryToUpdateFragmentShader(const std::shared_ptr<OpenGLProgram>& program, const std::string& shaderName);
+        /// @brief Submits relinks of changed programs and completes programs whose links are done.
+        /// Without parallel compile support it waits only for a few of them per call
+        void tick();
+
+        /// @brief Waits for every submitted link
+        void finishPendingPrograms();
+
+        inline std::size_t pendingProgramsCount() const { return _pendingPrograms.size(); }
+
+        inline const ProgramBinaryCacheStats& binaryCacheStats() const { return _binaryCache.stats(); }
+        inline const ShaderPreprocessorStats& preprocessorStats() const { return _preprocessorStats; }
+
+        /// @brief Time spent in creating programs (reading, preprocessing, submitting and completing links or loading binaries)
+        inline double totalLoadTimeMilliseconds() const { return _totalLoadTime; }
 
     private:
         Log _logger{"ProgramLoader"};
 
         std::shared_ptr<AssetContentLoader> _contentLoader;
+        ProgramBinaryCache _binaryCache;
+        double _totalLoadTime = 0.0;
+
+        static constexpr std::size_t blockingLinksPerTick = 1;
+
+        // programs aren't kept alive by the loader, released ones are dropped on the next tick
+        std::vector<std::weak_ptr<OpenGLProgram>> _pendingPrograms;
+
+        void programLinkDone(const std::shared_ptr<OpenGLProgram>& program);
+
+        /// @brief Expanded source of a shader or include file without feature defines, valid while the file
+        /// and all of its includes keep their write times
+        struct PreprocessedShaderFile
+        {
+            std::string source;
+            std::filesystem::file_time_type writeTime;
+            std::vector<std::string> includes;
+        };
+
+        std::unordered_map<std::string, PreprocessedShaderFile> _preprocessedFiles;
+
+        // reversed include graph, file -> files with "#include" directive pointing to it
+        std::unordered_map<std::string, std::unordered_set<std::string>> _includedBy;
+
+        // files which are being expanded right now, guards against include cycles
+        std::vector<std::string> _includeStack;
+
+        std::vector<std::string> _discoveredShaderFiles;
+        // every file reported through _discoveredShaderFiles, files which failed to preprocess aren't cached
+        // and would be reported again
+        std::unordered_set<std::string> _knownShaderFiles;
+        ShaderPreprocessorStats _preprocessorStats{};
+
+        /// @brief Separable stages have only one of shader names
+        struct LoadedProgram
+        {
+            std::weak_ptr<OpenGLProgram> program;
+            std::string vertexShaderName;
+            std::string fragmentShaderName;
+            bool reloadRequested = false;
+        };
+
+        std::vector<LoadedProgram> _loadedPrograms;
+        bool _reloadRequested = false;
+
+        void reloadChangedPrograms();
+
+        static std::string shaderFileKey(const std::filesystem::path& path);
+        /// @brief Visited files are skipped, so a broken graph can't recurse forever
+        bool isPreprocessedFileUpToDate(const std::string& key, std::unordered_set<std::string>& visited);
+        void forgetPreprocessedFile(const std::string& key);
 
         std::string loadShaderSourceCode(const std::filesystem::path& shaderName);
+        std::string loadShaderSourceCode(const std::filesystem::path& shaderName, std::uint32_t featureMask);
+
+        /// @brief Returns false when the file or any of its includes is missing or forms a cycle,
+        /// such file isn't cached and source contains only what could be expanded
+        bool tryLoadShaderSourceCode(const std::filesystem::path& shaderName, std::string& source);
+
+        static void injectFeatureDefines(std::string& source, std::uint32_t featureMask);
 
-        std::string compileShaderSourceCode(const std::string& code, const std::filesystem::path& includeFileDirectory);
+        /// @brief Only includes that were expanded are recorded, includesLoaded is cleared when any of them failed
+        std::string compileShaderSourceCode(const std::string& code, const std::filesystem::path& includeFileDirectory,
+                                            std::vector<std::string>& includes, bool& includesLoaded);
         std::string_view parseIncludeDirectiveLine(const std::string_view& line, std::uint32_t lineNumber);
     };
 
@@ -0,0 +1,79 @@
+﻿#include <Foundation/FrameArena.h>
+#include <Foundation/JobSystem.h>
+#include <Foundation/Timer.h>
+#include <Graphics/FrustumCulling.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace BGLRenderer;
+
+/// @brief Average milliseconds of one cull over iterations, first run warms up caches and workers
+static double measureCulling(const FrustumCuller& culler, const Frustum& frustum, FrameVector<std::uint8_t>& visibility,
+                             JobSystem* jobSystem, int iterations)
+{
+    culler.cull(frustum, visibility, jobSystem);
+
+    HighResolutionTimer timer;
+    for (int i = 0; i < iterations; ++i)
+    {
+        culler.cull(frustum, visibility, jobSystem);
+    }
+
+    return timer.elapsedMilliseconds() / iterations;
+}
+
+static std::size_t countVisible(const FrameVector<std::uint8_t>& visibility)
+{
+    std::size_t visible = 0;
+    for (std::uint8_t value: visibility)
+    {
+        visible += value;
+    }
+
+    return visible;
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t sphereCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    constexpr int iterations = 50;
+
+    // spheres surround the camera, so most of them end up outside of the frustum like in a big scene
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const Frustum frustum = Frustum::fromViewProjection(projection * view);
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-300.0f, 300.0f);
+    std::uniform_real_distribution<float> radius(0.1f, 2.0f);
+
+    FrustumCuller culler;
+    culler.reserve(sphereCount);
+    for (std::size_t i = 0; i < sphereCount; ++i)
+    {
+        culler.addSphere({position(random), position(random), position(random)}, radius(random));
+    }
+
+    FrameVector<std::uint8_t> serialVisibility;
+    FrameVector<std::uint8_t> parallelVisibility;
+
+    JobSystem jobSystem;
+
+    const double serialTime = measureCulling(culler, frustum, serialVisibility, nullptr, iterations);
+    const double parallelTime = measureCulling(culler, frustum, parallelVisibility, &jobSystem, iterations);
+
+    if (serialVisibility != parallelVisibility)
+    {
+        std::fprintf(stderr, "Serial and parallel culling results differ\n");
+        return 1;
+    }
+
+    std::printf("Frustum culling of %zu spheres (%zu visible), %u workers, chunk %zu\n", sphereCount,
+                countVisible(serialVisibility), jobSystem.workerCount(), FrustumCuller::parallelChunkSize);
+    std::printf("  serial:      %8.3f ms\n", serialTime);
+    std::printf("  parallelFor: %8.3f ms (%.2fx)\n", parallelTime, serialTime / parallelTime);
+
+    return 0;
+}
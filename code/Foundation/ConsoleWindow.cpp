@@ -2,6 +2,8 @@
 
 #include <imgui.h>
 
+#include <iterator>
+
 #include "Log.h"
 
 namespace BGLRenderer
@@ -41,6 +43,17 @@ namespace BGLRenderer
         // FIXME:
         static char filterBuffer[256] = {};
 
+        {
+            std::lock_guard lock(_pendingMessagesMutex);
+            if (!_pendingMessages.empty())
+            {
+                _messages.insert(_messages.end(), std::make_move_iterator(_pendingMessages.begin()),
+                                 std::make_move_iterator(_pendingMessages.end()));
+                _pendingMessages.clear();
+                _scrollToBottom = true;
+            }
+        }
+
         if (ImGui::Begin("Console", &showConsole))
         {
             if (ImGui::Button("Clear"))
@@ -99,7 +112,7 @@ namespace BGLRenderer
 
     void ConsoleWindow::write(const LogMessage& message)
     {
-        _messages.push_back(message);
-        _scrollToBottom = true;
+        std::lock_guard lock(_pendingMessagesMutex);
+        _pendingMessages.push_back(message);
     }
 }
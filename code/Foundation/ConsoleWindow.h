@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -7,6 +8,7 @@
 
 namespace BGLRenderer
 {
+    /// @brief Messages can be written from any thread, they are shown once onIMGUI takes them on the main thread
     class ConsoleWindow
     {
     public:
@@ -18,7 +20,11 @@ namespace BGLRenderer
         void write(const LogMessage& message);
 
     private:
+        // only touched by the main thread, other threads append to the pending list
         std::vector<LogMessage> _messages;
+
+        std::mutex _pendingMessagesMutex;
+        std::vector<LogMessage> _pendingMessages;
         bool _scrollToBottom = false;
         bool _showErrorsOnly = false;
     };
@@ -1,15 +1,25 @@
 ﻿#include "Engine.h"
 
+#include <Graphics/OpenGLDeletionQueue.h>
+
 #include <backends/imgui_impl_sdl.h>
 #include <backends/imgui_impl_opengl3.h>
 
 #include <iostream>
 #include <functional>
+#include <string_view>
 
 namespace BGLRenderer
 {
-    Engine::Engine([[maybe_unused]] int argc, [[maybe_unused]] char** argv)
+    Engine::Engine(int argc, char** argv)
     {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::string_view(argv[i]) == "--render-thread")
+            {
+                _renderThreadEnabled = true;
+            }
+        }
     }
 
     Engine::~Engine()
@@ -18,6 +28,8 @@ namespace BGLRenderer
 
     int Engine::run()
     {
+        HighResolutionTimer startupTimer;
+
         Log::listen([](const LogMessage& logMessage)
         {
             std::cout << LogUtils::getLogMessagePrefix(logSeverityToCString(logMessage.severity),
@@ -26,6 +38,9 @@ namespace BGLRenderer
 
         _consoleWindow = std::make_shared<ConsoleWindow>();
 
+        _jobSystem = std::make_shared<JobSystem>();
+        _logger.debug("Job system started with {} workers", _jobSystem->workerCount());
+
         _input = std::make_shared<Input>();
         _window = std::make_shared<SDLWindow>(1920, 1080);
         _window->setOnSDLEventCallback([&](const SDL_Event* ev)
@@ -37,10 +52,15 @@ namespace BGLRenderer
         _assetContentLoader = std::make_shared<AssetContentLoader>();
         _assetManager = std::make_shared<AssetManager>(_assetContentLoader);
 
-        _renderer = std::make_shared<OpenGLRenderer>(_assetManager, 1920, 1080);
+        _renderer = std::make_shared<OpenGLRenderer>(_assetManager, _jobSystem, 1920, 1080);
         _window->setOnWindowResizedCallback([&](int width, int height)
         {
-            _renderer->resizeFrame(width, height);
+            // render thread resizes frame buffers when it gets the first packet with the new size
+            if (!_renderThread.joinable())
+            {
+                _renderer->resizeFrame(width, height);
+            }
+
             _application->onWindowResize(width, height);
         });
 
@@ -48,6 +68,15 @@ namespace BGLRenderer
 
         _application->onInit();
 
+        const ProgramBinaryCacheStats& programCacheStats = _assetManager->programLoader()->binaryCacheStats();
+        _logger.debug("Startup took {:.1f} ms, programs: {:.1f} ms (binary cache hits: {}, misses: {}, rejected: {})",
+                      startupTimer.elapsedMilliseconds(), _assetManager->programLoader()->totalLoadTimeMilliseconds(),
+                      programCacheStats.hits, programCacheStats.misses, programCacheStats.rejected);
+
+        const ShaderPreprocessorStats& preprocessorStats = _assetManager->programLoader()->preprocessorStats();
+        _logger.debug("Shader files preprocessed: {}, reused from cache: {}", preprocessorStats.filesPreprocessed,
+                      preprocessorStats.cacheHits);
+
         HighResolutionTimer frameTimer;
         HighResolutionTimer renderTimer;
         HighResolutionTimer imguiTimer;
@@ -55,6 +84,12 @@ namespace BGLRenderer
         double fpsTimer = 0.0;
         int fpsCounter = 0;
 
+        if (_renderThreadEnabled)
+        {
+            startRenderThread();
+            _logger.debug("Rendering on separate thread, {} frames in flight", framesInFlight);
+        }
+
         _appTimer.restart();
         while (!_window->exitRequested())
         {
@@ -71,18 +106,45 @@ namespace BGLRenderer
             }
 
             frameTimer.restart();
+            const std::uint64_t logMessagesAtFrameStart = Log::writtenMessages();
 
             _input->startFrame();
             _window->processEvents();
 
             _application->onUpdate(static_cast<float>(deltaTime));
-            _assetManager->tick();
 
             if (_input->keyboard()->getKeyDown(SDLK_BACKQUOTE))
             {
                 _showConsoleWindow = !_showConsoleWindow;
             }
 
+            if (_renderThread.joinable())
+            {
+                // waits only when the render thread is still busy with both previous frames
+                EngineFramePacket* packet = _renderedFrames.pop();
+                _profilerData.renderTime = packet->renderTime;
+
+                packet->render.frameWidth = _window->width();
+                packet->render.frameHeight = _window->height();
+
+                _renderer->beginPacket(packet->render);
+                _application->onRender(_renderer);
+                _renderer->endPacket();
+
+                imguiTimer.restart();
+                buildImguiFrame();
+                packet->imgui.capture(ImGui::GetDrawData());
+                _profilerData.imguiTime = imguiTimer.elapsedMilliseconds();
+
+                _recordedFrames.push(packet);
+
+                _profilerData.totalFrameTime = frameTimer.elapsedMilliseconds();
+                _profilerData.logMessages = static_cast<std::uint32_t>(Log::writtenMessages() - logMessagesAtFrameStart);
+                continue;
+            }
+
+            _assetManager->tick();
+
             renderTimer.restart();
             _renderer->beginFrame();
             _application->onRender(_renderer);
@@ -97,6 +159,12 @@ namespace BGLRenderer
             _window->swapBuffers();
 
             _profilerData.totalFrameTime = frameTimer.elapsedMilliseconds();
+            _profilerData.logMessages = static_cast<std::uint32_t>(Log::writtenMessages() - logMessagesAtFrameStart);
+        }
+
+        if (_renderThread.joinable())
+        {
+            stopRenderThread();
         }
 
         _application->onShutdown();
@@ -107,7 +175,10 @@ namespace BGLRenderer
         _assetManager.reset();
         _assetContentLoader.reset();
         _renderer.reset();
+        _jobSystem.reset();
         _input.reset();
+
+        OpenGLDeletionQueue::global().flush();
         _window.reset();
 
         return 0;
@@ -124,10 +195,102 @@ namespace BGLRenderer
             ImGui::Text("Render: %.4fms", _profilerData.renderTime);
             ImGui::Text("ImGui: %.4fms", _profilerData.imguiTime);
 
+            const OpenGLRendererStats& rendererStats = _renderer->stats();
+
+            const RenderQueueStats& queueStats = rendererStats.renderQueue;
+            ImGui::Separator();
+            ImGui::Text("Submitted: %d", queueStats.submitted);
+            ImGui::Text("Culled: %d", queueStats.culled);
+            ImGui::Text("Draw calls: %d", queueStats.drawCalls);
+            ImGui::Text("Instanced: %d draws (%d objects)", queueStats.instancedDrawCalls,
+                        queueStats.instancedObjects);
+            ImGui::Text("Multi draw indirect: %d draws (%d commands)", queueStats.multiDrawCalls,
+                        queueStats.indirectCommands);
+            ImGui::Text("Program binds: %d (skipped %d)", queueStats.programBinds, queueStats.programBindsSkipped);
+            ImGui::Text("Material binds: %d (skipped %d)", queueStats.materialBinds, queueStats.materialBindsSkipped);
+            ImGui::Text("Mesh binds: %d (skipped %d)", queueStats.meshBinds, queueStats.meshBindsSkipped);
+            ImGui::Text("State changes saved: %d", queueStats.stateChangesSkipped());
+
+            const OpenGLStateCacheStats& stateCacheStats = rendererStats.stateCache;
+            ImGui::Text("GL state calls: %d (filtered %d)", stateCacheStats.calls, stateCacheStats.filteredCalls);
+
+            const FrameArenaStats& arenaStats = rendererStats.frameArena;
+            ImGui::Separator();
+            ImGui::Text("Frame arena: %.1f / %.1f KB (peak %.1f KB)", static_cast<double>(arenaStats.used) / 1024.0,
+                        static_cast<double>(arenaStats.capacity) / 1024.0,
+                        static_cast<double>(arenaStats.highWaterMark) / 1024.0);
+            ImGui::Text("Frame arena overflow allocations: %u", arenaStats.overflowAllocations);
+
+            // log messages are formatted into std::string, frames are allocation free only when nothing is logged
+            ImGui::Text("Log messages (heap allocations): %u", _profilerData.logMessages);
+
+            ImGui::Separator();
+            ImGui::Text("Mesh CPU memory released: %.2f MB",
+                        static_cast<double>(OpenGLMesh::releasedCPUMemory()) / (1024.0 * 1024.0));
+            ImGui::Text("Mesh GPU memory: %.2f MB",
+                        static_cast<double>(OpenGLMesh::totalGPUMemory()) / (1024.0 * 1024.0));
+
             ImGui::End();
         }
     }
 
+    void Engine::startRenderThread()
+    {
+        OpenGLDeletionQueue::global().setFramesInFlight(framesInFlight);
+
+        // creates font atlas texture, ImGui::NewFrame on this thread expects it to be built
+        ImGui_ImplOpenGL3_NewFrame();
+
+        for (EngineFramePacket& packet: _framePackets)
+        {
+            _renderedFrames.push(&packet);
+        }
+
+        // context can be current only on one thread at a time
+        SDL_GL_MakeCurrent(_window->sdlWindowHandle(), nullptr);
+        _renderThread = std::thread([this] { renderThreadLoop(); });
+    }
+
+    void Engine::stopRenderThread()
+    {
+        _recordedFrames.push(nullptr);
+        _renderThread.join();
+
+        EngineFramePacket* packet;
+        while (_renderedFrames.tryPop(packet))
+        {
+        }
+
+        SDL_GL_MakeCurrent(_window->sdlWindowHandle(), _window->glContext());
+        OpenGLDeletionQueue::global().setFramesInFlight(0);
+    }
+
+    void Engine::renderThreadLoop()
+    {
+        SDL_GL_MakeCurrent(_window->sdlWindowHandle(), _window->glContext());
+
+        HighResolutionTimer renderTimer;
+
+        // null packet asks the thread to stop
+        while (EngineFramePacket* packet = _recordedFrames.pop())
+        {
+            renderTimer.restart();
+
+            _assetManager->tick();
+            _renderer->renderPacket(packet->render);
+
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplOpenGL3_RenderDrawData(packet->imgui.drawData());
+
+            packet->renderTime = renderTimer.elapsedMilliseconds();
+
+            _window->swapBuffers();
+            _renderedFrames.push(packet);
+        }
+
+        SDL_GL_MakeCurrent(_window->sdlWindowHandle(), nullptr);
+    }
+
     double Engine::secondsSinceStart()
     {
         return _appTimer.elapsedSeconds();
@@ -154,8 +317,14 @@ namespace BGLRenderer
 
     void Engine::tickImgui()
     {
-        ImGui_ImplSDL2_NewFrame();
         ImGui_ImplOpenGL3_NewFrame();
+        buildImguiFrame();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    }
+
+    void Engine::buildImguiFrame()
+    {
+        ImGui_ImplSDL2_NewFrame();
 
         ImGuiIO& io = ImGui::GetIO();
         io.DisplaySize = ImVec2(static_cast<float>(_window->width()), static_cast<float>(_window->height()));
@@ -165,7 +334,6 @@ namespace BGLRenderer
         onIMGUI();
 
         ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     }
 
     void Engine::onIMGUI()
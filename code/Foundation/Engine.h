@@ -2,14 +2,20 @@
 
 #include "Application.h"
 #include "ConsoleWindow.h"
+#include "ImGuiFrameSnapshot.h"
 #include "Input.h"
+#include "JobSystem.h"
 #include "Log.h"
+#include "SPSCQueue.h"
 #include "Timer.h"
 
 #include <Assets/AssetManager.h>
 #include <Graphics/OpenGLRenderer.h>
 #include <Platform/SDLWindow.h>
 
+#include <array>
+#include <thread>
+
 namespace BGLRenderer
 {
     struct EngineProfilerData
@@ -18,6 +24,19 @@ namespace BGLRenderer
         double renderTime = 0.0;
         double imguiTime = 0.0;
         int fps = 0;
+
+        /// @brief Messages logged during the last frame, each one allocates outside of the frame arena
+        std::uint32_t logMessages = 0;
+    };
+
+    /// @brief Frame recorded by the main thread and drawn by the render thread
+    struct EngineFramePacket
+    {
+        FramePacket render;
+        ImGuiFrameSnapshot imgui;
+
+        /// @brief Time the render thread spent on the packet, read when the packet is recorded again
+        double renderTime = 0.0;
     };
 
     class Engine
@@ -37,7 +56,15 @@ namespace BGLRenderer
 
         double secondsSinceStart();
 
+        /// @brief Render thread owns the context after onInit and draws frame N while the main thread updates
+        /// and records frame N + 1. Application must not touch GL, load assets or modify resources used by
+        /// in flight frames after onInit, resources dropped by it should go through OpenGLDeletionQueue::retire.
+        /// Enabled with --render-thread, has to be set before run
+        inline void setRenderThreadEnabled(bool enabled) { _renderThreadEnabled = enabled; }
+        inline bool isRenderThreadEnabled() const { return _renderThreadEnabled; }
+
         inline const std::shared_ptr<Input>& input() const { return _input; }
+        inline const std::shared_ptr<JobSystem>& jobs() const { return _jobSystem; }
         inline const std::shared_ptr<AssetManager>& assets() const { return _assetManager; }
         inline const std::shared_ptr<OpenGLRenderer>& renderer() const { return _renderer; }
         inline const std::shared_ptr<SDLWindow>& window() const { return _window; }
@@ -52,6 +79,7 @@ namespace BGLRenderer
         Log _logger{"Engine"};
 
         std::shared_ptr<SDLWindow> _window = nullptr;
+        std::shared_ptr<JobSystem> _jobSystem = nullptr;
         std::shared_ptr<OpenGLRenderer> _renderer = nullptr;
         std::shared_ptr<AssetContentLoader> _assetContentLoader = nullptr;
         std::shared_ptr<AssetManager> _assetManager = nullptr;
@@ -65,11 +93,24 @@ namespace BGLRenderer
         bool _showStatsWindow = false;
         bool _showConsoleWindow = false;
 
+        static constexpr std::size_t framesInFlight = 2;
+
+        bool _renderThreadEnabled = false;
+        std::thread _renderThread;
+        std::array<EngineFramePacket, framesInFlight> _framePackets;
+        SPSCQueue<EngineFramePacket*, framesInFlight> _recordedFrames;
+        SPSCQueue<EngineFramePacket*, framesInFlight> _renderedFrames;
+
         void statsWindow();
 
+        void startRenderThread();
+        void stopRenderThread();
+        void renderThreadLoop();
+
         void initImgui();
         void shutdownImgui();
         void tickImgui();
+        void buildImguiFrame();
 
         void onIMGUI();
 
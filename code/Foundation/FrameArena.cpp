@@ -0,0 +1,114 @@
+﻿#include "FrameArena.h"
+
+#include <algorithm>
+#include <bit>
+#include <new>
+
+namespace BGLRenderer
+{
+    // every overflow allocation uses the same alignment, so it can be released without knowing the requested one
+    static constexpr std::size_t overflowAlignment = 64;
+
+    FrameArena::FrameArena(std::size_t capacity)
+    {
+        for (Buffer& buffer: _buffers)
+        {
+            buffer.memory = std::make_unique<std::byte[]>(capacity);
+            buffer.capacity = capacity;
+        }
+
+        _stats.capacity = capacity;
+    }
+
+    FrameArena::~FrameArena()
+    {
+        for (Buffer& buffer: _buffers)
+        {
+            releaseOverflow(buffer);
+        }
+    }
+
+    FrameArena& FrameArena::global()
+    {
+        static FrameArena arena;
+        return arena;
+    }
+
+    void FrameArena::beginFrame()
+    {
+        _current = (_current + 1) % _buffers.size();
+        _lastAllocation = nullptr;
+
+        Buffer& buffer = _buffers[_current];
+        reset(buffer);
+
+        _stats.capacity = buffer.capacity;
+        _stats.used = 0;
+        _stats.overflowAllocations = 0;
+    }
+
+    void* FrameArena::allocate(std::size_t size, std::size_t alignment)
+    {
+        Buffer& buffer = _buffers[_current];
+
+        std::size_t alignedOffset = (buffer.offset + alignment - 1) & ~(alignment - 1);
+        buffer.requested += size + (alignedOffset - buffer.offset);
+        _stats.highWaterMark = std::max(_stats.highWaterMark, buffer.requested);
+
+        if (alignedOffset + size > buffer.capacity)
+        {
+            ASSERT(alignment <= overflowAlignment, "Frame arena doesn't support alignment that big");
+
+            void* pointer = ::operator new(size, std::align_val_t(overflowAlignment));
+            buffer.overflow.push_back(pointer);
+            _stats.overflowAllocations++;
+            return pointer;
+        }
+
+        buffer.offset = alignedOffset + size;
+        _stats.used = buffer.offset;
+
+        _lastAllocation = buffer.memory.get() + alignedOffset;
+        return _lastAllocation;
+    }
+
+    void FrameArena::deallocate(void* pointer, std::size_t size)
+    {
+        if (pointer == nullptr || pointer != _lastAllocation)
+        {
+            return;
+        }
+
+        Buffer& buffer = _buffers[_current];
+        (void)size;
+
+        // requested size is kept, high-water mark stays on the safe side
+        buffer.offset = static_cast<std::size_t>(static_cast<std::byte*>(pointer) - buffer.memory.get());
+        _stats.used = buffer.offset;
+        _lastAllocation = nullptr;
+    }
+
+    void FrameArena::reset(Buffer& buffer)
+    {
+        // grow once, so the same amount of data fits next time
+        if (!buffer.overflow.empty())
+        {
+            buffer.capacity = std::bit_ceil(buffer.requested);
+            buffer.memory = std::make_unique<std::byte[]>(buffer.capacity);
+        }
+
+        releaseOverflow(buffer);
+        buffer.offset = 0;
+        buffer.requested = 0;
+    }
+
+    void FrameArena::releaseOverflow(Buffer& buffer)
+    {
+        for (void* pointer: buffer.overflow)
+        {
+            ::operator delete(pointer, std::align_val_t(overflowAlignment));
+        }
+
+        buffer.overflow.clear();
+    }
+}
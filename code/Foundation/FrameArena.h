@@ -0,0 +1,128 @@
+﻿#pragma once
+
+#include "Base.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace BGLRenderer
+{
+    struct FrameArenaStats
+    {
+        std::size_t capacity = 0;
+        std::size_t used = 0;
+
+        /// @brief Largest amount of memory requested by single frame, including overflow
+        std::size_t highWaterMark = 0;
+
+        /// @brief Allocations of the current frame that didn't fit and went to the heap
+        std::uint32_t overflowAllocations = 0;
+    };
+
+    /// @brief Double buffered bump allocator for data that lives at most until the end of the next frame.
+    /// beginFrame switches buffers and resets the one used two frames ago, so anything allocated before the
+    /// previous frame must be dropped by then. Allocations that don't fit go to the heap and the buffer is grown
+    /// on its next reset, so steady state frames don't touch the heap. Not thread safe, frame thread only
+    class FrameArena
+    {
+    public:
+        static constexpr std::size_t defaultCapacity = 1024 * 1024;
+
+        explicit FrameArena(std::size_t capacity = defaultCapacity);
+        ~FrameArena();
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        /// @brief Arena used by renderer side transient containers, reset when the renderer starts a frame
+        static FrameArena& global();
+
+        void beginFrame();
+
+        void* allocate(std::size_t size, std::size_t alignment);
+
+        /// @brief Only the last allocation of the current frame is given back (e.g. vector growing in place),
+        /// everything else is released by the reset
+        void deallocate(void* pointer, std::size_t size);
+
+        inline const FrameArenaStats& stats() const { return _stats; }
+
+    private:
+        struct Buffer
+        {
+            std::unique_ptr<std::byte[]> memory;
+            std::size_t capacity = 0;
+            std::size_t offset = 0;
+
+            // bytes requested during the frame, grows past capacity when allocations overflow
+            std::size_t requested = 0;
+            std::vector<void*> overflow;
+        };
+
+        std::array<Buffer, 2> _buffers;
+        std::size_t _current = 0;
+        void* _lastAllocation = nullptr;
+
+        FrameArenaStats _stats;
+
+        void reset(Buffer& buffer);
+        static void releaseOverflow(Buffer& buffer);
+    };
+
+    /// @brief STL allocator adaptor over FrameArena
+    template <class T>
+    class FrameArenaAllocator
+    {
+    public:
+        using value_type = T;
+
+        FrameArenaAllocator() noexcept :
+            _arena(&FrameArena::global())
+        {
+        }
+
+        explicit FrameArenaAllocator(FrameArena& arena) noexcept :
+            _arena(&arena)
+        {
+        }
+
+        template <class U>
+        FrameArenaAllocator(const FrameArenaAllocator<U>& other) noexcept :
+            _arena(other.arena())
+        {
+        }
+
+        inline T* allocate(std::size_t count)
+        {
+            return static_cast<T*>(_arena->allocate(count * sizeof(T), alignof(T)));
+        }
+
+        inline void deallocate(T* pointer, std::size_t count) noexcept
+        {
+            _arena->deallocate(pointer, count * sizeof(T));
+        }
+
+        inline FrameArena* arena() const { return _arena; }
+
+        template <class U>
+        inline bool operator==(const FrameArenaAllocator<U>& other) const { return _arena == other.arena(); }
+
+    private:
+        FrameArena* _arena;
+    };
+
+    template <class T>
+    using FrameVector = std::vector<T, FrameArenaAllocator<T>>;
+
+    /// @brief Drops storage left from the previous frame and reserves room for count elements in the current one,
+    /// persistent FrameVector members have to go through this once per frame
+    template <class T>
+    void resetFrameVector(FrameVector<T>& vector, std::size_t count)
+    {
+        FrameVector<T>().swap(vector);
+        vector.reserve(count);
+    }
+}
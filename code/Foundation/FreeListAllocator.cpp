@@ -0,0 +1,141 @@
+﻿#include "FreeListAllocator.h"
+
+namespace BGLRenderer
+{
+    FreeListAllocator::FreeListAllocator(std::uint32_t capacity) :
+        _capacity(capacity),
+        _totalFree(capacity)
+    {
+        if (capacity > 0)
+        {
+            _freeBlocks[0] = capacity;
+        }
+    }
+
+    std::uint32_t FreeListAllocator::allocate(std::uint32_t size)
+    {
+        if (size == 0)
+        {
+            return invalidOffset;
+        }
+
+        for (auto it = _freeBlocks.begin(); it != _freeBlocks.end(); ++it)
+        {
+            if (it->second < size)
+            {
+                continue;
+            }
+
+            std::uint32_t offset = it->first;
+            std::uint32_t remaining = it->second - size;
+
+            _freeBlocks.erase(it);
+            if (remaining > 0)
+            {
+                _freeBlocks[offset + size] = remaining;
+            }
+
+            _totalFree -= size;
+            return offset;
+        }
+
+        return invalidOffset;
+    }
+
+    void FreeListAllocator::free(std::uint32_t offset, std::uint32_t size)
+    {
+        ASSERT(offset != invalidOffset && offset + size <= _capacity, "Freeing range outside of the allocator");
+
+        if (size == 0)
+        {
+            return;
+        }
+
+        insertFreeBlock(offset, size);
+        _totalFree += size;
+    }
+
+    void FreeListAllocator::grow(std::uint32_t newCapacity)
+    {
+        ASSERT(newCapacity >= _capacity, "Allocator cannot shrink");
+
+        std::uint32_t added = newCapacity - _capacity;
+        if (added == 0)
+        {
+            return;
+        }
+
+        std::uint32_t offset = _capacity;
+        _capacity = newCapacity;
+
+        insertFreeBlock(offset, added);
+        _totalFree += added;
+    }
+
+    void FreeListAllocator::reset(std::uint32_t usedSize)
+    {
+        ASSERT(usedSize <= _capacity, "Used size exceeds allocator capacity");
+
+        _freeBlocks.clear();
+        _totalFree = _capacity - usedSize;
+
+        if (_totalFree > 0)
+        {
+            _freeBlocks[usedSize] = _totalFree;
+        }
+    }
+
+    float FreeListAllocator::fragmentation() const
+    {
+        if (_totalFree == 0)
+        {
+            return 0.0f;
+        }
+
+        return 1.0f - static_cast<float>(largestFreeBlock()) / static_cast<float>(_totalFree);
+    }
+
+    std::uint32_t FreeListAllocator::largestFreeBlock() const
+    {
+        std::uint32_t largest = 0;
+        for (const auto& [offset, size]: _freeBlocks)
+        {
+            largest = std::max(largest, size);
+        }
+
+        return largest;
+    }
+
+    void FreeListAllocator::insertFreeBlock(std::uint32_t offset, std::uint32_t size)
+    {
+        auto next = _freeBlocks.lower_bound(offset);
+
+        // merge with previous block if it ends where this one starts
+        if (next != _freeBlocks.begin())
+        {
+            auto previous = std::prev(next);
+            ASSERT(previous->first + previous->second <= offset, "Double free or overlapping range");
+
+            if (previous->first + previous->second == offset)
+            {
+                offset = previous->first;
+                size += previous->second;
+                _freeBlocks.erase(previous);
+            }
+        }
+
+        // merge with next block if this one ends where it starts
+        if (next != _freeBlocks.end())
+        {
+            ASSERT(offset + size <= next->first, "Double free or overlapping range");
+
+            if (offset + size == next->first)
+            {
+                size += next->second;
+                _freeBlocks.erase(next);
+            }
+        }
+
+        _freeBlocks[offset] = size;
+    }
+}
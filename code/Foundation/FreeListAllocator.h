@@ -0,0 +1,49 @@
+﻿#pragma once
+
+#include "Base.h"
+
+#include <cstdint>
+#include <limits>
+#include <map>
+
+namespace BGLRenderer
+{
+    /// @brief Sub-allocates ranges of abstract units (bytes, vertices, indices...) from linear space.
+    /// Uses first fit and coalesces neighbouring free blocks, memory itself is managed by the owner.
+    class FreeListAllocator
+    {
+    public:
+        static constexpr std::uint32_t invalidOffset = std::numeric_limits<std::uint32_t>::max();
+
+        explicit FreeListAllocator(std::uint32_t capacity);
+
+        /// @brief Returns offset of allocated range or invalidOffset when there is no free block big enough
+        std::uint32_t allocate(std::uint32_t size);
+        void free(std::uint32_t offset, std::uint32_t size);
+
+        /// @brief Extends space, new units are appended as free block at the end
+        void grow(std::uint32_t newCapacity);
+
+        /// @brief Marks [0, usedSize) as allocated and everything after as free, used after compaction
+        void reset(std::uint32_t usedSize);
+
+        /// @brief 0 when all free space is continuous, approaches 1 when free space is split into many small blocks
+        float fragmentation() const;
+
+        std::uint32_t largestFreeBlock() const;
+
+        inline std::uint32_t capacity() const { return _capacity; }
+        inline std::uint32_t totalFree() const { return _totalFree; }
+        inline std::uint32_t used() const { return _capacity - _totalFree; }
+        inline std::size_t freeBlocksCount() const { return _freeBlocks.size(); }
+
+    private:
+        std::uint32_t _capacity;
+        std::uint32_t _totalFree;
+
+        // offset -> size, ordered by offset so neighbours can be merged
+        std::map<std::uint32_t, std::uint32_t> _freeBlocks;
+
+        void insertFreeBlock(std::uint32_t offset, std::uint32_t size);
+    };
+}
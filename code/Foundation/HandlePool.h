@@ -0,0 +1,162 @@
+﻿#pragma once
+
+#include "Base.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace BGLRenderer
+{
+    /// @brief Weak reference into HandlePool, index of the slot and generation the slot had when object was added.
+    /// Handle of released object never resolves again, even when its slot is reused
+    template <class T>
+    struct Handle
+    {
+        static constexpr std::uint32_t invalidIndex = std::numeric_limits<std::uint32_t>::max();
+
+        std::uint32_t index = invalidIndex;
+        std::uint32_t generation = 0;
+
+        inline bool valid() const { return index != invalidIndex; }
+
+        bool operator==(const Handle& other) const = default;
+    };
+
+    /// @brief Maps handles to objects owned elsewhere (e.g. by shared_ptr inside asset managers).
+    /// Slots live in fixed size chunks which are never moved or freed, so get() is lock free and safe to call
+    /// from worker threads while objects are added. Objects must not be released while other threads resolve them
+    template <class T>
+    class HandlePool
+    {
+    public:
+        static constexpr std::uint32_t chunkSize = 1024;
+        static constexpr std::uint32_t maxChunks = 1024;
+
+        HandlePool() = default;
+        HandlePool(const HandlePool&) = delete;
+        HandlePool& operator=(const HandlePool&) = delete;
+
+        ~HandlePool()
+        {
+            for (std::atomic<Slot*>& chunk: _chunks)
+            {
+                delete[] chunk.load(std::memory_order_relaxed);
+            }
+        }
+
+        /// @brief Pool shared by every object of the type, resources add themselves on construction
+        static HandlePool& global()
+        {
+            static HandlePool pool;
+            return pool;
+        }
+
+        Handle<T> add(T* object)
+        {
+            ASSERT(object != nullptr, "Handle pool can't store nullptr");
+
+            std::lock_guard lock(_mutex);
+
+            std::uint32_t index;
+            if (!_freeIndices.empty())
+            {
+                index = _freeIndices.back();
+                _freeIndices.pop_back();
+            }
+            else
+            {
+                ASSERT(_size < chunkSize * maxChunks, "Handle pool is full");
+
+                index = _size++;
+                std::atomic<Slot*>& chunk = _chunks[index / chunkSize];
+                if (chunk.load(std::memory_order_relaxed) == nullptr)
+                {
+                    chunk.store(new Slot[chunkSize], std::memory_order_release);
+                }
+            }
+
+            Slot& slot = this->slot(index);
+            slot.object.store(object, std::memory_order_release);
+            _count.fetch_add(1, std::memory_order_relaxed);
+
+            return {index, slot.generation.load(std::memory_order_relaxed)};
+        }
+
+        /// @brief Invalidates every handle of the slot, slot is reused by later add
+        void remove(Handle<T> handle)
+        {
+            std::lock_guard lock(_mutex);
+
+            if (!isAlive(handle))
+            {
+                return;
+            }
+
+            Slot& slot = this->slot(handle.index);
+            slot.object.store(nullptr, std::memory_order_relaxed);
+            slot.generation.fetch_add(1, std::memory_order_release);
+
+            _freeIndices.push_back(handle.index);
+            _count.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        /// @brief Returns nullptr for invalid, released or reused handles
+        inline T* get(Handle<T> handle) const
+        {
+            if (!isAlive(handle))
+            {
+                return nullptr;
+            }
+
+            const Slot& slot = this->slot(handle.index);
+            T* object = slot.object.load(std::memory_order_acquire);
+
+            // slot may be removed and reused between the checks, generation tells if object still belongs to handle
+            if (slot.generation.load(std::memory_order_acquire) != handle.generation)
+            {
+                return nullptr;
+            }
+
+            return object;
+        }
+
+        inline std::uint32_t count() const { return _count.load(std::memory_order_relaxed); }
+
+    private:
+        struct Slot
+        {
+            std::atomic<T*> object = nullptr;
+            std::atomic<std::uint32_t> generation = 0;
+        };
+
+        std::array<std::atomic<Slot*>, maxChunks> _chunks{};
+
+        // guards allocation of slots, readers only touch atomics
+        std::mutex _mutex;
+        std::vector<std::uint32_t> _freeIndices;
+        std::uint32_t _size = 0;
+        std::atomic<std::uint32_t> _count = 0;
+
+        inline Slot& slot(std::uint32_t index) const
+        {
+            return _chunks[index / chunkSize].load(std::memory_order_acquire)[index % chunkSize];
+        }
+
+        inline bool isAlive(Handle<T> handle) const
+        {
+            if (handle.index == Handle<T>::invalidIndex)
+            {
+                return false;
+            }
+
+            Slot* chunk = _chunks[handle.index / chunkSize].load(std::memory_order_acquire);
+            return chunk != nullptr &&
+                   chunk[handle.index % chunkSize].generation.load(std::memory_order_acquire) == handle.generation;
+        }
+    };
+}
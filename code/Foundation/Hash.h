@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace BGLRenderer
+{
+    static constexpr std::uint32_t fnv1aOffsetBasis = 2166136261u;
+    static constexpr std::uint32_t fnv1aPrime = 16777619u;
+
+    /// @brief 32-bit FNV-1a, passing hash of a prefix as seed gives the same value as hashing concatenated text
+    constexpr std::uint32_t fnv1a(std::string_view text, std::uint32_t seed = fnv1aOffsetBasis)
+    {
+        std::uint32_t hash = seed;
+        for (char character: text)
+        {
+            hash ^= static_cast<std::uint8_t>(character);
+            hash *= fnv1aPrime;
+        }
+
+        return hash;
+    }
+
+    static constexpr std::uint64_t fnv1a64OffsetBasis = 14695981039346656037ull;
+    static constexpr std::uint64_t fnv1a64Prime = 1099511628211ull;
+
+    /// @brief 64-bit FNV-1a for keys where collisions of the 32-bit version are too likely (e.g. cache files)
+    constexpr std::uint64_t fnv1a64(std::string_view text, std::uint64_t seed = fnv1a64OffsetBasis)
+    {
+        std::uint64_t hash = seed;
+        for (char character: text)
+        {
+            hash ^= static_cast<std::uint8_t>(character);
+            hash *= fnv1a64Prime;
+        }
+
+        return hash;
+    }
+}
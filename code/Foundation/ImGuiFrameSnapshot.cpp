@@ -0,0 +1,45 @@
+﻿#include "ImGuiFrameSnapshot.h"
+
+#include <cstring>
+
+namespace BGLRenderer
+{
+    template <class T>
+    static void copyVector(ImVector<T>& destination, const ImVector<T>& source)
+    {
+        // ImVector assignment frees the old storage, resize keeps it
+        destination.resize(source.Size);
+        if (source.Size > 0)
+        {
+            std::memcpy(destination.Data, source.Data, source.size_in_bytes());
+        }
+    }
+
+    void ImGuiFrameSnapshot::capture(const ImDrawData* drawData)
+    {
+        _drawData = *drawData;
+        _drawData.CmdLists = nullptr;
+
+        const std::size_t listCount = static_cast<std::size_t>(drawData->CmdListsCount);
+        while (_drawLists.size() < listCount)
+        {
+            _drawLists.push_back(std::make_unique<ImDrawList>(ImGui::GetDrawListSharedData()));
+        }
+
+        _drawListPointers.resize(listCount);
+        for (std::size_t i = 0; i < listCount; ++i)
+        {
+            const ImDrawList* source = drawData->CmdLists[i];
+            ImDrawList* destination = _drawLists[i].get();
+
+            copyVector(destination->CmdBuffer, source->CmdBuffer);
+            copyVector(destination->IdxBuffer, source->IdxBuffer);
+            copyVector(destination->VtxBuffer, source->VtxBuffer);
+            destination->Flags = source->Flags;
+
+            _drawListPointers[i] = destination;
+        }
+
+        _drawData.CmdLists = _drawListPointers.data();
+    }
+}
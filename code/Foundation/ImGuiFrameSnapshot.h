@@ -0,0 +1,24 @@
+﻿#pragma once
+
+#include <imgui.h>
+
+#include <memory>
+#include <vector>
+
+namespace BGLRenderer
+{
+    /// @brief Copy of ImGui draw data which stays valid after the next ImGui::NewFrame, so one frame can be drawn
+    /// by the render thread while the next one is built. Draw lists and their buffers are reused between captures
+    class ImGuiFrameSnapshot
+    {
+    public:
+        void capture(const ImDrawData* drawData);
+
+        inline ImDrawData* drawData() { return &_drawData; }
+
+    private:
+        ImDrawData _drawData;
+        std::vector<std::unique_ptr<ImDrawList>> _drawLists;
+        std::vector<ImDrawList*> _drawListPointers;
+    };
+}
@@ -0,0 +1,182 @@
+﻿#include "JobSystem.h"
+
+namespace BGLRenderer
+{
+    // lets run() find the deque of the worker it was called from
+    static thread_local const JobSystem* currentWorkerSystem = nullptr;
+    static thread_local std::uint32_t currentWorkerQueue = 0;
+
+    JobSystem::JobSystem(std::uint32_t workerCount)
+    {
+        _queues.reserve(workerCount + 1);
+        for (std::uint32_t i = 0; i <= workerCount; ++i)
+        {
+            _queues.push_back(std::make_unique<WorkQueue>());
+        }
+
+        _workers.reserve(workerCount);
+        for (std::uint32_t i = 0; i < workerCount; ++i)
+        {
+            _workers.emplace_back([this, i] { workerLoop(i + 1); });
+        }
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard lock(_sleepMutex);
+            _running.store(false, std::memory_order_release);
+        }
+
+        _wakeUp.notify_all();
+
+        for (std::thread& worker: _workers)
+        {
+            worker.join();
+        }
+    }
+
+    std::uint32_t JobSystem::defaultWorkerCount()
+    {
+        // hardware_concurrency may report 0 when it's unknown
+        const std::uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    void JobSystem::run(JobFunction job, JobCounter& counter)
+    {
+        addPending(counter);
+
+        // counted before the job is visible, otherwise a thief could decrement it first and wrap it around
+        _queuedJobs.fetch_add(1, std::memory_order_release);
+
+        WorkQueue& queue = *_queues[currentQueueIndex()];
+        {
+            std::lock_guard lock(queue.mutex);
+            queue.jobs.push_back({std::move(job), &counter});
+        }
+
+        // empty critical section orders the push with workers checking the predicate, so wake up isn't lost
+        {
+            std::lock_guard lock(_sleepMutex);
+        }
+
+        _wakeUp.notify_one();
+    }
+
+    void JobSystem::wait(JobCounter& counter)
+    {
+        const std::uint32_t queueIndex = currentQueueIndex();
+
+        while (!counter.done())
+        {
+            Job job;
+            if (takeJob(queueIndex, job))
+            {
+                execute(job);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    std::uint32_t JobSystem::currentQueueIndex() const
+    {
+        return currentWorkerSystem == this ? currentWorkerQueue : 0;
+    }
+
+    bool JobSystem::takeJob(std::uint32_t queueIndex, Job& job)
+    {
+        if (_queuedJobs.load(std::memory_order_acquire) == 0)
+        {
+            return false;
+        }
+
+        // own jobs are taken newest first, their data is most likely still in cache
+        {
+            WorkQueue& queue = *_queues[queueIndex];
+            std::lock_guard lock(queue.mutex);
+
+            if (!queue.jobs.empty())
+            {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+                _queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        // others are robbed of their oldest jobs, which usually hold the biggest part of the work
+        const std::uint32_t queuesCount = static_cast<std::uint32_t>(_queues.size());
+        for (std::uint32_t offset = 1; offset < queuesCount; ++offset)
+        {
+            WorkQueue& queue = *_queues[(queueIndex + offset) % queuesCount];
+            std::lock_guard lock(queue.mutex);
+
+            if (!queue.jobs.empty())
+            {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+                _queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void JobSystem::execute(Job& job)
+    {
+        job.function();
+        removePending(*job.counter);
+    }
+
+    void JobSystem::workerLoop(std::uint32_t queueIndex)
+    {
+        currentWorkerSystem = this;
+        currentWorkerQueue = queueIndex;
+
+        while (true)
+        {
+            Job job;
+            if (takeJob(queueIndex, job))
+            {
+                execute(job);
+                continue;
+            }
+
+            std::unique_lock lock(_sleepMutex);
+            _wakeUp.wait(lock, [this]
+            {
+                return !_running.load(std::memory_order_acquire) || _queuedJobs.load(std::memory_order_acquire) > 0;
+            });
+
+            if (!_running.load(std::memory_order_acquire))
+            {
+                return;
+            }
+        }
+    }
+
+    void JobSystem::addPending(JobCounter& counter)
+    {
+        // counter that becomes busy keeps its parent busy as well
+        if (counter.pending.fetch_add(1, std::memory_order_acq_rel) == 0 && counter.parent != nullptr)
+        {
+            addPending(*counter.parent);
+        }
+    }
+
+    void JobSystem::removePending(JobCounter& counter)
+    {
+        JobCounter* parent = counter.parent;
+
+        // counter may be destroyed by its waiter right after it reaches zero, parent is read before
+        if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) == 1 && parent != nullptr)
+        {
+            removePending(*parent);
+        }
+    }
+}
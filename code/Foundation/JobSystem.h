@@ -0,0 +1,119 @@
+﻿#pragma once
+
+#include "Base.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace BGLRenderer
+{
+    /// @brief Number of unfinished jobs started with the counter. Counter with parent keeps the parent
+    /// unfinished while it has pending jobs, so waiting for the parent covers every child
+    struct JobCounter
+    {
+        std::atomic<std::uint32_t> pending = 0;
+        JobCounter* parent = nullptr;
+
+        JobCounter() = default;
+
+        explicit JobCounter(JobCounter& parentCounter) :
+            parent(&parentCounter)
+        {
+        }
+
+        JobCounter(const JobCounter&) = delete;
+        JobCounter& operator=(const JobCounter&) = delete;
+
+        inline bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+    };
+
+    /// @brief Work stealing scheduler, every worker owns a deque and takes its own newest jobs first,
+    /// idle workers steal the oldest jobs of others. Threads that are not workers push into a shared queue.
+    /// Waiting threads execute jobs instead of blocking
+    class JobSystem
+    {
+    public:
+        using JobFunction = std::function<void()>;
+
+        explicit JobSystem(std::uint32_t workerCount = defaultWorkerCount());
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        /// @brief One worker per hardware thread except the one which runs the frame
+        static std::uint32_t defaultWorkerCount();
+
+        void run(JobFunction job, JobCounter& counter);
+
+        /// @brief Executes queued jobs until counter reaches zero
+        void wait(JobCounter& counter);
+
+        /// @brief Calls function(begin, end) for chunks of [0, count) of grainSize elements, the calling thread
+        /// takes the first chunk and returns when every chunk is done
+        template <class TFunction>
+        void parallelFor(std::size_t count, std::size_t grainSize, const TFunction& function)
+        {
+            if (count == 0)
+            {
+                return;
+            }
+
+            grainSize = std::max<std::size_t>(grainSize, 1);
+
+            JobCounter counter;
+            for (std::size_t begin = grainSize; begin < count; begin += grainSize)
+            {
+                const std::size_t end = std::min(begin + grainSize, count);
+                run([&function, begin, end] { function(begin, end); }, counter);
+            }
+
+            function(0, std::min(grainSize, count));
+            wait(counter);
+        }
+
+        /// @brief Worker threads plus the shared queue of other threads
+        inline std::uint32_t workerCount() const { return static_cast<std::uint32_t>(_workers.size()); }
+
+    private:
+        struct Job
+        {
+            JobFunction function;
+            JobCounter* counter;
+        };
+
+        struct WorkQueue
+        {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+        };
+
+        // index 0 is shared by threads that are not workers, worker i owns queue i + 1
+        std::vector<std::unique_ptr<WorkQueue>> _queues;
+        std::vector<std::thread> _workers;
+
+        std::atomic<bool> _running = true;
+        std::atomic<std::uint32_t> _queuedJobs = 0;
+
+        std::mutex _sleepMutex;
+        std::condition_variable _wakeUp;
+
+        std::uint32_t currentQueueIndex() const;
+
+        bool takeJob(std::uint32_t queueIndex, Job& job);
+        void execute(Job& job);
+        void workerLoop(std::uint32_t queueIndex);
+
+        static void addPending(JobCounter& counter);
+        static void removePending(JobCounter& counter);
+    };
+}
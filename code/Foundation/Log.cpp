@@ -1,10 +1,16 @@
 ﻿#include "Log.h"
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 
 namespace BGLRenderer
 {
     static std::vector<LogListenerFn> listeners;
+
+    // render thread logs too, listeners see one message at a time; recursive so a listener may log itself
+    static std::recursive_mutex listenersMutex;
+    static std::atomic<std::uint64_t> writtenMessagesCount = 0;
     
     Log::Log(const std::string& category) :
         _category(category)
@@ -13,11 +19,20 @@ namespace BGLRenderer
 
     void Log::listen(const LogListenerFn& listener)
     {
+        std::lock_guard lock(listenersMutex);
         listeners.push_back(listener);
     }
 
+    std::uint64_t Log::writtenMessages()
+    {
+        return writtenMessagesCount;
+    }
+
     void Log::write(const LogMessage& message)
     {
+        writtenMessagesCount++;
+
+        std::lock_guard lock(listenersMutex);
         for (const auto& listener : listeners)
         {
             listener(message);
@@ -1,6 +1,8 @@
 ﻿#pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <format>
 #include <functional>
 
@@ -45,6 +47,10 @@ namespace BGLRenderer
 
     using LogListenerFn = std::function<void(const LogMessage&)>;
 
+    /// @brief Format strings are taken as string_view, so literals aren't copied before formatting.
+    /// Arguments are taken as lvalue references, make_format_args doesn't accept temporaries.
+    /// Every message is formatted into heap allocated string, so logging during frames isn't allocation free.
+    /// Can be used from any thread, listeners are called by the logging thread one message at a time
     class Log
     {
     public:
@@ -53,29 +59,32 @@ namespace BGLRenderer
         inline void debug(const std::string& message) { write({LogSeverity::debug, _category, message}); }
 
         template <class... Args>
-        void debug(const std::string& message, Args&&... args)
+        void debug(std::string_view message, const Args&... args)
         {
-            write({LogSeverity::debug, _category, std::vformat(message, std::make_format_args(std::forward<Args>(args)...))});
+            write({LogSeverity::debug, _category, std::vformat(message, std::make_format_args(args...))});
         }
 
         inline void warning(const std::string& message) { write({LogSeverity::warning, _category, message}); }
 
         template <class... Args>
-        void warning(const std::string& message, Args&&... args)
+        void warning(std::string_view message, const Args&... args)
         {
-            write({LogSeverity::warning, _category, std::vformat(message, std::make_format_args(std::forward<Args>(args)...))});
+            write({LogSeverity::warning, _category, std::vformat(message, std::make_format_args(args...))});
         }
 
         inline void error(const std::string& message) { write({LogSeverity::error, _category, message}); }
 
         template <class... Args>
-        void error(const std::string& message, Args&&... args)
+        void error(std::string_view message, const Args&... args)
         {
-            write({LogSeverity::error, _category, std::vformat(message, std::make_format_args(std::forward<Args>(args)...))});
+            write({LogSeverity::error, _category, std::vformat(message, std::make_format_args(args...))});
         }
 
         static void listen(const LogListenerFn& listener);
 
+        /// @brief Messages written since start, used to count allocations made by logging
+        static std::uint64_t writtenMessages();
+
     private:
         std::string _category;
 
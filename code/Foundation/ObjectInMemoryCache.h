@@ -18,12 +18,8 @@ namespace BGLRenderer
         
         inline std::shared_ptr<TObject> get(const TKey& key)
         {
-            if (exists(key))
-            {
-                return _map[key];
-            }
-
-            return nullptr;
+            auto it = _map.find(key);
+            return it != _map.end() ? it->second : nullptr;
         }
 
         inline bool exists(const TKey& key) { return _map.contains(key); }
@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include "Base.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+
+namespace BGLRenderer
+{
+    /// @brief Bounded lock free ring buffer for exactly one producer thread and one consumer thread.
+    /// Blocking push/pop sleep on the opposite index instead of spinning, so an idle render thread doesn't burn a core
+    template <class T, std::size_t Capacity>
+    class SPSCQueue
+    {
+    public:
+        static_assert(std::has_single_bit(Capacity), "SPSCQueue capacity has to be power of two");
+
+        SPSCQueue() = default;
+        SPSCQueue(const SPSCQueue&) = delete;
+        SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+        /// @brief Producer side, returns false when the queue is full
+        bool tryPush(const T& value)
+        {
+            const std::size_t tail = _tail.load(std::memory_order_relaxed);
+            if (tail - _head.load(std::memory_order_acquire) == Capacity)
+            {
+                return false;
+            }
+
+            _items[tail % Capacity] = value;
+            _tail.store(tail + 1, std::memory_order_release);
+            _tail.notify_one();
+            return true;
+        }
+
+        /// @brief Consumer side, returns false when the queue is empty
+        bool tryPop(T& value)
+        {
+            const std::size_t head = _head.load(std::memory_order_relaxed);
+            if (head == _tail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+
+            value = _items[head % Capacity];
+            _head.store(head + 1, std::memory_order_release);
+            _head.notify_one();
+            return true;
+        }
+
+        /// @brief Producer side, waits for the consumer while the queue is full
+        void push(const T& value)
+        {
+            while (!tryPush(value))
+            {
+                _head.wait(_tail.load(std::memory_order_relaxed) - Capacity, std::memory_order_acquire);
+            }
+        }
+
+        /// @brief Consumer side, waits for the producer while the queue is empty
+        T pop()
+        {
+            T value;
+            while (!tryPop(value))
+            {
+                _tail.wait(_head.load(std::memory_order_relaxed), std::memory_order_acquire);
+            }
+
+            return value;
+        }
+
+        static constexpr std::size_t capacity() { return Capacity; }
+
+    private:
+        // consumer and producer indices live on separate cache lines, they only grow and wrap through modulo
+        alignas(64) std::atomic<std::size_t> _head = 0;
+        alignas(64) std::atomic<std::size_t> _tail = 0;
+        alignas(64) std::array<T, Capacity> _items{};
+    };
+}
@@ -0,0 +1,65 @@
+﻿#include "StringId.h"
+
+#include "Base.h"
+
+#include <format>
+#include <mutex>
+#include <unordered_map>
+
+namespace BGLRenderer
+{
+    namespace
+    {
+        struct StringIdNames
+        {
+            std::mutex mutex;
+            std::unordered_map<std::uint64_t, std::string> names;
+        };
+
+        StringIdNames& stringIdNames()
+        {
+            static StringIdNames names;
+            return names;
+        }
+    }
+
+    void StringId::registerName(StringId id, std::string_view text)
+    {
+        if constexpr (Debug::stringIdNames)
+        {
+            StringIdNames& names = stringIdNames();
+            std::lock_guard lock(names.mutex);
+
+            auto it = names.names.find(id._hash);
+            if (it == names.names.end())
+            {
+                names.names.emplace(id._hash, std::string(text));
+                return;
+            }
+
+            ASSERT(it->second == text, "String id hash collision");
+        }
+        else
+        {
+            (void)id;
+            (void)text;
+        }
+    }
+
+    std::string StringId::debugString() const
+    {
+        if constexpr (Debug::stringIdNames)
+        {
+            StringIdNames& names = stringIdNames();
+            std::lock_guard lock(names.mutex);
+
+            auto it = names.names.find(_hash);
+            if (it != names.names.end())
+            {
+                return it->second;
+            }
+        }
+
+        return std::format("#{:016x}", _hash);
+    }
+}
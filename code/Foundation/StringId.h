@@ -0,0 +1,89 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "Hash.h"
+
+namespace BGLRenderer
+{
+    namespace Debug
+    {
+        /// @brief Reverse table from id to text, kept only in builds with asserts
+#ifdef NDEBUG
+        static constexpr bool stringIdNames = false;
+#else
+        static constexpr bool stringIdNames = true;
+#endif
+    }
+
+    /// @brief Interned name, compared and hashed as 64-bit FNV-1a of the text.
+    /// String literals are hashed at compile time, see also operator""_sid
+    class StringId
+    {
+    public:
+        constexpr StringId() = default;
+
+        template <std::size_t N>
+        consteval StringId(const char (&text)[N]) :
+            _hash(fnv1a64(std::string_view(text, N - 1)))
+        {
+        }
+
+        /// @brief Runtime text is also registered in the reverse table of debug builds
+        explicit constexpr StringId(std::string_view text) :
+            _hash(fnv1a64(text))
+        {
+            if constexpr (Debug::stringIdNames)
+            {
+                if (!std::is_constant_evaluated())
+                {
+                    registerName(*this, text);
+                }
+            }
+        }
+
+        static constexpr StringId fromHash(std::uint64_t hash)
+        {
+            StringId id;
+            id._hash = hash;
+            return id;
+        }
+
+        /// @brief Id of text that continues the text of this id, no intermediate string is built
+        constexpr StringId append(std::string_view text) const { return fromHash(fnv1a64(text, _hash)); }
+
+        /// @brief Records text of id built without the string constructor (e.g. by append), no-op in release
+        static void registerName(StringId id, std::string_view text);
+
+        /// @brief Text registered for the id in debug builds, otherwise hex value of the hash
+        std::string debugString() const;
+
+        constexpr std::uint64_t hash() const { return _hash; }
+        constexpr bool valid() const { return _hash != 0; }
+
+        constexpr bool operator==(const StringId& other) const = default;
+        constexpr auto operator<=>(const StringId& other) const = default;
+
+    private:
+        std::uint64_t _hash = 0;
+    };
+
+    consteval StringId operator""_sid(const char* text, std::size_t length)
+    {
+        return StringId::fromHash(fnv1a64(std::string_view(text, length)));
+    }
+}
+
+template <>
+struct std::hash<BGLRenderer::StringId>
+{
+    std::size_t operator()(const BGLRenderer::StringId& id) const noexcept
+    {
+        return static_cast<std::size_t>(id.hash());
+    }
+};
@@ -0,0 +1,56 @@
+﻿#include "Bounds.h"
+
+#include <algorithm>
+
+namespace BGLRenderer
+{
+    MeshBounds MeshBounds::fromPositions(const std::vector<GLfloat>& positions)
+    {
+        MeshBounds bounds{};
+
+        if (positions.size() < 3)
+        {
+            return bounds;
+        }
+
+        bounds.box.min = glm::vec3(positions[0], positions[1], positions[2]);
+        bounds.box.max = bounds.box.min;
+
+        for (std::size_t i = 3; i + 2 < positions.size(); i += 3)
+        {
+            glm::vec3 position(positions[i], positions[i + 1], positions[i + 2]);
+            bounds.box.min = glm::min(bounds.box.min, position);
+            bounds.box.max = glm::max(bounds.box.max, position);
+        }
+
+        // sphere around box center, radius from actual vertices is tighter than half of the box diagonal
+        bounds.sphere.center = bounds.box.center();
+
+        float radiusSquared = 0.0f;
+        for (std::size_t i = 0; i + 2 < positions.size(); i += 3)
+        {
+            glm::vec3 offset = glm::vec3(positions[i], positions[i + 1], positions[i + 2]) - bounds.sphere.center;
+            radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+        }
+
+        bounds.sphere.radius = std::sqrt(radiusSquared);
+        bounds.valid = true;
+
+        return bounds;
+    }
+
+    BoundingSphere MeshBounds::worldSphere(const glm::mat4& model) const
+    {
+        float scaleSquared = std::max({
+            glm::dot(glm::vec3(model[0]), glm::vec3(model[0])),
+            glm::dot(glm::vec3(model[1]), glm::vec3(model[1])),
+            glm::dot(glm::vec3(model[2]), glm::vec3(model[2]))
+        });
+
+        BoundingSphere result{};
+        result.center = glm::vec3(model * glm::vec4(sphere.center, 1.0f));
+        result.radius = sphere.radius * std::sqrt(scaleSquared);
+
+        return result;
+    }
+}
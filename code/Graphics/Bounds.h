@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include "OpenGLBase.h"
+
+#include <Foundation/GLMMath.h>
+
+#include <vector>
+
+namespace BGLRenderer
+{
+    struct BoundingBox
+    {
+        glm::vec3 min = glm::vec3(0.0f);
+        glm::vec3 max = glm::vec3(0.0f);
+
+        inline glm::vec3 center() const { return (min + max) * 0.5f; }
+        inline glm::vec3 extents() const { return (max - min) * 0.5f; }
+    };
+
+    struct BoundingSphere
+    {
+        glm::vec3 center = glm::vec3(0.0f);
+        float radius = 0.0f;
+    };
+
+    /// @brief Local space bounds of a mesh, meshes without valid bounds are never culled
+    struct MeshBounds
+    {
+        BoundingBox box{};
+        BoundingSphere sphere{};
+        bool valid = false;
+
+        /// @brief Computes bounds from tightly packed xyz positions
+        static MeshBounds fromPositions(const std::vector<GLfloat>& positions);
+
+        /// @brief Transforms sphere to world space, non uniform scale is handled by taking the largest axis
+        BoundingSphere worldSphere(const glm::mat4& model) const;
+    };
+}
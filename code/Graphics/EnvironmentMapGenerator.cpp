@@ -1,4 +1,4 @@
-#include "EnvironmentMapGenerator.h"
+﻿#include "EnvironmentMapGenerator.h"
 
 #include "OpenGLRenderer.h"
 
@@ -16,13 +16,11 @@ namespace BGLRenderer
     {
         _logger.debug("Loading default resources");
 
-        constexpr const char* processingVert = "shaders/cubemap_processing.vert";
-
         _quad = _renderer->quadMesh();
-        _equirectangularToCubemap = _assetManager->getProgram(processingVert,
-                                                              "shaders/equirectangular_to_cubemap.frag");
-        _irradianceCubemapGenerator = _assetManager->getProgram(processingVert,
-                                                                "shaders/irradiance_cubemap_generator.frag");
+        _equirectangularToCubemap = _assetManager->getProgramPipeline(OpenGLRenderer::fullscreenVertexShader,
+                                                                      "shaders/equirectangular_to_cubemap.frag");
+        _irradianceCubemapGenerator = _assetManager->getProgramPipeline(OpenGLRenderer::fullscreenVertexShader,
+                                                                        "shaders/irradiance_cubemap_generator.frag");
 
         _framebuffer = std::make_shared<OpenGLFramebuffer>("Environment Map Generator", 2048, 2048);
 
@@ -41,24 +39,24 @@ namespace BGLRenderer
                       environmentMap->name().c_str(),
                       equirectangularMap->name().c_str());
 
-        auto bindEquirectangularMap = [&](const std::shared_ptr<OpenGLProgram>& program)
+        auto bindEquirectangularMap = [&](const std::shared_ptr<OpenGLProgramPipeline>& pipeline)
         {
             equirectangularMap->bind(1);
-            program->setInt("u_texture", 1);
+            pipeline->setInt("u_texture", 1);
         };
         process(environmentMap->cubemap(), _equirectangularToCubemap, bindEquirectangularMap);
 
-        auto bindCubemap = [&](const std::shared_ptr<OpenGLProgram>& program)
+        auto bindCubemap = [&](const std::shared_ptr<OpenGLProgramPipeline>& pipeline)
         {
             environmentMap->cubemap()->bind(1);
-            program->setInt("u_texture", 1);
+            pipeline->setInt("u_texture", 1);
         };
 
         process(environmentMap->irradianceMap(), _irradianceCubemapGenerator, bindCubemap);
     }
 
     void EnvironmentMapGenerator::process(const std::shared_ptr<OpenGLCubemap>& target,
-                                          const std::shared_ptr<OpenGLProgram>& program,
+                                          const std::shared_ptr<OpenGLProgramPipeline>& pipeline,
                                           const BindUniformsFn& bindUniformsFn)
     {
         static const glm::mat4 captureViews[] =
@@ -74,18 +72,19 @@ namespace BGLRenderer
         GLuint resolution = target->faceSize();
         _framebuffer->resize(resolution, resolution);
 
-        GL_CALL(glDisable(GL_DEPTH_TEST));
-        GL_CALL(glDisable(GL_BLEND));
+        OpenGLStateCache& stateCache = OpenGLStateCache::current();
+        stateCache.setDepthTest(false);
+        stateCache.setBlend(false);
 
         glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
 
-        program->bind();
-        bindUniformsFn(program);
+        pipeline->bind();
+        bindUniformsFn(pipeline);
 
         _framebuffer->bind();
         _framebuffer->clearColorAttachments();
 
-        GL_CALL(glViewport(0, 0, resolution, resolution));
+        stateCache.setViewport(0, 0, static_cast<GLsizei>(resolution), static_cast<GLsizei>(resolution));
 
         constexpr GLenum drawTargets[] = {
             GL_COLOR_ATTACHMENT0
@@ -97,7 +96,7 @@ namespace BGLRenderer
             _framebuffer->addColorCubeFace(target, static_cast<OpenGLCubeFace>(i));
 
             glm::mat4 viewProjectionInv = glm::inverse(projection * captureViews[i]);
-            program->setMatrix4x4("u_viewProjectionInv", viewProjectionInv);
+            pipeline->setMatrix4x4("u_viewProjectionInv", viewProjectionInv);
 
             _quad->bind();
             _quad->draw();
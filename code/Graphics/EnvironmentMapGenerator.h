@@ -1,4 +1,4 @@
-#pragma once
+﻿#pragma once
 
 #include <memory>
 
@@ -6,7 +6,7 @@
 
 namespace BGLRenderer
 {
-    class OpenGLProgram;
+    class OpenGLProgramPipeline;
     class OpenGLRenderer;
     class AssetManager;
     class OpenGLMesh;
@@ -23,7 +23,7 @@ namespace BGLRenderer
                       const std::shared_ptr<OpenGLTexture2D>& equirectangularMap);
 
     private:
-        using BindUniformsFn = std::function<void(const std::shared_ptr<OpenGLProgram>& program)>;
+        using BindUniformsFn = std::function<void(const std::shared_ptr<OpenGLProgramPipeline>& pipeline)>;
 
         Log _logger{"Environment Map Generator"};
 
@@ -33,12 +33,12 @@ namespace BGLRenderer
         bool _resourcesLoaded;
 
         std::shared_ptr<OpenGLMesh> _quad;
-        std::shared_ptr<OpenGLProgram> _equirectangularToCubemap;
-        std::shared_ptr<OpenGLProgram> _irradianceCubemapGenerator;
+        std::shared_ptr<OpenGLProgramPipeline> _equirectangularToCubemap;
+        std::shared_ptr<OpenGLProgramPipeline> _irradianceCubemapGenerator;
         std::shared_ptr<OpenGLFramebuffer> _framebuffer;
 
         void process(const std::shared_ptr<OpenGLCubemap>& target,
-                     const std::shared_ptr<OpenGLProgram>& program,
+                     const std::shared_ptr<OpenGLProgramPipeline>& pipeline,
                      const BindUniformsFn& bindUniformsFn);
     };
 }
@@ -0,0 +1,163 @@
+﻿#include "FrustumCulling.h"
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BGL_FRUSTUM_CULLING_SIMD 1
+#include <immintrin.h>
+#else
+#define BGL_FRUSTUM_CULLING_SIMD 0
+#endif
+
+namespace BGLRenderer
+{
+    Frustum Frustum::fromViewProjection(const glm::mat4& viewProjection)
+    {
+        // Gribb-Hartmann extraction, glm matrices are column major so rows are gathered manually
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        }
+
+        Frustum frustum{};
+        frustum.planes[0] = rows[3] + rows[0];
+        frustum.planes[1] = rows[3] - rows[0];
+        frustum.planes[2] = rows[3] + rows[1];
+        frustum.planes[3] = rows[3] - rows[1];
+        frustum.planes[4] = rows[3] + rows[2];
+        frustum.planes[5] = rows[3] - rows[2];
+
+        for (glm::vec4& plane: frustum.planes)
+        {
+            plane /= glm::length(glm::vec3(plane));
+        }
+
+        return frustum;
+    }
+
+    void FrustumCuller::clear()
+    {
+        resetFrameVector(_centerX, 0);
+        resetFrameVector(_centerY, 0);
+        resetFrameVector(_centerZ, 0);
+        resetFrameVector(_radius, 0);
+    }
+
+    void FrustumCuller::reserve(std::size_t count)
+    {
+        _centerX.reserve(count);
+        _centerY.reserve(count);
+        _centerZ.reserve(count);
+        _radius.reserve(count);
+    }
+
+    void FrustumCuller::addSphere(const glm::vec3& center, float radius)
+    {
+        _centerX.push_back(center.x);
+        _centerY.push_back(center.y);
+        _centerZ.push_back(center.z);
+        _radius.push_back(radius);
+    }
+
+    void FrustumCuller::cull(const Frustum& frustum, FrameVector<std::uint8_t>& visibility, JobSystem* jobSystem) const
+    {
+        visibility.resize(size());
+        std::uint8_t* visibilityData = visibility.data();
+
+        if (jobSystem == nullptr || size() <= parallelChunkSize)
+        {
+            cullRange(frustum, visibilityData, 0, size());
+            return;
+        }
+
+        // chunks write disjoint parts of visibility, nothing is shared between them
+        jobSystem->parallelFor(size(), parallelChunkSize, [&](std::size_t begin, std::size_t end)
+        {
+            cullRange(frustum, visibilityData, begin, end);
+        });
+    }
+
+    void FrustumCuller::cullRange(const Frustum& frustum, std::uint8_t* visibility, std::size_t begin,
+                                  std::size_t end) const
+    {
+        std::size_t processed = cullSIMD(frustum, visibility, begin, end);
+        cullScalar(frustum, visibility, processed, end);
+    }
+
+    std::size_t FrustumCuller::cullSIMD(const Frustum& frustum, std::uint8_t* visibility, std::size_t begin,
+                                        std::size_t end) const
+    {
+        const std::size_t count = end;
+        std::size_t index = begin;
+
+#if defined(__AVX__)
+        for (; index + 8 <= count; index += 8)
+        {
+            const __m256 x = _mm256_loadu_ps(_centerX.data() + index);
+            const __m256 y = _mm256_loadu_ps(_centerY.data() + index);
+            const __m256 z = _mm256_loadu_ps(_centerZ.data() + index);
+            const __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(_radius.data() + index));
+
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (const glm::vec4& plane: frustum.planes)
+            {
+                __m256 distance = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(plane.x)), _mm256_mul_ps(y, _mm256_set1_ps(plane.y))),
+                    _mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+            }
+
+            const int mask = _mm256_movemask_ps(inside);
+            for (int lane = 0; lane < 8; ++lane)
+            {
+                visibility[index + lane] = static_cast<std::uint8_t>((mask >> lane) & 1);
+            }
+        }
+#endif
+
+#if BGL_FRUSTUM_CULLING_SIMD
+        for (; index + 4 <= count; index += 4)
+        {
+            const __m128 x = _mm_loadu_ps(_centerX.data() + index);
+            const __m128 y = _mm_loadu_ps(_centerY.data() + index);
+            const __m128 z = _mm_loadu_ps(_centerZ.data() + index);
+            const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(_radius.data() + index));
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (const glm::vec4& plane: frustum.planes)
+            {
+                __m128 distance = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                    _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+            }
+
+            const int mask = _mm_movemask_ps(inside);
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                visibility[index + lane] = static_cast<std::uint8_t>((mask >> lane) & 1);
+            }
+        }
+#endif
+
+        return index;
+    }
+
+    void FrustumCuller::cullScalar(const Frustum& frustum, std::uint8_t* visibility, std::size_t begin,
+                                   std::size_t end) const
+    {
+        for (std::size_t index = begin; index < end; ++index)
+        {
+            bool inside = true;
+            for (const glm::vec4& plane: frustum.planes)
+            {
+                float distance = plane.x * _centerX[index] + plane.y * _centerY[index] + plane.z * _centerZ[index] +
+                                 plane.w;
+                inside = inside && distance >= -_radius[index];
+            }
+
+            visibility[index] = inside ? 1 : 0;
+        }
+    }
+}
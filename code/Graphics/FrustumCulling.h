@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include <Foundation/FrameArena.h>
+#include <Foundation/GLMMath.h>
+#include <Foundation/JobSystem.h>
+
+#include <cstdint>
+
+namespace BGLRenderer
+{
+    struct Frustum
+    {
+        /// @brief Normalized planes (xyz - normal pointing inside, w - distance), order: left, right, bottom, top, near, far
+        glm::vec4 planes[6];
+
+        static Frustum fromViewProjection(const glm::mat4& viewProjection);
+    };
+
+    /// @brief Tests bounding spheres against frustum planes, spheres are stored as structure of arrays so
+    /// 4 (SSE) or 8 (AVX) of them are tested at once. Arrays live in the frame arena, fill them within one frame
+    class FrustumCuller
+    {
+    public:
+        /// @brief Drops spheres together with their storage
+        void clear();
+        void reserve(std::size_t count);
+
+        void addSphere(const glm::vec3& center, float radius);
+
+        /// @brief Spheres tested by one job when culling is spread across the job system, multiple of SIMD width
+        static constexpr std::size_t parallelChunkSize = 2048;
+
+        /// @brief Writes 1 for every sphere that intersects frustum and 0 for culled ones, in order they were added.
+        /// Big sets are split between jobs when job system is given
+        void cull(const Frustum& frustum, FrameVector<std::uint8_t>& visibility, JobSystem* jobSystem = nullptr) const;
+
+        inline std::size_t size() const { return _radius.size(); }
+
+    private:
+        FrameVector<float> _centerX;
+        FrameVector<float> _centerY;
+        FrameVector<float> _centerZ;
+        FrameVector<float> _radius;
+
+        /// @brief Tests [begin, end) range, returns index where SIMD loop stopped
+        std::size_t cullSIMD(const Frustum& frustum, std::uint8_t* visibility, std::size_t begin, std::size_t end) const;
+        void cullScalar(const Frustum& frustum, std::uint8_t* visibility, std::size_t begin, std::size_t end) const;
+        void cullRange(const Frustum& frustum, std::uint8_t* visibility, std::size_t begin, std::size_t end) const;
+    };
+}
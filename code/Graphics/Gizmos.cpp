@@ -1,4 +1,4 @@
-#include "Gizmos.h"
+﻿#include "Gizmos.h"
 
 namespace BGLRenderer
 {
@@ -65,18 +65,29 @@ namespace BGLRenderer
         pushRender(_assets.sphere, model);
     }
 
-    void Gizmos::render(const glm::mat4& viewProjection)
+    void Gizmos::beginFrame()
+    {
+        _renderList.clear();
+    }
+
+    void Gizmos::render()
     {
         _assets.gizmosProgram->bind();
-        _assets.gizmosProgram->setMatrix4x4("u_viewProjection", viewProjection);
 
         for (const auto& element: _renderList)
         {
+            OpenGLMesh* mesh = HandlePool<OpenGLMesh>::global().get(element.mesh);
+            if (mesh == nullptr)
+            {
+                continue;
+            }
+
             _assets.gizmosProgram->setMatrix4x4("u_model", element.model);
             _assets.gizmosProgram->setVector4("u_color", element.color);
 
-            element.mesh->bind();
-            element.mesh->draw();
+            mesh->bindDecodeParameters(*_assets.gizmosProgram);
+            mesh->bind();
+            mesh->draw();
         }
 
         _renderList.clear();
@@ -85,7 +96,7 @@ namespace BGLRenderer
     void Gizmos::pushRender(const std::shared_ptr<OpenGLMesh>& mesh, const glm::mat4& model)
     {
         GizmoRender render;
-        render.mesh = mesh;
+        render.mesh = mesh->handle();
         render.color = _colorStack.empty() ? defaultGizmoColor : _colorStack.top();
         render.model = model;
         _renderList.push_back(render);
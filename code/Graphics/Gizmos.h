@@ -1,7 +1,8 @@
-#pragma once
+﻿#pragma once
 
 #include <memory>
 #include <stack>
+#include <vector>
 
 #include <Foundation/Base.h>
 #include <Foundation/GLMMath.h>
@@ -20,7 +21,7 @@ namespace BGLRenderer
 
     struct GizmoRender
     {
-        std::shared_ptr<OpenGLMesh> mesh;
+        OpenGLMeshHandle mesh;
         glm::mat4 model;
         glm::vec4 color;
     };
@@ -39,12 +40,19 @@ namespace BGLRenderer
         inline void popColor() { _colorStack.pop(); }
 
         inline void setAssets(const GizmosAssets& assets) { _assets = assets; }
+        inline const GizmosAssets& assets() const { return _assets; }
 
-        void render(const glm::mat4& viewProjection);
+        /// @brief Drops gizmos left from the previous frame
+        void beginFrame();
+
+        /// @brief Draws every gizmo pushed since the last call, camera matrices come from the frame data block
+        void render();
 
     private:
         GizmosAssets _assets{};
-        std::stack<glm::vec4> _colorStack;
+        std::stack<glm::vec4, std::vector<glm::vec4>> _colorStack;
+        // filled by the thread recording the frame, which may not be the one owning the frame arena,
+        // capacity is kept between frames so steady state doesn't allocate
         std::vector<GizmoRender> _renderList;
 
         void pushRender(const std::shared_ptr<OpenGLMesh>& mesh, const glm::mat4& model);
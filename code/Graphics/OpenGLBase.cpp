@@ -1,9 +1,17 @@
 ﻿#include "OpenGLBase.h"
 
+#include <atomic>
+
 namespace BGLRenderer
 {
     Log openGLLogger = {"OpenGL"};
 
+    std::uint32_t nextOpenGLResourceId()
+    {
+        static std::atomic<std::uint32_t> counter = 0;
+        return counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
     char const* openglErrorToString(const GLenum error) noexcept
     {
         switch (error)
@@ -50,9 +58,7 @@ namespace BGLRenderer
 
         if (error != GL_NO_ERROR)
         {
-            (void)filename;
-            (void)line;
-            //openGLLogger.error("{}: {}: {}", filename, line, openglErrorToString(error));
+            openGLLogger.error("{}: {}: {}", filename, line, openglErrorToString(error));
         }
 
         if constexpr (Debug::assertOpenGLCall)
@@ -60,4 +66,137 @@ namespace BGLRenderer
             ASSERT(error == GL_NO_ERROR, "OpenGL call error");
         }
     }
+
+    static const char* debugTypeToString(GLenum type)
+    {
+        switch (type)
+        {
+            case GL_DEBUG_TYPE_ERROR:
+                return "error";
+            case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+                return "deprecated";
+            case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+                return "undefined behavior";
+            case GL_DEBUG_TYPE_PORTABILITY:
+                return "portability";
+            case GL_DEBUG_TYPE_PERFORMANCE:
+                return "performance";
+            case GL_DEBUG_TYPE_MARKER:
+                return "marker";
+            default:
+                return "other";
+        }
+    }
+
+    static LogSeverity debugMessageSeverity(GLenum type, GLenum severity)
+    {
+        if (type == GL_DEBUG_TYPE_ERROR || severity == GL_DEBUG_SEVERITY_HIGH)
+        {
+            return LogSeverity::error;
+        }
+
+        // performance messages (shader recompiles, buffer stalls) are the reason to use debug output at all,
+        // so they are never hidden between notifications
+        if (type == GL_DEBUG_TYPE_PERFORMANCE || severity == GL_DEBUG_SEVERITY_MEDIUM ||
+            severity == GL_DEBUG_SEVERITY_LOW)
+        {
+            return LogSeverity::warning;
+        }
+
+        return LogSeverity::debug;
+    }
+
+    static void APIENTRY openGLDebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                             GLsizei length, const GLchar* message, const void* userParam)
+    {
+        (void)userParam;
+
+        // every source gets its own category, e.g. "OpenGL Shader Compiler"
+        static Log sourceLoggers[] = {
+            {"OpenGL API"},
+            {"OpenGL Window System"},
+            {"OpenGL Shader Compiler"},
+            {"OpenGL Third Party"},
+            {"OpenGL Application"},
+            {"OpenGL Other"}
+        };
+
+        std::size_t sourceIndex;
+        switch (source)
+        {
+            case GL_DEBUG_SOURCE_API:
+                sourceIndex = 0;
+                break;
+            case GL_DEBUG_SOURCE_WINDOW_SYSTEM:
+                sourceIndex = 1;
+                break;
+            case GL_DEBUG_SOURCE_SHADER_COMPILER:
+                sourceIndex = 2;
+                break;
+            case GL_DEBUG_SOURCE_THIRD_PARTY:
+                sourceIndex = 3;
+                break;
+            case GL_DEBUG_SOURCE_APPLICATION:
+                sourceIndex = 4;
+                break;
+            default:
+                sourceIndex = 5;
+                break;
+        }
+
+        std::string text = length >= 0 ? std::string(message, static_cast<std::size_t>(length)) : std::string(message);
+        Log& logger = sourceLoggers[sourceIndex];
+
+        switch (debugMessageSeverity(type, severity))
+        {
+            case LogSeverity::error:
+                logger.error("[{}, {}] {}", debugTypeToString(type), id, text);
+                break;
+            case LogSeverity::warning:
+                logger.warning("[{}, {}] {}", debugTypeToString(type), id, text);
+                break;
+            case LogSeverity::debug:
+                logger.debug("[{}, {}] {}", debugTypeToString(type), id, text);
+                break;
+        }
+
+        if constexpr (Debug::assertOpenGLCall)
+        {
+            ASSERT(type != GL_DEBUG_TYPE_ERROR, "OpenGL call error");
+        }
+    }
+
+    bool installOpenGLDebugOutput()
+    {
+        if constexpr (!Debug::openGLDebugOutput)
+        {
+            return false;
+        }
+
+        if (!GLAD_GL_VERSION_4_3 && !GLAD_GL_KHR_debug)
+        {
+            openGLLogger.warning("KHR_debug is not supported, OpenGL errors will not be reported");
+            return false;
+        }
+
+        GLint contextFlags = 0;
+        glGetIntegerv(GL_CONTEXT_FLAGS, &contextFlags);
+        if ((contextFlags & GL_CONTEXT_FLAG_DEBUG_BIT) == 0)
+        {
+            openGLLogger.warning("Context was created without debug flag, driver may not report all messages");
+        }
+
+        // synchronous output reports messages from the thread and call that caused them
+        glEnable(GL_DEBUG_OUTPUT);
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        glDebugMessageCallback(openGLDebugCallback, nullptr);
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+
+        // some drivers send notifications for routine work (e.g. buffer uploads), logging them would flood
+        // the console and allocate every frame
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+
+        openGLLogger.debug("OpenGL debug output enabled");
+        return true;
+    }
 }
@@ -1,25 +1,60 @@
 ﻿#pragma once
 
 #include <Foundation/Base.h>
+#include <Foundation/HandlePool.h>
 #include <Foundation/Log.h>
 
 #include <glad/glad.h>
 
+// modes of BGL_GL_ERROR_CHECK, selected by CMake option with the same name
+#define BGL_GL_ERROR_CHECK_OFF 0
+#define BGL_GL_ERROR_CHECK_GET_ERROR 1
+#define BGL_GL_ERROR_CHECK_DEBUG_CALLBACK 2
+
+#ifndef BGL_GL_ERROR_CHECK
+#define BGL_GL_ERROR_CHECK BGL_GL_ERROR_CHECK_OFF
+#endif
+
 namespace BGLRenderer
 {
     namespace Debug
     {
         static constexpr bool assertOpenGLCall = false;
+
+        /// @brief Context is created with debug flag and driver messages are routed into the log
+        static constexpr bool openGLDebugOutput = BGL_GL_ERROR_CHECK == BGL_GL_ERROR_CHECK_DEBUG_CALLBACK;
+    }
+
+    /// @brief Fixed binding points of uniform blocks shared between every program
+    namespace UniformBlockBinding
+    {
+        static constexpr GLuint frameData = 0;
+        static constexpr GLuint materialData = 1;
     }
 
     extern Log openGLLogger;
 
+    /// @brief Returns process-wide unique id for renderer resources, used to build render queue sort keys
+    std::uint32_t nextOpenGLResourceId();
+
     char const* openglErrorToString(const GLenum error) noexcept;
     void openglCheckError(const char* filename, size_t line);
+
+    /// @brief Routes KHR_debug messages into the log, does nothing unless debug output is enabled at build time.
+    /// Returns false when the context doesn't support debug output
+    bool installOpenGLDebugOutput();
 }
 
+#if BGL_GL_ERROR_CHECK == BGL_GL_ERROR_CHECK_GET_ERROR
 #define GL_CALL(x) \
 { \
     x; \
     openglCheckError(__FILE__, __LINE__); \
 }
+#else
+// glGetError synchronizes with the driver, errors are either not checked or reported by the debug callback
+#define GL_CALL(x) \
+{ \
+    x; \
+}
+#endif
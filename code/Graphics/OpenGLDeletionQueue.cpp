@@ -0,0 +1,157 @@
+﻿#include "OpenGLDeletionQueue.h"
+
+#include "OpenGLStateCache.h"
+
+#include <limits>
+#include <utility>
+
+namespace BGLRenderer
+{
+    OpenGLDeletionQueue& OpenGLDeletionQueue::global()
+    {
+        static OpenGLDeletionQueue queue;
+        return queue;
+    }
+
+    void OpenGLDeletionQueue::deleteObject(OpenGLObjectType type, GLuint id)
+    {
+        if (id == 0)
+        {
+            return;
+        }
+
+        std::lock_guard lock(_mutex);
+        _pendingObjects.push_back({type, id, _frame});
+    }
+
+    void OpenGLDeletionQueue::retire(std::shared_ptr<void> resource)
+    {
+        if (resource == nullptr)
+        {
+            return;
+        }
+
+        std::lock_guard lock(_mutex);
+        _retiredResources.push_back({std::move(resource), _frame});
+    }
+
+    void OpenGLDeletionQueue::deferRelease(std::function<void()> release)
+    {
+        std::lock_guard lock(_mutex);
+        _deferredReleases.push_back({std::move(release), _frame});
+    }
+
+    void OpenGLDeletionQueue::beginFrame()
+    {
+        std::uint64_t frame;
+        {
+            std::lock_guard lock(_mutex);
+            frame = ++_frame;
+        }
+
+        // entries queued during frame F may be referenced by frames up to F + framesInFlight
+        if (frame > _framesInFlight)
+        {
+            collect(frame - _framesInFlight - 1);
+        }
+    }
+
+    void OpenGLDeletionQueue::flush()
+    {
+        // released resources queue names of their own objects, so retired ones go first
+        collect(std::numeric_limits<std::uint64_t>::max());
+        collect(std::numeric_limits<std::uint64_t>::max());
+    }
+
+    void OpenGLDeletionQueue::collect(std::uint64_t lastFrame)
+    {
+        {
+            std::lock_guard lock(_mutex);
+
+            std::erase_if(_retiredResources, [&](RetiredResource& retired)
+            {
+                if (retired.frame > lastFrame)
+                {
+                    return false;
+                }
+
+                _releasedResources.push_back(std::move(retired));
+                return true;
+            });
+
+            std::erase_if(_deferredReleases, [&](DeferredRelease& deferred)
+            {
+                if (deferred.frame > lastFrame)
+                {
+                    return false;
+                }
+
+                _dueReleases.push_back(std::move(deferred));
+                return true;
+            });
+
+            std::erase_if(_pendingObjects, [&](const PendingObject& object)
+            {
+                if (object.frame > lastFrame)
+                {
+                    return false;
+                }
+
+                _deletedObjects.push_back(object);
+                return true;
+            });
+        }
+
+        // destructors of released resources call deleteObject, so they run outside of the lock
+        _releasedResources.clear();
+
+        for (const DeferredRelease& deferred: _dueReleases)
+        {
+            deferred.release();
+        }
+
+        _dueReleases.clear();
+
+        for (const PendingObject& object: _deletedObjects)
+        {
+            deleteNow(object);
+        }
+
+        _deletedObjects.clear();
+    }
+
+    void OpenGLDeletionQueue::deleteNow(const PendingObject& object)
+    {
+        OpenGLStateCache& stateCache = OpenGLStateCache::current();
+
+        switch (object.type)
+        {
+            case OpenGLObjectType::buffer:
+                GL_CALL(glDeleteBuffers(1, &object.id));
+                break;
+            case OpenGLObjectType::vertexArray:
+                stateCache.forgetVertexArray(object.id);
+                GL_CALL(glDeleteVertexArrays(1, &object.id));
+                break;
+            case OpenGLObjectType::texture:
+                stateCache.forgetTexture(object.id);
+                GL_CALL(glDeleteTextures(1, &object.id));
+                break;
+            case OpenGLObjectType::framebuffer:
+                stateCache.forgetFramebuffer(object.id);
+                GL_CALL(glDeleteFramebuffers(1, &object.id));
+                break;
+            case OpenGLObjectType::shader:
+                GL_CALL(glDeleteShader(object.id));
+                break;
+            case OpenGLObjectType::program:
+                stateCache.forgetProgram(object.id);
+                GL_CALL(glDeleteProgram(object.id));
+                break;
+            case OpenGLObjectType::programPipeline:
+                stateCache.forgetProgramPipeline(object.id);
+                GL_CALL(glDeleteProgramPipelines(1, &object.id));
+                break;
+        }
+    }
+}
@@ -0,0 +1,95 @@
+﻿#pragma once
+
+#include "OpenGLBase.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace BGLRenderer
+{
+    enum class OpenGLObjectType
+    {
+        buffer,
+        vertexArray,
+        texture,
+        framebuffer,
+        shader,
+        program,
+        programPipeline
+    };
+
+    /// @brief Defers deletion of GL objects until frames which may still use them are rendered.
+    /// Resource destructors can run on any thread, names are deleted by the thread owning the context in beginFrame.
+    /// With render thread the application drops resources while previous frame packets still reference them,
+    /// retire() keeps such resource alive so its handles resolve until those frames are done
+    class OpenGLDeletionQueue
+    {
+    public:
+        OpenGLDeletionQueue() = default;
+        OpenGLDeletionQueue(const OpenGLDeletionQueue&) = delete;
+        OpenGLDeletionQueue& operator=(const OpenGLDeletionQueue&) = delete;
+
+        static OpenGLDeletionQueue& global();
+
+        /// @brief Frames recorded ahead of the frame which is rendered, 0 when everything runs on one thread
+        inline void setFramesInFlight(std::uint32_t framesInFlight) { _framesInFlight = framesInFlight; }
+        inline std::uint32_t framesInFlight() const { return _framesInFlight; }
+
+        /// @brief Thread safe, state cache forgets the name right before it's deleted
+        void deleteObject(OpenGLObjectType type, GLuint id);
+
+        /// @brief Thread safe, last reference is dropped on the context thread once frames in flight are done
+        void retire(std::shared_ptr<void> resource);
+
+        /// @brief Thread safe, release runs on the context thread once frames in flight are done.
+        /// Used for ranges of shared GL objects (e.g. geometry arena), which may still be drawn and aren't thread safe
+        void deferRelease(std::function<void()> release);
+
+        /// @brief Context thread only, deletes objects queued before every frame still in flight
+        void beginFrame();
+
+        /// @brief Context thread only, deletes everything regardless of frames in flight (e.g. on shutdown)
+        void flush();
+
+        inline std::uint64_t frame() const { return _frame; }
+
+    private:
+        struct PendingObject
+        {
+            OpenGLObjectType type;
+            GLuint id;
+            std::uint64_t frame;
+        };
+
+        struct RetiredResource
+        {
+            std::shared_ptr<void> resource;
+            std::uint64_t frame;
+        };
+
+        struct DeferredRelease
+        {
+            std::function<void()> release;
+            std::uint64_t frame;
+        };
+
+        std::mutex _mutex;
+        std::vector<PendingObject> _pendingObjects;
+        std::vector<RetiredResource> _retiredResources;
+        std::vector<DeferredRelease> _deferredReleases;
+
+        // swapped with the pending lists, so deletes happen outside of the lock and capacity is reused
+        std::vector<PendingObject> _deletedObjects;
+        std::vector<RetiredResource> _releasedResources;
+        std::vector<DeferredRelease> _dueReleases;
+
+        std::uint64_t _frame = 0;
+        std::uint32_t _framesInFlight = 0;
+
+        void collect(std::uint64_t lastFrame);
+        static void deleteNow(const PendingObject& object);
+    };
+}
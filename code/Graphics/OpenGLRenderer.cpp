@@ -1,4 +1,5 @@
 ﻿#include "OpenGLRenderer.h"
+#include "OpenGLDeletionQueue.h"
 
 #include <../../lib/ImGui/imgui.h>
 
@@ -8,12 +9,16 @@ namespace BGLRenderer
     constexpr int GBufferNormalsAttachment = 1;
     constexpr int GBufferSurfaceAttachment = 2;
 
-    OpenGLRenderer::OpenGLRenderer(const std::shared_ptr<AssetManager>& assetManager, int frameWidth, int frameHeight) :
+    OpenGLRenderer::OpenGLRenderer(const std::shared_ptr<AssetManager>& assetManager,
+                                   const std::shared_ptr<JobSystem>& jobSystem, int frameWidth, int frameHeight) :
         _environmentMapGenerator(this, assetManager),
         _assetManager(assetManager),
+        _jobSystem(jobSystem),
         _frameWidth(frameWidth),
         _frameHeight(frameHeight)
     {
+        _stateCache.makeCurrent();
+
         initializeDefaultResources();
 
         _systemInfo += "Vendor: ";
@@ -40,10 +45,10 @@ namespace BGLRenderer
     {
         ImGui::Begin("Renderer");
 
-        ImGui::ColorEdit3("Ambient Light", glm::value_ptr(_ambientLight));
-        ImGui::InputFloat3("Directional Light - Direction", glm::value_ptr(_directionalLightDirection));
-        ImGui::InputFloat3("Directional Light - Color", glm::value_ptr(_directionalLightColor));
-        ImGui::InputFloat("Directional Light - Intensity", &_directionalLightIntensity);
+        ImGui::ColorEdit3("Ambient Light", glm::value_ptr(_settings.ambientLight));
+        ImGui::InputFloat3("Directional Light - Direction", glm::value_ptr(_settings.directionalLightDirection));
+        ImGui::InputFloat3("Directional Light - Color", glm::value_ptr(_settings.directionalLightColor));
+        ImGui::InputFloat("Directional Light - Intensity", &_settings.directionalLightIntensity);
 
         static const char* bufferToDisplayStrings[] = {
             "Final Frame",
@@ -68,7 +73,7 @@ namespace BGLRenderer
         int selectedItem = 0;
         for (int i = 0; i < bufferToDisplayCount; ++i)
         {
-            if (_bufferToDisplay == bufferToDisplayValues[i])
+            if (_settings.bufferToDisplay == bufferToDisplayValues[i])
             {
                 selectedItem = i;
                 break;
@@ -76,9 +81,29 @@ namespace BGLRenderer
         }
 
         ImGui::Combo("Buffer to display", &selectedItem, bufferToDisplayStrings, bufferToDisplayCount);
-        _bufferToDisplay = bufferToDisplayValues[selectedItem];
+        _settings.bufferToDisplay = bufferToDisplayValues[selectedItem];
+
+        ImGui::Checkbox("Post Processing", &_settings.postProcess);
+        ImGui::Checkbox("Instancing", &_settings.instancing);
+        ImGui::Checkbox("Frustum Culling", &_settings.frustumCulling);
+
+        if (_geometryArena != nullptr)
+        {
+            ImGui::Checkbox("Multi Draw Indirect", &_settings.multiDrawIndirect);
 
-        ImGui::Checkbox("Post Processing", &_postProcess);
+            const GeometryArenaStats& arenaStats = _stats.geometryArena;
+            ImGui::Text("Geometry arena: %zu meshes, %.2f / %.2f MB", arenaStats.allocations,
+                        static_cast<double>(arenaStats.bytesUsed()) / (1024.0 * 1024.0),
+                        static_cast<double>(arenaStats.bytesCapacity()) / (1024.0 * 1024.0));
+            ImGui::Text("Fragmentation: vertices %.3f, indices %.3f", arenaStats.vertexFragmentation,
+                        arenaStats.indexFragmentation);
+
+            // arena is used by the frame being rendered, so it's defragmented when the next one starts
+            if (ImGui::Button("Defragment geometry arena"))
+            {
+                _defragmentRequested = true;
+            }
+        }
 
         ImGui::End();
     }
@@ -95,19 +120,207 @@ namespace BGLRenderer
 
     void OpenGLRenderer::beginFrame()
     {
-        _meshEntries.clear();
+        _frameSettings = _settings;
+        _draws.clear();
+        prepareFrame();
+    }
+
+    void OpenGLRenderer::beginPacket(FramePacket& packet)
+    {
+        ASSERT(_recordedPacket == nullptr, "Previous frame packet wasn't ended");
+
+        _recordedPacket = &packet;
+        _stats = packet.stats;
+
+        packet.draws.clear();
+        packet.hasCamera = false;
+        packet.settings = _settings;
+        packet.gizmos.setAssets(_gizmos.assets());
+        packet.gizmos.beginFrame();
+    }
+
+    void OpenGLRenderer::endPacket()
+    {
+        ASSERT(_recordedPacket != nullptr, "No frame packet is recorded");
+
+        // camera is usually set once, so it's copied when the packet is finished
+        if (_camera != nullptr)
+        {
+            _recordedPacket->camera = *_camera;
+            _recordedPacket->hasCamera = true;
+        }
+
+        _recordedPacket = nullptr;
+    }
+
+    void OpenGLRenderer::renderPacket(FramePacket& packet)
+    {
+        if (packet.frameWidth != _frameWidth || packet.frameHeight != _frameHeight)
+        {
+            resizeFrame(packet.frameWidth, packet.frameHeight);
+        }
+
+        _frameSettings = packet.settings;
+        prepareFrame();
+
+        _renderCamera = packet.hasCamera ? &packet.camera : nullptr;
+        submitDraws(packet.draws);
+
+        renderFrame(packet.gizmos);
+        packet.stats = _frameStats;
+    }
+
+    void OpenGLRenderer::prepareFrame()
+    {
+        OpenGLDeletionQueue::global().beginFrame();
+
+        if (_defragmentRequested.exchange(false) && _geometryArena != nullptr)
+        {
+            _geometryArena->defragment();
+        }
+
+        // other code (e.g. ImGui backend) changes state between frames without the cache
+        _stateCache.invalidate();
+        _stateCache.resetStats();
+
+        // transient containers reserve what the previous frame needed, so they are allocated once per frame
+        FrameArena::global().beginFrame();
+
+        _renderQueue.clear();
+        _gizmos.beginFrame();
+        resetFrameVector(_instanceData, _instanceData.capacity());
+        resetFrameVector(_drawBatches, _drawBatches.capacity());
+        resetFrameVector(_indirectCommands, _indirectCommands.capacity());
+        resetFrameVector(_deferredDraws, _deferredDraws.capacity());
+    }
+
+    void OpenGLRenderer::submit(OpenGLMaterialHandle material, OpenGLMeshHandle mesh, const glm::mat4& model)
+    {
+        recordedDraws().push_back({material, mesh, model});
+    }
+
+    void OpenGLRenderer::submitDraws(const std::vector<FramePacketDraw>& draws)
+    {
+        const std::size_t count = draws.size();
+        const std::size_t firstSlot = _renderQueue.reserveEntries(count);
+        _deferredDraws.assign(count, 0);
+
+        auto prepareChunk = [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                prepareDraw(draws[i], firstSlot + i, _deferredDraws[i]);
+            }
+        };
+
+        if (_jobSystem != nullptr)
+        {
+            _jobSystem->parallelFor(count, drawPreparationChunkSize, prepareChunk);
+        }
+        else
+        {
+            prepareChunk(0, count);
+        }
+
+        _renderQueue.commitEntries();
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (_deferredDraws[i] != 0)
+            {
+                submitDraw(draws[i].material, draws[i].mesh, draws[i].model);
+            }
+        }
+    }
+
+    void OpenGLRenderer::prepareDraw(const FramePacketDraw& draw, std::size_t slot, std::uint8_t& deferred)
+    {
+        OpenGLMesh* mesh = HandlePool<OpenGLMesh>::global().get(draw.mesh);
+        if (mesh == nullptr)
+        {
+            return;
+        }
+
+        // variant selection may load programs, so only the context thread does it
+        OpenGLMaterial* material = HandlePool<OpenGLMaterial>::global().get(draw.material);
+        if (material != nullptr && !material->programSelected())
+        {
+            deferred = 1;
+            return;
+        }
+
+        if (material == nullptr || !material->valid())
+        {
+            material = _fallbackMaterial.get();
+
+            if (!material->programSelected())
+            {
+                deferred = 1;
+                return;
+            }
+
+            if (!material->valid())
+            {
+                return;
+            }
+        }
+
+        _renderQueue.writeEntry(slot, *material, *mesh, draw.model, normalizedDepth(draw.model));
+    }
+
+    void OpenGLRenderer::submitDraw(OpenGLMaterialHandle material, OpenGLMeshHandle mesh, const glm::mat4& model)
+    {
+        OpenGLMesh* resolvedMesh = HandlePool<OpenGLMesh>::global().get(mesh);
+        if (resolvedMesh == nullptr)
+        {
+            return;
+        }
+
+        OpenGLMaterial* resolvedMaterial = HandlePool<OpenGLMaterial>::global().get(material);
+        if (resolvedMaterial == nullptr || !resolvedMaterial->valid())
+        {
+            resolvedMaterial = _fallbackMaterial.get();
+        }
+
+        // fallback program may still be compiling when it's loaded after startup
+        if (!resolvedMaterial->valid())
+        {
+            return;
+        }
+
+        _renderQueue.submit(*resolvedMaterial, *resolvedMesh, model, normalizedDepth(model));
+    }
+
+    float OpenGLRenderer::normalizedDepth(const glm::mat4& model) const
+    {
+        if (_renderCamera == nullptr)
+        {
+            return 0.0f;
+        }
+
+        glm::vec3 toObject = glm::vec3(model[3]) - _renderCamera->transform.position;
+        return glm::dot(toObject, _renderCamera->forward()) / _renderCamera->farZ;
     }
 
     void OpenGLRenderer::endFrame()
     {
-        _frameData.view = _camera->view();
-        _frameData.projection = _camera->projection();
-        _frameData.viewProjection = _frameData.projection * _frameData.view;
-        _frameData.viewInv = glm::inverse(_frameData.view);
-        _frameData.projectionInv = glm::inverse(_frameData.projection);
-        _frameData.viewProjectionInv = glm::inverse(_frameData.viewProjection);
-        _frameData.resolution = glm::vec2(static_cast<float>(_frameWidth),
-                                          static_cast<float>(_frameHeight));
+        _renderCamera = _camera.get();
+        submitDraws(_draws);
+
+        renderFrame(_gizmos);
+        _stats = _frameStats;
+    }
+
+    void OpenGLRenderer::renderFrame(Gizmos& gizmos)
+    {
+        updateFrameData();
+
+        if (_frameSettings.frustumCulling)
+        {
+            _renderQueue.cull(Frustum::fromViewProjection(_frameData.viewProjection), _jobSystem.get());
+        }
+
+        _renderQueue.sort();
 
         gbufferPass();
         ambientLightPass();
@@ -117,15 +330,23 @@ namespace BGLRenderer
         skyboxPass();
         presentFinalFrame();
 
-        GL_CALL(glDepthMask(GL_TRUE));
-        GL_CALL(glEnable(GL_DEPTH_TEST));
-        GL_CALL(glDepthFunc(GL_LEQUAL));
-        GL_CALL(glEnable(GL_CULL_FACE));
-        GL_CALL(glCullFace(GL_BACK));
+        _stateCache.setDepthWrite(true);
+        _stateCache.setDepthTest(true);
+        _stateCache.setDepthFunc(GL_LEQUAL);
+        _stateCache.setCulling(true);
+        _stateCache.setCullFace(GL_BACK);
 
         GL_CALL(glClear(GL_DEPTH_BUFFER_BIT));
 
-        _gizmos.render(_frameData.viewProjection);
+        gizmos.render();
+
+        _frameStats.renderQueue = _renderQueue.stats();
+        _frameStats.stateCache = _stateCache.stats();
+        _frameStats.frameArena = FrameArena::global().stats();
+        if (_geometryArena != nullptr)
+        {
+            _frameStats.geometryArena = _geometryArena->stats();
+        }
     }
 
     void OpenGLRenderer::generateEnvironmentMap(const std::shared_ptr<OpenGLEnvironmentMap>& environmentMap,
@@ -138,9 +359,43 @@ namespace BGLRenderer
     {
         _logger.debug("Initializing default resources");
 
+        _frameDataBuffer = std::make_shared<OpenGLBuffer>("Frame Data", GL_UNIFORM_BUFFER,
+                                                          static_cast<GLsizeiptr>(sizeof(OpenGLFrameData)));
+        _frameDataBuffer->bindBase(UniformBlockBinding::frameData);
+
+        // has to exist before any model is loaded, so their meshes end up in the arena
+        if (GLAD_GL_VERSION_4_3 || (GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_ARB_base_instance))
+        {
+            constexpr GLuint arenaVertexCapacity = 1u << 18;
+            constexpr GLuint arenaIndexCapacity = 1u << 20;
+            constexpr GLsizeiptr initialCommandCapacity = 256;
+
+            // models are compressed by default, other layouts are drawn outside of the arena
+            _geometryArena = std::make_shared<OpenGLGeometryArena>(VertexLayout::standard().compressed(),
+                                                                   arenaVertexCapacity, arenaIndexCapacity);
+            _indirectBuffer = std::make_shared<OpenGLBuffer>("Indirect Commands", GL_DRAW_INDIRECT_BUFFER,
+                                                             initialCommandCapacity *
+                                                             sizeof(DrawElementsIndirectCommand),
+                                                             GL_STREAM_DRAW);
+            _assetManager->setGeometryArena(_geometryArena);
+        }
+        else
+        {
+            _logger.warning("Multi draw indirect is not supported, geometry arena is disabled");
+            _settings.multiDrawIndirect = false;
+        }
+
         // preload some shaders
         _assetManager->getProgram("shaders/fallback");
-        _assetManager->getProgram("shaders/gbuffer_default");
+
+        // materials keep referencing regular programs, renderer swaps them for instanced variants when batching
+        _instancedPrograms[_assetManager->getProgram("shaders/gbuffer_default")->variantBaseId()] =
+                _assetManager->getProgram("shaders/gbuffer_default_instanced");
+
+        constexpr GLsizeiptr initialInstanceCapacity = 256;
+        _instanceBuffer = std::make_shared<OpenGLBuffer>("Instance Data", GL_ARRAY_BUFFER,
+                                                         initialInstanceCapacity * sizeof(RenderQueueInstanceData),
+                                                         GL_STREAM_DRAW);
 
         // textures
         constexpr int whiteTextureSize = 2;
@@ -172,49 +427,31 @@ namespace BGLRenderer
 
         _quadMesh = std::make_shared<OpenGLMesh>();
 
-        std::vector<GLfloat> quadPositions = {
-            -1.0f, -1.0f, 0.0f,
-            1.0f, -1.0f, 0.0f,
-            1.0f, 1.0f, 0.0f,
-            -1.0f, 1.0f, 0.0f,
+        const StandardVertex quadVertices[] = {
+            {{-1.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
+            {{1.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
+            {{1.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},
+            {{-1.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
         };
 
-        std::vector<GLfloat> normals = {
-            0.0f, 0.0f, 1.0f,
-            0.0f, 0.0f, 1.0f,
-            0.0f, 0.0f, 1.0f,
-            0.0f, 0.0f, 1.0f
-        };
-
-        std::vector<GLfloat> uvs = {
-            0.0f, 0.0f,
-            1.0f, 0.0f,
-            1.0f, 1.0f,
-            0.0f, 1.0f
-        };
-
-        std::vector<GLuint> indices = {
+        GLuint quadIndices[] = {
             0, 1, 2,
             2, 3, 0
         };
 
-        std::vector<GLfloat> quadTangents = {
-            1.0f, 0.0f, 0.0f,
-            1.0f, 0.0f, 0.0f,
-            1.0f, 0.0f, 0.0f,
-            1.0f, 0.0f, 0.0f
-        };
-
-        //OpenGLMesh::calculateTangents(quadTangents, quadPositions, normals, uvs, indices);
+        _quadMesh->setVertexData(VertexLayout::standard(), quadVertices, 4);
+        _quadMesh->setIndices(quadIndices, 6);
 
-        _quadMesh->setVertices(quadPositions.data(), static_cast<GLuint>(quadPositions.size()));
-        _quadMesh->setNormals(normals.data(), static_cast<GLuint>(normals.size()));
-        _quadMesh->setUVs0(uvs.data(), static_cast<GLuint>(uvs.size()));
-        _quadMesh->setIndices(indices.data(), static_cast<GLuint>(indices.size()));
-        _quadMesh->setTangents(quadTangents.data(), static_cast<GLuint>(quadTangents.size()));
+        MeshBounds quadBounds{};
+        quadBounds.box = {{-1.0f, -1.0f, 0.0f}, {1.0f, 1.0f, 0.0f}};
+        quadBounds.sphere = {{0.0f, 0.0f, 0.0f}, std::sqrt(2.0f)};
+        quadBounds.valid = true;
+        _quadMesh->setBounds(quadBounds);
+        _quadMesh->applyRetention(MeshDataRetention::discard);
 
         _baseColorProgram = _assetManager->getProgram("shaders/base_color");
-        _baseTextureProgram = _assetManager->getProgram("shaders/basic");
+        // fullscreen passes share one vertex stage, with separable programs it's compiled only once
+        _baseTexturePipeline = _assetManager->getProgramPipeline(fullscreenVertexShader, "shaders/basic.frag");
 
         // GBuffer - do not change the order of attachments
         _gbuffer = std::make_shared<OpenGLFramebuffer>("GBuffer", _frameWidth, _frameHeight);
@@ -239,31 +476,42 @@ namespace BGLRenderer
         _frameFramebuffer->setDepthAttachment(_gbuffer->depthAttachment().texture);
         _frameFramebuffer->validate();
 
-        _ambientLightProgram = _assetManager->getProgram("shaders/light_ambient");
-        _directionalLightProgram = _assetManager->getProgram("shaders/light_directional");
-        _combineFinalFrameProgram = _assetManager->getProgram("shaders/combine_finalframe");
-        _postProcessGammaCorrectionProgram = _assetManager->getProgram("shaders/postprocess.vert",
-                                                                       "shaders/postprocess_gammacorrection.frag");
+        _ambientLightPipeline = _assetManager->getProgramPipeline(fullscreenVertexShader, "shaders/light_ambient.frag");
+        _directionalLightPipeline = _assetManager->getProgramPipeline(fullscreenVertexShader,
+                                                                      "shaders/light_directional.frag");
+        _combineFinalFramePipeline = _assetManager->getProgramPipeline(fullscreenVertexShader,
+                                                                       "shaders/combine_finalframe.frag");
+        _postProcessGammaCorrectionPipeline = _assetManager->getProgramPipeline(fullscreenVertexShader,
+                                                                                "shaders/postprocess_gammacorrection.frag");
 
         // debug stuff
-        _textureChannelProgram = _assetManager->getProgram("shaders/debug_texture.vert",
-                                                           "shaders/debug_texture_channel.frag");
+        _textureChannelPipeline = _assetManager->getProgramPipeline(fullscreenVertexShader,
+                                                                    "shaders/debug_texture_channel.frag");
+
+        // gizmos shader reads only positions and normals and gizmos never read geometry back,
+        // sphere is shared with scene models so it's requested with their default options
+        ModelLoadOptions gizmosLoadOptions{};
+        gizmosLoadOptions.vertexLayout = VertexLayout::positionNormal();
+        gizmosLoadOptions.retention = MeshDataRetention::discard;
 
         GizmosAssets gizmosAssets{};
         gizmosAssets.gizmosProgram = _assetManager->getProgram("shaders/gizmos");
-        gizmosAssets.arrow = _assetManager->getModel("gizmos/arrow.gltf", gizmosAssets.gizmosProgram)->submeshes()[0].
-                mesh;
-        gizmosAssets.sphere = _assetManager->getModel("sphere_hres.gltf", gizmosAssets.gizmosProgram)->submeshes()[0].
-                mesh;
-        gizmosAssets.wireCube = _assetManager->getModel("gizmos/wire_cube.gltf", gizmosAssets.gizmosProgram)->
-                submeshes()[0].mesh;
+        gizmosAssets.arrow = _assetManager->getModel("gizmos/arrow.gltf", gizmosAssets.gizmosProgram,
+                                                     gizmosLoadOptions)->submeshes()[0].mesh;
+        gizmosAssets.sphere = _assetManager->getModel("sphere_hres.gltf", gizmosAssets.gizmosProgram,
+                                                      ModelLoadOptions{})->submeshes()[0].mesh;
+        gizmosAssets.wireCube = _assetManager->getModel("gizmos/wire_cube.gltf", gizmosAssets.gizmosProgram,
+                                                        gizmosLoadOptions)->submeshes()[0].mesh;
         _gizmos.setAssets(gizmosAssets);
+
+        // every program above was only submitted, so the driver could compile them in parallel
+        _assetManager->programLoader()->finishPendingPrograms();
     }
 
     void OpenGLRenderer::skyboxPass()
     {
         _frameFramebuffer->bind();
-        glViewport(0, 0, _frameWidth, _frameHeight);
+        _stateCache.setViewport(0, 0, _frameWidth, _frameHeight);
 
         _environmentMap->cubemap()->bind(0);
 
@@ -279,9 +527,9 @@ namespace BGLRenderer
         glm::mat4 viewProjectionInv = glm::inverse(_frameData.projection * viewNoTranslate);
         _skyboxProgram->setMatrix4x4("u_viewProjectionInv", viewProjectionInv);
 
-        GL_CALL(glEnable(GL_DEPTH_TEST));
-        GL_CALL(glDepthMask(GL_FALSE));
-        GL_CALL(glDepthFunc(GL_LEQUAL));
+        _stateCache.setDepthTest(true);
+        _stateCache.setDepthWrite(false);
+        _stateCache.setDepthFunc(GL_LEQUAL);
 
         _quadMesh->bind();
         _quadMesh->draw();
@@ -300,13 +548,13 @@ namespace BGLRenderer
         };
         GL_CALL(glDrawBuffers(3, drawTargets));
 
-        glViewport(0, 0, _frameWidth, _frameHeight);
+        _stateCache.setViewport(0, 0, _frameWidth, _frameHeight);
 
-        GL_CALL(glDepthMask(GL_TRUE));
-        GL_CALL(glEnable(GL_DEPTH_TEST));
-        GL_CALL(glDepthFunc(GL_LEQUAL));
-        GL_CALL(glEnable(GL_CULL_FACE));
-        GL_CALL(glCullFace(GL_BACK));
+        _stateCache.setDepthWrite(true);
+        _stateCache.setDepthTest(true);
+        _stateCache.setDepthFunc(GL_LEQUAL);
+        _stateCache.setCulling(true);
+        _stateCache.setCullFace(GL_BACK);
 
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -320,13 +568,13 @@ namespace BGLRenderer
     {
         _lightBuffer->bind();
 
-        glViewport(0, 0, _frameWidth, _frameHeight);
+        _stateCache.setViewport(0, 0, _frameWidth, _frameHeight);
 
         GL_CALL(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
         GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
 
-        GL_CALL(glDisable(GL_BLEND));
-        GL_CALL(glDisable(GL_DEPTH_TEST));
+        _stateCache.setBlend(false);
+        _stateCache.setDepthTest(false);
 
         _gbuffer->colorAttachments()[GBufferAlbedoAttachment].texture->bind(0);
         _gbuffer->colorAttachments()[GBufferNormalsAttachment].texture->bind(1);
@@ -334,15 +582,12 @@ namespace BGLRenderer
         _gbuffer->depthAttachment().texture->bind(3);
         _environmentMap->irradianceMap()->bind(4);
 
-        _ambientLightProgram->bind();
-        _ambientLightProgram->setInt("u_albedo", 0);
-        _ambientLightProgram->setInt("u_normal", 1);
-        _ambientLightProgram->setInt("u_surface", 2);
-        _ambientLightProgram->setInt("u_depth", 3);
-        _ambientLightProgram->setInt("u_irradiance", 4);
-
-        setFrameDataUniforms(_ambientLightProgram, _frameData);
-        setCameraUniforms(_ambientLightProgram, _camera);
+        _ambientLightPipeline->bind();
+        _ambientLightPipeline->setInt("u_albedo", 0);
+        _ambientLightPipeline->setInt("u_normal", 1);
+        _ambientLightPipeline->setInt("u_surface", 2);
+        _ambientLightPipeline->setInt("u_depth", 3);
+        _ambientLightPipeline->setInt("u_irradiance", 4);
 
         _quadMesh->bind();
         _quadMesh->draw();
@@ -354,11 +599,11 @@ namespace BGLRenderer
     {
         _lightBuffer->bind();
 
-        glViewport(0, 0, _frameWidth, _frameHeight);
+        _stateCache.setViewport(0, 0, _frameWidth, _frameHeight);
 
         // directional light
-        GL_CALL(glEnable(GL_BLEND));
-        GL_CALL(glBlendFunc(GL_ONE, GL_ONE));
+        _stateCache.setBlend(true);
+        _stateCache.setBlendFunc(GL_ONE, GL_ONE);
 
         _gbuffer->colorAttachments()[GBufferAlbedoAttachment].texture->bind(0);
         _gbuffer->colorAttachments()[GBufferNormalsAttachment].texture->bind(1);
@@ -367,22 +612,20 @@ namespace BGLRenderer
 
         _environmentMap->cubemap()->bind(4);
 
-        _directionalLightProgram->bind();
-        _directionalLightProgram->setInt("u_albedo", 0);
-        _directionalLightProgram->setInt("u_normal", 1);
-        _directionalLightProgram->setInt("u_surface", 2);
-        _directionalLightProgram->setInt("u_depth", 3);
-        _directionalLightProgram->setInt("u_skyTexture", 4);
-        _directionalLightProgram->setVector3("u_direction", _directionalLightDirection);
-        _directionalLightProgram->setVector3("u_color", _directionalLightColor);
-        _directionalLightProgram->setFloat("u_intensity", _directionalLightIntensity);
-        setFrameDataUniforms(_directionalLightProgram, _frameData);
-        setCameraUniforms(_directionalLightProgram, _camera);
+        _directionalLightPipeline->bind();
+        _directionalLightPipeline->setInt("u_albedo", 0);
+        _directionalLightPipeline->setInt("u_normal", 1);
+        _directionalLightPipeline->setInt("u_surface", 2);
+        _directionalLightPipeline->setInt("u_depth", 3);
+        _directionalLightPipeline->setInt("u_skyTexture", 4);
+        _directionalLightPipeline->setVector3("u_direction", _frameSettings.directionalLightDirection);
+        _directionalLightPipeline->setVector3("u_color", _frameSettings.directionalLightColor);
+        _directionalLightPipeline->setFloat("u_intensity", _frameSettings.directionalLightIntensity);
 
         _quadMesh->bind();
         _quadMesh->draw();
 
-        GL_CALL(glDisable(GL_BLEND));
+        _stateCache.setBlend(false);
         _lightBuffer->unbind();
 
         _gbuffer->colorAttachments()[GBufferNormalsAttachment].texture->unbind();
@@ -393,16 +636,16 @@ namespace BGLRenderer
     {
         _frameFramebuffer->bind();
 
-        glViewport(0, 0, _frameWidth, _frameHeight);
+        _stateCache.setViewport(0, 0, _frameWidth, _frameHeight);
 
-        GL_CALL(glDisable(GL_BLEND));
+        _stateCache.setBlend(false);
 
-        GL_CALL(glDepthMask(GL_TRUE));
-        GL_CALL(glEnable(GL_DEPTH_TEST));
-        GL_CALL(glDepthFunc(GL_LEQUAL));
+        _stateCache.setDepthWrite(true);
+        _stateCache.setDepthTest(true);
+        _stateCache.setDepthFunc(GL_LEQUAL);
 
-        GL_CALL(glEnable(GL_CULL_FACE));
-        GL_CALL(glCullFace(GL_BACK));
+        _stateCache.setCulling(true);
+        _stateCache.setCullFace(GL_BACK);
 
         renderMeshEntries(MaterialType::unlit);
 
@@ -411,11 +654,11 @@ namespace BGLRenderer
 
     void OpenGLRenderer::combineLighting()
     {
-        GL_CALL(glDisable(GL_DEPTH_TEST));
+        _stateCache.setDepthTest(false);
 
         _frameFramebuffer->bind();
 
-        glViewport(0, 0, _frameWidth, _frameHeight);
+        _stateCache.setViewport(0, 0, _frameWidth, _frameHeight);
 
         constexpr GLenum drawTargets[] = {
             GL_COLOR_ATTACHMENT0
@@ -425,9 +668,9 @@ namespace BGLRenderer
         _gbuffer->colorAttachments()[GBufferAlbedoAttachment].texture->bind(0);
         _lightBuffer->colorAttachments()[0].texture->bind(1);
 
-        _combineFinalFrameProgram->bind();
-        _combineFinalFrameProgram->setInt("u_albedo", 0);
-        _combineFinalFrameProgram->setInt("u_light", 1);
+        _combineFinalFramePipeline->bind();
+        _combineFinalFramePipeline->setInt("u_albedo", 0);
+        _combineFinalFramePipeline->setInt("u_light", 1);
 
         _quadMesh->bind();
         _quadMesh->draw();
@@ -440,24 +683,24 @@ namespace BGLRenderer
 
     void OpenGLRenderer::presentFinalFrame()
     {
-        GL_CALL(glDisable(GL_DEPTH_TEST));
-        GL_CALL(glDisable(GL_CULL_FACE));
+        _stateCache.setDepthTest(false);
+        _stateCache.setCulling(false);
 
-        glViewport(0, 0, _frameWidth, _frameHeight);
+        _stateCache.setViewport(0, 0, _frameWidth, _frameHeight);
         GL_CALL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 
         std::shared_ptr<OpenGLTexture2D> bufferTexture = nullptr;
 
-        if (_bufferToDisplay == BufferToDisplay::finalFrame)
+        if (_frameSettings.bufferToDisplay == BufferToDisplay::finalFrame)
         {
             bufferTexture = _frameTexture;
 
-            if (_postProcess)
+            if (_frameSettings.postProcess)
             {
                 bufferTexture->bind(0);
 
-                _postProcessGammaCorrectionProgram->bind();
-                _postProcessGammaCorrectionProgram->setInt("u_texture", 0);
+                _postProcessGammaCorrectionPipeline->bind();
+                _postProcessGammaCorrectionPipeline->setInt("u_texture", 0);
 
                 _quadMesh->bind();
                 _quadMesh->draw();
@@ -467,28 +710,27 @@ namespace BGLRenderer
                 return;
             }
         }
-        else if (_bufferToDisplay == BufferToDisplay::lightBuffer)
+        else if (_frameSettings.bufferToDisplay == BufferToDisplay::lightBuffer)
         {
             bufferTexture = _lightBuffer->colorAttachments()[0].texture;
         }
-        else if (_bufferToDisplay == BufferToDisplay::albedo)
+        else if (_frameSettings.bufferToDisplay == BufferToDisplay::albedo)
         {
             bufferTexture = _gbuffer->colorAttachments()[GBufferAlbedoAttachment].texture;
         }
-        else if (_bufferToDisplay == BufferToDisplay::normal)
+        else if (_frameSettings.bufferToDisplay == BufferToDisplay::normal)
         {
             bufferTexture = _gbuffer->colorAttachments()[GBufferNormalsAttachment].texture;
         }
-        else if (_bufferToDisplay == BufferToDisplay::roughness)
+        else if (_frameSettings.bufferToDisplay == BufferToDisplay::roughness)
         {
             bufferTexture = _gbuffer->colorAttachments()[GBufferSurfaceAttachment].texture;
 
             bufferTexture->bind(0);
 
-            _textureChannelProgram->bind();
-            _textureChannelProgram->setInt(_textureChannelProgram->getUniformLocation("u_texture"), 0);
-            _textureChannelProgram->setVector4(_textureChannelProgram->getUniformLocation("u_channel"),
-                                               glm::vec4{1, 0, 0, 0});
+            _textureChannelPipeline->bind();
+            _textureChannelPipeline->setInt("u_texture", 0);
+            _textureChannelPipeline->setVector4("u_channel", glm::vec4{1, 0, 0, 0});
 
             _quadMesh->bind();
             _quadMesh->draw();
@@ -496,15 +738,15 @@ namespace BGLRenderer
             bufferTexture->unbind();
             return;
         }
-        else if (_bufferToDisplay == BufferToDisplay::metallic)
+        else if (_frameSettings.bufferToDisplay == BufferToDisplay::metallic)
         {
             bufferTexture = _gbuffer->colorAttachments()[GBufferSurfaceAttachment].texture;
 
             bufferTexture->bind(0);
 
-            _textureChannelProgram->bind();
-            _textureChannelProgram->setInt("u_texture", 0);
-            _textureChannelProgram->setVector4("u_channel", glm::vec4{0, 1, 0, 0});
+            _textureChannelPipeline->bind();
+            _textureChannelPipeline->setInt("u_texture", 0);
+            _textureChannelPipeline->setVector4("u_channel", glm::vec4{0, 1, 0, 0});
 
             _quadMesh->bind();
             _quadMesh->draw();
@@ -512,7 +754,7 @@ namespace BGLRenderer
             bufferTexture->unbind();
             return;
         }
-        else if (_bufferToDisplay == BufferToDisplay::depth)
+        else if (_frameSettings.bufferToDisplay == BufferToDisplay::depth)
         {
             bufferTexture = _gbuffer->depthAttachment().texture;
         }
@@ -521,11 +763,9 @@ namespace BGLRenderer
 
         bufferTexture->bind(0);
 
-        _baseTextureProgram->bind();
-        _baseTextureProgram->setVector4("u_tint", {1, 1, 1, 1});
-        _baseTextureProgram->setInt("u_baseColor", 0);
-        _baseTextureProgram->setMatrix4x4("u_model", glm::mat4(1.0f));
-        _baseTextureProgram->setMatrix4x4("u_viewProjection", glm::mat4(1.0f));
+        _baseTexturePipeline->bind();
+        _baseTexturePipeline->setVector4("u_tint", {1, 1, 1, 1});
+        _baseTexturePipeline->setInt("u_baseColor", 0);
 
         _quadMesh->bind();
         _quadMesh->draw();
@@ -533,50 +773,349 @@ namespace BGLRenderer
         bufferTexture->unbind();
     }
 
-    void OpenGLRenderer::setCameraUniforms(const std::shared_ptr<OpenGLProgram>& program,
-                                           const std::shared_ptr<PerspectiveCamera>& camera)
+    void OpenGLRenderer::updateFrameData()
     {
-        program->setVector3("u_cameraPosition", camera->transform.position);
-        program->setVector3("u_cameraDirection", camera->forward());
+        _frameData.view = _renderCamera->view();
+        _frameData.projection = _renderCamera->projection();
+        _frameData.viewProjection = _frameData.projection * _frameData.view;
+        _frameData.viewInv = glm::inverse(_frameData.view);
+        _frameData.projectionInv = glm::inverse(_frameData.projection);
+        _frameData.viewProjectionInv = glm::inverse(_frameData.viewProjection);
+        _frameData.cameraPosition = _renderCamera->transform.position;
+        _frameData.cameraDirection = _renderCamera->forward();
+        _frameData.resolution = glm::vec2(static_cast<float>(_frameWidth),
+                                          static_cast<float>(_frameHeight));
+
+        // buffer stays bound to its binding point, other code shouldn't rebind that slot
+        _frameDataBuffer->setData(_frameData);
     }
 
     void OpenGLRenderer::renderMeshEntries(MaterialType materialType)
     {
-        for (const auto& meshEntry: _meshEntries)
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        _renderQueue.passRange(materialType, begin, end);
+
+        buildDrawBatches(begin, end);
+        uploadInstanceData();
+        uploadIndirectCommands();
+
+        RenderQueueStats& stats = _renderQueue.stats();
+
+        // state is not tracked across passes, other passes bind their own programs and meshes
+        const OpenGLProgram* boundProgram = nullptr;
+        const OpenGLMaterial* boundMaterial = nullptr;
+        const void* boundVertexArray = nullptr;
+
+        // decode uniforms belong to the program, instanced draws take them from instance data instead
+        const OpenGLProgram* decodeProgram = nullptr;
+        const OpenGLMesh* decodeMesh = nullptr;
+
+        for (const DrawBatch& batch: _drawBatches)
+        {
+            const RenderQueueEntry& entry = _renderQueue.sortedEntry(batch.firstEntry);
+            OpenGLMaterial* material = entry.material();
+            OpenGLMesh* mesh = entry.mesh();
+            OpenGLProgram* program = batch.type == DrawBatchType::single
+                                         ? entry.program()
+                                         : instancedProgramFor(entry.program());
+
+            if (program != boundProgram)
+            {
+                program->bind();
+                boundProgram = program;
+                boundMaterial = nullptr;
+                stats.programBinds++;
+            }
+            else
+            {
+                stats.programBindsSkipped++;
+            }
+
+            if (material != boundMaterial)
+            {
+                material->bindValues(*program);
+                boundMaterial = material;
+                stats.materialBinds++;
+            }
+            else
+            {
+                stats.materialBindsSkipped++;
+            }
+
+            // every mesh in the arena shares one vertex array, so switching between them doesn't rebind it
+            const bool inArena = batch.type == DrawBatchType::multiDrawIndirect || mesh->isInArena();
+            const void* vertexArray = inArena
+                                          ? static_cast<const void*>(_geometryArena.get())
+                                          : static_cast<const void*>(mesh);
+
+            if (vertexArray != boundVertexArray)
+            {
+                if (inArena)
+                {
+                    // arena draws address instances through base instance, so attributes start at the buffer beginning
+                    _geometryArena->bind();
+                    bindInstanceAttributes(0);
+                }
+                else
+                {
+                    mesh->bind();
+                }
+
+                boundVertexArray = vertexArray;
+                stats.meshBinds++;
+            }
+            else
+            {
+                stats.meshBindsSkipped++;
+            }
+
+            switch (batch.type)
+            {
+                case DrawBatchType::single:
+                    if (program != decodeProgram || mesh != decodeMesh)
+                    {
+                        mesh->bindDecodeParameters(*program);
+                        decodeProgram = program;
+                        decodeMesh = mesh;
+                    }
+
+                    program->setMatrix4x4("u_model", entry.model);
+                    mesh->draw();
+                    break;
+
+                case DrawBatchType::instanced:
+                    if (mesh->isInArena())
+                    {
+                        mesh->drawInstanced(static_cast<GLsizei>(batch.count), batch.firstInstance);
+                    }
+                    else
+                    {
+                        bindInstanceAttributes(batch.firstInstance);
+                        mesh->drawInstanced(static_cast<GLsizei>(batch.count));
+                    }
+
+                    stats.instancedDrawCalls++;
+                    stats.instancedObjects += static_cast<int>(batch.count);
+                    break;
+
+                case DrawBatchType::multiDrawIndirect:
+                    _indirectBuffer->bind();
+                    GL_CALL(glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                        reinterpret_cast<const void*>(batch.firstCommand * sizeof(DrawElementsIndirectCommand)),
+                        static_cast<GLsizei>(batch.commandCount), 0));
+
+                    stats.multiDrawCalls++;
+                    stats.indirectCommands += static_cast<int>(batch.commandCount);
+                    break;
+            }
+
+            stats.drawCalls++;
+        }
+    }
+
+    void OpenGLRenderer::buildDrawBatches(std::size_t begin, std::size_t end)
+    {
+        _drawBatches.clear();
+        _instanceData.clear();
+        _indirectCommands.clear();
+
+        const bool multiDrawIndirect = _frameSettings.multiDrawIndirect && _geometryArena != nullptr;
+
+        std::size_t index = begin;
+        while (index < end)
         {
-            std::shared_ptr<OpenGLMaterial> material = meshEntry.material;
-            if (material == nullptr || !material->valid())
+            const RenderQueueEntry& first = _renderQueue.sortedEntry(index);
+            const OpenGLMaterial* firstMaterial = first.material();
+            const bool hasInstancedProgram = instancedProgramFor(first.program()) != nullptr;
+
+            // sorting puts entries with the same program, material and mesh next to each other,
+            // so compatible draws form continuous runs
+            if (multiDrawIndirect && hasInstancedProgram && first.mesh()->isInArena())
+            {
+                // any mesh from the arena can join, material values are shared by the whole multi draw
+                std::size_t runEnd = index + 1;
+                while (runEnd < end)
+                {
+                    const RenderQueueEntry& next = _renderQueue.sortedEntry(runEnd);
+                    if (!next.mesh()->isInArena() || !firstMaterial->isInstancingCompatible(*next.material()))
+                    {
+                        break;
+                    }
+
+                    runEnd++;
+                }
+
+                DrawBatch batch{};
+                batch.type = DrawBatchType::multiDrawIndirect;
+                batch.firstEntry = index;
+                batch.count = static_cast<std::uint32_t>(runEnd - index);
+                batch.firstInstance = static_cast<std::uint32_t>(_instanceData.size());
+                batch.firstCommand = static_cast<std::uint32_t>(_indirectCommands.size());
+
+                for (std::size_t i = index; i < runEnd; ++i)
+                {
+                    const RenderQueueEntry& entry = _renderQueue.sortedEntry(i);
+                    const GLuint instanceIndex = static_cast<GLuint>(_instanceData.size());
+                    pushInstanceData(entry);
+
+                    // consecutive entries with the same mesh become instances of one command
+                    if (i > index && _renderQueue.sortedEntry(i - 1).meshHandle == entry.meshHandle)
+                    {
+                        _indirectCommands.back().instanceCount++;
+                    }
+                    else
+                    {
+                        _indirectCommands.push_back(_geometryArena->drawCommand(entry.mesh()->arenaHandle(), 1,
+                                                                                instanceIndex));
+                    }
+                }
+
+                batch.commandCount = static_cast<std::uint32_t>(_indirectCommands.size()) - batch.firstCommand;
+                _drawBatches.push_back(batch);
+
+                index = runEnd;
+                continue;
+            }
+
+            std::size_t runEnd = index + 1;
+            if (_frameSettings.instancing && hasInstancedProgram)
             {
-                material = _fallbackMaterial;
+                while (runEnd < end)
+                {
+                    const RenderQueueEntry& next = _renderQueue.sortedEntry(runEnd);
+                    if (next.meshHandle != first.meshHandle ||
+                        !firstMaterial->isInstancingCompatible(*next.material()))
+                    {
+                        break;
+                    }
+
+                    runEnd++;
+                }
             }
 
-            if (material->type() != materialType)
+            const std::uint32_t runLength = static_cast<std::uint32_t>(runEnd - index);
+            if (runLength < minInstancedBatchSize)
             {
+                _drawBatches.push_back({DrawBatchType::single, index, 1, 0, 0, 0});
+                index++;
                 continue;
             }
 
-            material->bind();
+            _drawBatches.push_back({
+                DrawBatchType::instanced, index, runLength, static_cast<std::uint32_t>(_instanceData.size()), 0, 0
+            });
+
+            for (std::size_t i = index; i < runEnd; ++i)
+            {
+                pushInstanceData(_renderQueue.sortedEntry(i));
+            }
+
+            index = runEnd;
+        }
+    }
+
+    void OpenGLRenderer::pushInstanceData(const RenderQueueEntry& entry)
+    {
+        RenderQueueInstanceData instance{};
+        instance.model = entry.model;
+        const OpenGLMaterial* material = entry.material();
+        instance.tint = material->getVector4(MaterialInstanceValueIds::tint, {1, 1, 1, 1});
+        instance.surface = {
+            material->getFloat(MaterialInstanceValueIds::roughness, 0.5f),
+            material->getFloat(MaterialInstanceValueIds::metallic, 0.0f),
+            0.0f,
+            0.0f
+        };
+
+        const VertexDecodeParameters& decodeParameters = entry.mesh()->decodeParameters();
+        instance.positionOffset = glm::vec4(decodeParameters.positionOffset,
+                                            decodeParameters.octahedralNormals ? 1.0f : 0.0f);
+        instance.positionScale = glm::vec4(decodeParameters.positionScale, 0.0f);
+
+        _instanceData.push_back(instance);
+    }
+
+    void OpenGLRenderer::uploadInstanceData()
+    {
+        if (_instanceData.empty())
+        {
+            return;
+        }
+
+        const GLsizeiptr requiredSize = static_cast<GLsizeiptr>(_instanceData.size() * sizeof(RenderQueueInstanceData));
+        if (requiredSize > _instanceBuffer->size())
+        {
+            _instanceBuffer->resize(std::max(requiredSize, _instanceBuffer->size() * 2));
+        }
+
+        _instanceBuffer->setData(_instanceData.data(), requiredSize);
+    }
+
+    void OpenGLRenderer::uploadIndirectCommands()
+    {
+        if (_indirectCommands.empty())
+        {
+            return;
+        }
+
+        const GLsizeiptr requiredSize = static_cast<GLsizeiptr>(_indirectCommands.size() *
+                                                                sizeof(DrawElementsIndirectCommand));
+        if (requiredSize > _indirectBuffer->size())
+        {
+            _indirectBuffer->resize(std::max(requiredSize, _indirectBuffer->size() * 2));
+        }
+
+        _indirectBuffer->setData(_indirectCommands.data(), requiredSize);
+    }
 
-            material->program()->setMatrix4x4("u_model", meshEntry.model);
-            setFrameDataUniforms(material->program(), _frameData);
+    void OpenGLRenderer::bindInstanceAttributes(std::uint32_t firstInstance)
+    {
+        // attribute pointers are stored in currently bound mesh's vertex array
+        _instanceBuffer->bind();
+
+        constexpr GLsizei stride = sizeof(RenderQueueInstanceData);
+        const std::size_t baseOffset = static_cast<std::size_t>(firstInstance) * stride;
 
-            meshEntry.mesh->bind();
-            meshEntry.mesh->draw();
+        auto setAttribute = [&](GLuint location, std::size_t offset)
+        {
+            GL_CALL(glEnableVertexAttribArray(location));
+            GL_CALL(glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride,
+                reinterpret_cast<const void*>(baseOffset + offset)));
+            GL_CALL(glVertexAttribDivisor(location, 1));
+        };
+
+        for (GLuint column = 0; column < 4; ++column)
+        {
+            setAttribute(InstanceAttributeLocation::model + column,
+                         offsetof(RenderQueueInstanceData, model) + column * sizeof(glm::vec4));
         }
+
+        setAttribute(InstanceAttributeLocation::tint, offsetof(RenderQueueInstanceData, tint));
+        setAttribute(InstanceAttributeLocation::surface, offsetof(RenderQueueInstanceData, surface));
+        setAttribute(InstanceAttributeLocation::positionOffset, offsetof(RenderQueueInstanceData, positionOffset));
+        setAttribute(InstanceAttributeLocation::positionScale, offsetof(RenderQueueInstanceData, positionScale));
     }
 
-    // @TODO - move this stuff to uniform buffer instead of setting these values per program
-    void OpenGLRenderer::setFrameDataUniforms(const std::shared_ptr<OpenGLProgram>& program,
-                                              const OpenGLFrameData& frameData)
+    OpenGLProgram* OpenGLRenderer::instancedProgramFor(const OpenGLProgram* program)
     {
-        program->setMatrix4x4("u_view", frameData.view);
-        program->setMatrix4x4("u_projection", frameData.projection);
-        program->setMatrix4x4("u_viewProjection", frameData.viewProjection);
+        auto it = _instancedPrograms.find(program->variantBaseId());
+        if (it == _instancedPrograms.end())
+        {
+            return nullptr;
+        }
 
-        program->setMatrix4x4("u_viewInv", frameData.viewInv);
-        program->setMatrix4x4("u_projectionInv", frameData.projectionInv);
-        program->setMatrix4x4("u_viewProjectionInv", frameData.viewProjectionInv);
+        OpenGLProgram* instancedProgram = it->second.get();
+        if (program->featureMask() != instancedProgram->featureMask())
+        {
+            instancedProgram = instancedProgram->variant(program->featureMask()).get();
+        }
+
+        if (instancedProgram == nullptr || !instancedProgram->isReady())
+        {
+            return nullptr;
+        }
 
-        program->setVector2("u_resolution", frameData.resolution);
+        return instancedProgram;
     }
 }
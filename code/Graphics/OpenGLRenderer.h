@@ -2,16 +2,25 @@
 
 #include "Gizmos.h"
 #include "OpenGLBase.h"
+#include "Resources/OpenGLBuffer.h"
 #include "Resources/OpenGLFramebuffer.h"
+#include "Resources/OpenGLGeometryArena.h"
 #include "Resources/OpenGLMaterial.h"
+#include "Resources/OpenGLProgramPipeline.h"
 #include "Resources/OpenGLEnvironmentMap.h"
 #include "OpenGLRenderObject.h"
+#include "OpenGLStateCache.h"
+#include "RenderQueue.h"
 
 #include "EnvironmentMapGenerator.h"
 
 #include <Assets/AssetManager.h>
+#include <Foundation/FrameArena.h>
+#include <Foundation/JobSystem.h>
 #include <World/PerspectiveCamera.h>
 
+#include <atomic>
+
 namespace BGLRenderer
 {
     enum class BufferToDisplay
@@ -25,6 +34,8 @@ namespace BGLRenderer
         finalFrame
     };
 
+    /// @brief Per frame values shared by every program through "FrameData" uniform block (see globals.glsl),
+    /// layout has to match std140 rules so do not reorder members without updating the shader side
     struct OpenGLFrameData
     {
         glm::mat4 view;
@@ -35,13 +46,98 @@ namespace BGLRenderer
         glm::mat4 projectionInv;
         glm::mat4 viewProjectionInv;
 
+        glm::vec3 cameraPosition;
+        float padding0;
+        glm::vec3 cameraDirection;
+        float padding1;
+
         glm::vec2 resolution;
+        glm::vec2 padding2;
+    };
+
+    static_assert(sizeof(OpenGLFrameData) == 6 * 64 + 2 * 16 + 16, "OpenGLFrameData doesn't match std140 layout");
+
+    /// @brief Values edited through the renderer window, frame uses the copy taken when it was started
+    struct OpenGLRendererSettings
+    {
+        glm::vec3 ambientLight = {0, 0, 0};
+        glm::vec3 directionalLightDirection = {0.2f, -0.5f, -1.0f};
+        glm::vec3 directionalLightColor = {1.0f, 1.0f, 1.0f};
+        float directionalLightIntensity = 1.0f;
+
+        BufferToDisplay bufferToDisplay = BufferToDisplay::finalFrame;
+
+        bool postProcess = true;
+        bool instancing = true;
+        bool frustumCulling = true;
+        bool multiDrawIndirect = true;
+    };
+
+    /// @brief Counters of the last rendered frame, copied out of the renderer so they can be read while
+    /// the next frame renders
+    struct OpenGLRendererStats
+    {
+        RenderQueueStats renderQueue;
+        OpenGLStateCacheStats stateCache;
+        FrameArenaStats frameArena;
+        GeometryArenaStats geometryArena;
+    };
+
+    struct FramePacketDraw
+    {
+        OpenGLMaterialHandle material;
+        OpenGLMeshHandle mesh;
+        glm::mat4 model;
+    };
+
+    /// @brief Draws recorded by one chunk of OpenGLRenderer::submitParallel
+    class DrawList
+    {
+    public:
+        inline void submit(OpenGLMaterialHandle material, OpenGLMeshHandle mesh, const glm::mat4& model)
+        {
+            _draws.push_back({material, mesh, model});
+        }
+
+        inline void submit(const std::shared_ptr<OpenGLMaterial>& material,
+                           const std::shared_ptr<OpenGLMesh>& mesh,
+                           const glm::mat4& model)
+        {
+            submit(material != nullptr ? material->handle() : OpenGLMaterialHandle{}, mesh->handle(), model);
+        }
+
+        inline void clear() { _draws.clear(); }
+        inline const std::vector<FramePacketDraw>& draws() const { return _draws; }
+
+    private:
+        std::vector<FramePacketDraw> _draws;
+    };
+
+    /// @brief Everything the renderer needs from the application for one frame, recorded between beginPacket
+    /// and endPacket and consumed by renderPacket, which may run on another thread. Containers keep their capacity,
+    /// so recording doesn't allocate once the scene settles
+    struct FramePacket
+    {
+        std::vector<FramePacketDraw> draws;
+
+        PerspectiveCamera camera{};
+        bool hasCamera = false;
+
+        OpenGLRendererSettings settings{};
+        int frameWidth = 0;
+        int frameHeight = 0;
+
+        Gizmos gizmos{};
+
+        /// @brief Written by renderPacket, read by beginPacket when the packet is recorded again
+        OpenGLRendererStats stats{};
     };
 
     class OpenGLRenderer
     {
     public:
-        OpenGLRenderer(const std::shared_ptr<AssetManager>& assetManager, int frameWidth, int frameHeight);
+        OpenGLRenderer(const std::shared_ptr<AssetManager>& assetManager, const std::shared_ptr<JobSystem>& jobSystem,
+                       int frameWidth, int frameHeight);
         ~OpenGLRenderer();
 
         void onIMGUI();
@@ -51,6 +147,14 @@ namespace BGLRenderer
         void beginFrame();
         void endFrame();
 
+        /// @brief Redirects submit, setCamera and gizmos of the application into the packet instead of rendering,
+        /// stats() are updated from the previous use of the packet
+        void beginPacket(FramePacket& packet);
+        void endPacket();
+
+        /// @brief Renders recorded packet, called by the thread owning the context
+        void renderPacket(FramePacket& packet);
+
         inline void setEnvironmentMap(const std::shared_ptr<OpenGLEnvironmentMap>& environmentMap)
         {
             _environmentMap = environmentMap;
@@ -58,30 +162,87 @@ namespace BGLRenderer
 
         inline void setCamera(const std::shared_ptr<PerspectiveCamera>& camera) { _camera = camera; }
 
+        /// @brief Invalid or released material is replaced by the fallback, released mesh skips the draw.
+        /// Only handles are recorded, they are resolved in parallel chunks when the frame is rendered
+        void submit(OpenGLMaterialHandle material, OpenGLMeshHandle mesh, const glm::mat4& model);
+
         inline void submit(const std::shared_ptr<OpenGLMaterial>& material,
                            const std::shared_ptr<OpenGLMesh>& mesh,
                            const glm::mat4& model)
         {
-            _meshEntries.push_back({material, mesh, model});
+            submit(material != nullptr ? material->handle() : OpenGLMaterialHandle{}, mesh->handle(), model);
+        }
+
+        /// @brief Objects recorded by one job of submitParallel
+        static constexpr std::size_t submitChunkSize = 256;
+
+        /// @brief Calls function(begin, end, drawList) for chunks of [0, objectCount) on the job system. Chunks are
+        /// merged in order, so the result is the same as submitting the objects one by one. Function runs on worker
+        /// threads and must not call the renderer
+        template <class TFunction>
+        void submitParallel(std::size_t objectCount, const TFunction& function)
+        {
+            const std::size_t chunkCount = (objectCount + submitChunkSize - 1) / submitChunkSize;
+            if (_submitChunks.size() < chunkCount)
+            {
+                _submitChunks.resize(chunkCount);
+            }
+
+            auto recordChunk = [&](std::size_t begin, std::size_t end)
+            {
+                DrawList& drawList = _submitChunks[begin / submitChunkSize];
+                drawList.clear();
+                function(begin, end, drawList);
+            };
+
+            if (_jobSystem != nullptr)
+            {
+                _jobSystem->parallelFor(objectCount, submitChunkSize, recordChunk);
+            }
+            else
+            {
+                for (std::size_t begin = 0; begin < objectCount; begin += submitChunkSize)
+                {
+                    recordChunk(begin, std::min(begin + submitChunkSize, objectCount));
+                }
+            }
+
+            std::vector<FramePacketDraw>& draws = recordedDraws();
+            for (std::size_t i = 0; i < chunkCount; ++i)
+            {
+                const std::vector<FramePacketDraw>& chunkDraws = _submitChunks[i].draws();
+                draws.insert(draws.end(), chunkDraws.begin(), chunkDraws.end());
+            }
         }
 
         void generateEnvironmentMap(const std::shared_ptr<OpenGLEnvironmentMap>& environmentMap,
                                     const std::shared_ptr<OpenGLTexture2D>& equirectangularMap);
 
+        /// @brief Vertex stage of every pass which draws quadMesh over the whole target
+        static constexpr const char* fullscreenVertexShader = "shaders/fullscreen.vert";
+
         inline std::shared_ptr<OpenGLMesh> quadMesh() { return _quadMesh; }
-        inline Gizmos& gizmos() { return _gizmos; }
+        inline Gizmos& gizmos() { return _recordedPacket != nullptr ? _recordedPacket->gizmos : _gizmos; }
 
         inline const std::string& systemInfo() const { return _systemInfo; }
+        inline const OpenGLRendererStats& stats() const { return _stats; }
+        inline const std::shared_ptr<OpenGLGeometryArena>& geometryArena() const { return _geometryArena; }
 
     private:
         Log _logger{"Renderer"};
+
+        // declared first, so it outlives every resource owned by the renderer
+        OpenGLStateCache _stateCache;
+
         EnvironmentMapGenerator _environmentMapGenerator;
 
         std::string _systemInfo;
 
         OpenGLFrameData _frameData;
+        std::shared_ptr<OpenGLBuffer> _frameDataBuffer;
 
         std::shared_ptr<AssetManager> _assetManager;
+        std::shared_ptr<JobSystem> _jobSystem;
         int _frameWidth;
         int _frameHeight;
 
@@ -89,21 +250,66 @@ namespace BGLRenderer
         std::shared_ptr<OpenGLTexture2D> _bumpTexture;
         std::shared_ptr<OpenGLMesh> _quadMesh;
         std::shared_ptr<OpenGLProgram> _baseColorProgram;
-        std::shared_ptr<OpenGLProgram> _baseTextureProgram;
+        std::shared_ptr<OpenGLProgramPipeline> _baseTexturePipeline;
         std::shared_ptr<OpenGLMaterial> _fallbackMaterial;
 
+        // set by the application thread, frame renders with the camera snapshot it was started with
         std::shared_ptr<PerspectiveCamera> _camera;
+        const PerspectiveCamera* _renderCamera = nullptr;
+
+        FramePacket* _recordedPacket = nullptr;
+
+        // draws submitted outside of a packet, resolved when the frame ends
+        std::vector<FramePacketDraw> _draws;
+        std::vector<DrawList> _submitChunks;
 
-        struct MeshEntry
+        /// @brief Draws resolved by one job when the frame is prepared
+        static constexpr std::size_t drawPreparationChunkSize = 1024;
+
+        // draws whose material has to select program variant first, they are submitted serially
+        FrameVector<std::uint8_t> _deferredDraws;
+
+        // application side values and stats, render side works with the copies of the current frame
+        OpenGLRendererSettings _settings{};
+        OpenGLRendererSettings _frameSettings{};
+        OpenGLRendererStats _stats{};
+        OpenGLRendererStats _frameStats{};
+
+        std::atomic<bool> _defragmentRequested = false;
+
+        RenderQueue _renderQueue;
+
+        enum class DrawBatchType
+        {
+            single,
+            instanced,
+            multiDrawIndirect
+        };
+
+        struct DrawBatch
         {
-            std::shared_ptr<OpenGLMaterial> material;
-            std::shared_ptr<OpenGLMesh> mesh;
-            glm::mat4 model;
+            DrawBatchType type;
+            std::size_t firstEntry;
+            std::uint32_t count;
+            std::uint32_t firstInstance;
+            std::uint32_t firstCommand;
+            std::uint32_t commandCount;
         };
 
-        std::vector<MeshEntry> _meshEntries;
+        /// @brief Minimal amount of compatible draws that are merged into single instanced draw call
+        static constexpr std::uint32_t minInstancedBatchSize = 2;
 
-        BufferToDisplay _bufferToDisplay = BufferToDisplay::finalFrame;
+        // keyed by variantBaseId, variants of the program use variants of the instanced program with the same features
+        std::unordered_map<std::uint32_t, std::shared_ptr<OpenGLProgram>> _instancedPrograms;
+        std::shared_ptr<OpenGLBuffer> _instanceBuffer;
+        FrameVector<RenderQueueInstanceData> _instanceData;
+        FrameVector<DrawBatch> _drawBatches;
+
+        // multi draw indirect requires GL 4.3 or ARB_multi_draw_indirect + ARB_base_instance,
+        // arena is not created when they are missing
+        std::shared_ptr<OpenGLGeometryArena> _geometryArena;
+        std::shared_ptr<OpenGLBuffer> _indirectBuffer;
+        FrameVector<DrawElementsIndirectCommand> _indirectCommands;
 
         std::shared_ptr<OpenGLTexture2D> _frameTexture;
 
@@ -111,27 +317,32 @@ namespace BGLRenderer
         std::shared_ptr<OpenGLFramebuffer> _lightBuffer;
         std::shared_ptr<OpenGLFramebuffer> _frameFramebuffer;
 
-        std::shared_ptr<OpenGLProgram> _ambientLightProgram;
-        std::shared_ptr<OpenGLProgram> _directionalLightProgram;
-        std::shared_ptr<OpenGLProgram> _combineFinalFrameProgram;
-        std::shared_ptr<OpenGLProgram> _postProcessGammaCorrectionProgram;
+        std::shared_ptr<OpenGLProgramPipeline> _ambientLightPipeline;
+        std::shared_ptr<OpenGLProgramPipeline> _directionalLightPipeline;
+        std::shared_ptr<OpenGLProgramPipeline> _combineFinalFramePipeline;
+        std::shared_ptr<OpenGLProgramPipeline> _postProcessGammaCorrectionPipeline;
 
         std::shared_ptr<OpenGLProgram> _skyboxProgram;
         std::shared_ptr<OpenGLEnvironmentMap> _environmentMap;
 
-        glm::vec3 _ambientLight = {0, 0, 0};
-        glm::vec3 _directionalLightDirection = {0.2f, -0.5f, -1.0f};
-        glm::vec3 _directionalLightColor = {1.0f, 1.0f, 1.0f};
-        float _directionalLightIntensity = 1.0f;
-
         // Debug stuff
         Gizmos _gizmos{};
-        std::shared_ptr<OpenGLProgram> _textureChannelProgram;
-
-        bool _postProcess = true;
+        std::shared_ptr<OpenGLProgramPipeline> _textureChannelPipeline;
 
         void initializeDefaultResources();
 
+        inline std::vector<FramePacketDraw>& recordedDraws()
+        {
+            return _recordedPacket != nullptr ? _recordedPacket->draws : _draws;
+        }
+
+        void prepareFrame();
+        void submitDraws(const std::vector<FramePacketDraw>& draws);
+        void prepareDraw(const FramePacketDraw& draw, std::size_t slot, std::uint8_t& deferred);
+        void submitDraw(OpenGLMaterialHandle material, OpenGLMeshHandle mesh, const glm::mat4& model);
+        float normalizedDepth(const glm::mat4& model) const;
+        void renderFrame(Gizmos& gizmos);
+
         void skyboxPass();
 
         void gbufferPass();
@@ -141,12 +352,15 @@ namespace BGLRenderer
         void unlitPass();
         void presentFinalFrame();
 
-        void setCameraUniforms(const std::shared_ptr<OpenGLProgram>& program,
-                               const std::shared_ptr<PerspectiveCamera>& camera);
+        void updateFrameData();
 
         void renderMeshEntries(MaterialType materialType);
 
-        static void setFrameDataUniforms(const std::shared_ptr<OpenGLProgram>& program,
-                                         const OpenGLFrameData& frameData);
+        void buildDrawBatches(std::size_t begin, std::size_t end);
+        void uploadInstanceData();
+        void uploadIndirectCommands();
+        void pushInstanceData(const RenderQueueEntry& entry);
+        void bindInstanceAttributes(std::uint32_t firstInstance);
+        OpenGLProgram* instancedProgramFor(const OpenGLProgram* program);
     };
 }
@@ -0,0 +1,266 @@
+﻿#include "OpenGLStateCache.h"
+
+namespace BGLRenderer
+{
+    static OpenGLStateCache* currentStateCache = nullptr;
+
+    OpenGLStateCache::~OpenGLStateCache()
+    {
+        if (currentStateCache == this)
+        {
+            currentStateCache = nullptr;
+
+            // default cache didn't see anything done through this one
+            current().invalidate();
+        }
+    }
+
+    OpenGLStateCache& OpenGLStateCache::current()
+    {
+        static OpenGLStateCache defaultStateCache;
+        return currentStateCache != nullptr ? *currentStateCache : defaultStateCache;
+    }
+
+    void OpenGLStateCache::makeCurrent()
+    {
+        invalidate();
+        currentStateCache = this;
+    }
+
+    void OpenGLStateCache::invalidate()
+    {
+        _depthTest.reset();
+        _depthWrite.reset();
+        _depthFunc.reset();
+        _culling.reset();
+        _cullFace.reset();
+        _blend.reset();
+        _blendFunc.reset();
+        _viewport.reset();
+
+        _program.reset();
+        _programPipeline.reset();
+        _vertexArray.reset();
+        _framebuffer.reset();
+
+        _activeTextureUnit.reset();
+        _textureUnits.fill({});
+    }
+
+    void OpenGLStateCache::setDepthTest(bool enabled)
+    {
+        setCapability(_depthTest, GL_DEPTH_TEST, enabled);
+    }
+
+    void OpenGLStateCache::setDepthWrite(bool enabled)
+    {
+        if (update(_depthWrite, enabled))
+        {
+            GL_CALL(glDepthMask(enabled ? GL_TRUE : GL_FALSE));
+        }
+    }
+
+    void OpenGLStateCache::setDepthFunc(GLenum func)
+    {
+        if (update(_depthFunc, func))
+        {
+            GL_CALL(glDepthFunc(func));
+        }
+    }
+
+    void OpenGLStateCache::setCulling(bool enabled)
+    {
+        setCapability(_culling, GL_CULL_FACE, enabled);
+    }
+
+    void OpenGLStateCache::setCullFace(GLenum face)
+    {
+        if (update(_cullFace, face))
+        {
+            GL_CALL(glCullFace(face));
+        }
+    }
+
+    void OpenGLStateCache::setBlend(bool enabled)
+    {
+        setCapability(_blend, GL_BLEND, enabled);
+    }
+
+    void OpenGLStateCache::setBlendFunc(GLenum source, GLenum destination)
+    {
+        if (update(_blendFunc, std::make_pair(source, destination)))
+        {
+            GL_CALL(glBlendFunc(source, destination));
+        }
+    }
+
+    void OpenGLStateCache::setViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        if (update(_viewport, Viewport{x, y, width, height}))
+        {
+            GL_CALL(glViewport(x, y, width, height));
+        }
+    }
+
+    void OpenGLStateCache::useProgram(GLuint program)
+    {
+        if (update(_program, program))
+        {
+            GL_CALL(glUseProgram(program));
+        }
+    }
+
+    void OpenGLStateCache::bindProgramPipeline(GLuint pipeline)
+    {
+        useProgram(0);
+
+        if (update(_programPipeline, pipeline))
+        {
+            GL_CALL(glBindProgramPipeline(pipeline));
+        }
+    }
+
+    void OpenGLStateCache::bindVertexArray(GLuint vertexArray)
+    {
+        if (update(_vertexArray, vertexArray))
+        {
+            GL_CALL(glBindVertexArray(vertexArray));
+        }
+    }
+
+    void OpenGLStateCache::bindFramebuffer(GLuint framebuffer)
+    {
+        if (update(_framebuffer, framebuffer))
+        {
+            GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+        }
+    }
+
+    void OpenGLStateCache::bindTexture(GLenum target, GLuint texture, GLuint unit)
+    {
+        std::optional<GLuint>* binding = textureBinding(target, unit);
+        if (binding == nullptr)
+        {
+            _stats.calls++;
+        }
+        else if (!update(*binding, texture))
+        {
+            return;
+        }
+
+        activateTextureUnit(unit);
+        GL_CALL(glBindTexture(target, texture));
+    }
+
+    void OpenGLStateCache::bindTexture(GLenum target, GLuint texture)
+    {
+        // binding of unknown unit cannot be tracked, so the first unit is activated
+        bindTexture(target, texture, _activeTextureUnit.value_or(0));
+    }
+
+    void OpenGLStateCache::forgetProgram(GLuint program)
+    {
+        if (_program == program)
+        {
+            _program.reset();
+        }
+    }
+
+    void OpenGLStateCache::forgetProgramPipeline(GLuint pipeline)
+    {
+        if (_programPipeline == pipeline)
+        {
+            _programPipeline.reset();
+        }
+    }
+
+    void OpenGLStateCache::forgetVertexArray(GLuint vertexArray)
+    {
+        if (_vertexArray == vertexArray)
+        {
+            _vertexArray.reset();
+        }
+    }
+
+    void OpenGLStateCache::forgetFramebuffer(GLuint framebuffer)
+    {
+        if (_framebuffer == framebuffer)
+        {
+            _framebuffer.reset();
+        }
+    }
+
+    void OpenGLStateCache::forgetTexture(GLuint texture)
+    {
+        for (TextureUnit& unit: _textureUnits)
+        {
+            if (unit.texture2D == texture)
+            {
+                unit.texture2D.reset();
+            }
+
+            if (unit.cubemap == texture)
+            {
+                unit.cubemap.reset();
+            }
+        }
+    }
+
+    template <class T>
+    bool OpenGLStateCache::update(std::optional<T>& cached, const T& value)
+    {
+        _stats.calls++;
+
+        if (cached.has_value() && cached.value() == value)
+        {
+            _stats.filteredCalls++;
+            return false;
+        }
+
+        cached = value;
+        return true;
+    }
+
+    void OpenGLStateCache::setCapability(std::optional<bool>& cached, GLenum capability, bool enabled)
+    {
+        if (!update(cached, enabled))
+        {
+            return;
+        }
+
+        if (enabled)
+        {
+            GL_CALL(glEnable(capability));
+        }
+        else
+        {
+            GL_CALL(glDisable(capability));
+        }
+    }
+
+    void OpenGLStateCache::activateTextureUnit(GLuint unit)
+    {
+        if (update(_activeTextureUnit, unit))
+        {
+            GL_CALL(glActiveTexture(GL_TEXTURE0 + unit));
+        }
+    }
+
+    std::optional<GLuint>* OpenGLStateCache::textureBinding(GLenum target, GLuint unit)
+    {
+        if (unit >= maxTextureUnits)
+        {
+            return nullptr;
+        }
+
+        switch (target)
+        {
+            case GL_TEXTURE_2D:
+                return &_textureUnits[unit].texture2D;
+            case GL_TEXTURE_CUBE_MAP:
+                return &_textureUnits[unit].cubemap;
+            default:
+                return nullptr;
+        }
+    }
+}
@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include "OpenGLBase.h"
+
+#include <array>
+#include <optional>
+
+namespace BGLRenderer
+{
+    struct OpenGLStateCacheStats
+    {
+        int calls = 0;
+        int filteredCalls = 0;
+    };
+
+    /// @brief Tracks fixed function state and object bindings of the context, calls which would set the current
+    /// value again are dropped. Resources bind through current() so every binding is seen by the cache.
+    /// State changed by third party code (e.g. ImGui backend) has to be followed by invalidate().
+    class OpenGLStateCache
+    {
+    public:
+        static constexpr GLuint maxTextureUnits = 32;
+
+        ~OpenGLStateCache();
+
+        /// @brief Cache used by resources, falls back to process wide instance when none was made current
+        static OpenGLStateCache& current();
+
+        /// @brief Installs this cache as current, state tracked by the previous one is not trusted
+        void makeCurrent();
+
+        /// @brief Forgets all tracked values, next call of every kind reaches the driver
+        void invalidate();
+
+        void setDepthTest(bool enabled);
+        void setDepthWrite(bool enabled);
+        void setDepthFunc(GLenum func);
+
+        void setCulling(bool enabled);
+        void setCullFace(GLenum face);
+
+        void setBlend(bool enabled);
+        void setBlendFunc(GLenum source, GLenum destination);
+
+        void setViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+        void useProgram(GLuint program);
+
+        /// @brief Pipeline is used only while no program is current, so current program is reset
+        void bindProgramPipeline(GLuint pipeline);
+        void bindVertexArray(GLuint vertexArray);
+        void bindFramebuffer(GLuint framebuffer);
+
+        /// @brief Binds texture to given unit, supported targets: GL_TEXTURE_2D and GL_TEXTURE_CUBE_MAP
+        void bindTexture(GLenum target, GLuint texture, GLuint unit);
+
+        /// @brief Binds texture to currently active unit, used when texture is bound only to be modified
+        void bindTexture(GLenum target, GLuint texture);
+
+        // deleted names can be reused by new objects, bindings to them have to be forgotten
+        void forgetProgram(GLuint program);
+        void forgetProgramPipeline(GLuint pipeline);
+        void forgetVertexArray(GLuint vertexArray);
+        void forgetFramebuffer(GLuint framebuffer);
+        void forgetTexture(GLuint texture);
+
+        inline const OpenGLStateCacheStats& stats() const { return _stats; }
+        inline void resetStats() { _stats = {}; }
+
+    private:
+        struct Viewport
+        {
+            GLint x;
+            GLint y;
+            GLsizei width;
+            GLsizei height;
+
+            bool operator==(const Viewport& other) const = default;
+        };
+
+        struct TextureUnit
+        {
+            std::optional<GLuint> texture2D;
+            std::optional<GLuint> cubemap;
+        };
+
+        std::optional<bool> _depthTest;
+        std::optional<bool> _depthWrite;
+        std::optional<GLenum> _depthFunc;
+        std::optional<bool> _culling;
+        std::optional<GLenum> _cullFace;
+        std::optional<bool> _blend;
+        std::optional<std::pair<GLenum, GLenum>> _blendFunc;
+        std::optional<Viewport> _viewport;
+
+        std::optional<GLuint> _program;
+        std::optional<GLuint> _programPipeline;
+        std::optional<GLuint> _vertexArray;
+        std::optional<GLuint> _framebuffer;
+
+        std::optional<GLuint> _activeTextureUnit;
+        std::array<TextureUnit, maxTextureUnits> _textureUnits{};
+
+        OpenGLStateCacheStats _stats{};
+
+        /// @brief Counts the call, returns true when the value has to be sent to the driver
+        template <class T>
+        bool update(std::optional<T>& cached, const T& value);
+
+        void setCapability(std::optional<bool>& cached, GLenum capability, bool enabled);
+        void activateTextureUnit(GLuint unit);
+        std::optional<GLuint>* textureBinding(GLenum target, GLuint unit);
+    };
+}
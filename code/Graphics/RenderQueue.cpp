@@ -0,0 +1,257 @@
+﻿#include "RenderQueue.h"
+
+#include <limits>
+
+namespace BGLRenderer
+{
+    static constexpr int PassBits = 2;
+    static constexpr int ProgramBits = 14;
+    static constexpr int MaterialBits = 16;
+    static constexpr int MeshBits = 16;
+    static constexpr int DepthBits = 16;
+
+    static_assert(PassBits + ProgramBits + MaterialBits + MeshBits + DepthBits == 64, "Sort key has to use all 64 bits");
+
+    static constexpr int PassShift = 64 - PassBits;
+
+    void RenderQueue::clear()
+    {
+        // previous frame is the best guess for this one, so arrays are allocated just once
+        const std::size_t expectedCount = static_cast<std::size_t>(_stats.submitted);
+
+        resetFrameVector(_entries, expectedCount);
+        resetFrameVector(_keys, expectedCount);
+        resetFrameVector(_sortedIndices, 0);
+        resetFrameVector(_sortedKeys, 0);
+        resetFrameVector(_keysScratch, 0);
+        resetFrameVector(_indicesScratch, 0);
+        resetFrameVector(_visibility, 0);
+        resetFrameVector(_writtenSlots, 0);
+        _culler.clear();
+
+        _stats = {};
+    }
+
+    void RenderQueue::submit(OpenGLMaterial& material,
+                             OpenGLMesh& mesh,
+                             const glm::mat4& model,
+                             float normalizedDepth)
+    {
+        const OpenGLProgram& program = *material.program();
+
+        _keys.push_back(makeSortKey(material.type(), program.uniqueId(), material.sortId(), mesh.uniqueId(),
+                                    normalizedDepth));
+        _entries.push_back({material.handle(), mesh.handle(), program.handle(), model});
+
+        _stats.submitted++;
+    }
+
+    std::size_t RenderQueue::reserveEntries(std::size_t count)
+    {
+        const std::size_t firstSlot = _entries.size();
+
+        _entries.resize(firstSlot + count);
+        _keys.resize(firstSlot + count);
+
+        // entries submitted before stay, only the new slots are tracked
+        _writtenSlots.assign(firstSlot, 1);
+        _writtenSlots.resize(firstSlot + count, 0);
+        _firstReservedSlot = firstSlot;
+
+        return firstSlot;
+    }
+
+    void RenderQueue::writeEntry(std::size_t slot,
+                                 OpenGLMaterial& material,
+                                 OpenGLMesh& mesh,
+                                 const glm::mat4& model,
+                                 float normalizedDepth)
+    {
+        const OpenGLProgram& program = *material.program();
+
+        _keys[slot] = makeSortKey(material.type(), program.uniqueId(), material.sortId(), mesh.uniqueId(),
+                                  normalizedDepth);
+        _entries[slot] = {material.handle(), mesh.handle(), program.handle(), model};
+        _writtenSlots[slot] = 1;
+    }
+
+    void RenderQueue::commitEntries()
+    {
+        ASSERT(_writtenSlots.size() == _entries.size(), "Entries were submitted before reserved slots were committed");
+
+        compact(_writtenSlots);
+        _writtenSlots.clear();
+
+        _stats.submitted += static_cast<int>(_entries.size() - _firstReservedSlot);
+    }
+
+    void RenderQueue::cull(const Frustum& frustum, JobSystem* jobSystem)
+    {
+        _culler.clear();
+        _culler.reserve(_entries.size());
+
+        for (const RenderQueueEntry& entry: _entries)
+        {
+            const OpenGLMesh* mesh = entry.mesh();
+            if (mesh == nullptr)
+            {
+                // released meshes are dropped by sort, sphere only keeps culler indices aligned
+                _culler.addSphere(glm::vec3(0.0f), std::numeric_limits<float>::max());
+                continue;
+            }
+
+            const MeshBounds& bounds = mesh->bounds();
+            if (!bounds.valid)
+            {
+                _culler.addSphere(glm::vec3(0.0f), std::numeric_limits<float>::max());
+                continue;
+            }
+
+            BoundingSphere sphere = bounds.worldSphere(entry.model);
+            _culler.addSphere(sphere.center, sphere.radius);
+        }
+
+        _culler.cull(frustum, _visibility, jobSystem);
+
+        const std::size_t submittedCount = _entries.size();
+        compact(_visibility);
+
+        _stats.culled += static_cast<int>(submittedCount - _entries.size());
+    }
+
+    void RenderQueue::sort()
+    {
+        // resources can be released between submission and the end of the frame
+        bool allAlive = true;
+        _visibility.resize(_entries.size());
+        for (std::size_t i = 0; i < _entries.size(); ++i)
+        {
+            const RenderQueueEntry& entry = _entries[i];
+            const bool alive = entry.material() != nullptr && entry.mesh() != nullptr && entry.program() != nullptr;
+
+            _visibility[i] = alive ? 1 : 0;
+            allAlive = allAlive && alive;
+        }
+
+        if (!allAlive)
+        {
+            compact(_visibility);
+        }
+
+        const std::size_t count = _keys.size();
+
+        _sortedKeys.assign(_keys.begin(), _keys.end());
+        _keysScratch.resize(count);
+        _sortedIndices.resize(count);
+        _indicesScratch.resize(count);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            _sortedIndices[i] = static_cast<std::uint32_t>(i);
+        }
+
+        // LSD radix sort, 8 passes of 8 bits, stable so equal keys keep submission order
+        for (int shift = 0; shift < 64; shift += 8)
+        {
+            std::size_t histogram[256] = {};
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                histogram[(_sortedKeys[i] >> shift) & 0xFF]++;
+            }
+
+            // all keys share this byte, nothing to reorder
+            if (count == 0 || histogram[(_sortedKeys[0] >> shift) & 0xFF] == count)
+            {
+                continue;
+            }
+
+            std::size_t offset = 0;
+            for (std::size_t& bucket: histogram)
+            {
+                std::size_t bucketSize = bucket;
+                bucket = offset;
+                offset += bucketSize;
+            }
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                std::size_t destination = histogram[(_sortedKeys[i] >> shift) & 0xFF]++;
+                _keysScratch[destination] = _sortedKeys[i];
+                _indicesScratch[destination] = _sortedIndices[i];
+            }
+
+            _sortedKeys.swap(_keysScratch);
+            _sortedIndices.swap(_indicesScratch);
+        }
+    }
+
+    void RenderQueue::compact(const FrameVector<std::uint8_t>& keep)
+    {
+        std::size_t keptCount = 0;
+        for (std::size_t i = 0; i < _entries.size(); ++i)
+        {
+            if (keep[i] == 0)
+            {
+                continue;
+            }
+
+            if (keptCount != i)
+            {
+                _entries[keptCount] = _entries[i];
+                _keys[keptCount] = _keys[i];
+            }
+
+            keptCount++;
+        }
+
+        _entries.resize(keptCount);
+        _keys.resize(keptCount);
+    }
+
+    void RenderQueue::passRange(MaterialType materialType, std::size_t& begin, std::size_t& end) const
+    {
+        ASSERT(_sortedKeys.size() == _entries.size(), "Render queue has to be sorted before use");
+
+        const std::uint64_t pass = static_cast<std::uint64_t>(materialType);
+
+        auto first = std::lower_bound(_sortedKeys.begin(), _sortedKeys.end(), pass << PassShift);
+        auto last = pass + 1 < (1ull << PassBits)
+                        ? std::lower_bound(first, _sortedKeys.end(), (pass + 1) << PassShift)
+                        : _sortedKeys.end();
+
+        begin = static_cast<std::size_t>(first - _sortedKeys.begin());
+        end = static_cast<std::size_t>(last - _sortedKeys.begin());
+    }
+
+    std::uint64_t RenderQueue::makeSortKey(MaterialType materialType,
+                                           std::uint32_t programId,
+                                           std::uint32_t materialId,
+                                           std::uint32_t meshId,
+                                           float normalizedDepth)
+    {
+        const std::uint64_t pass = static_cast<std::uint64_t>(materialType) & ((1ull << PassBits) - 1);
+        const std::uint64_t program = programId & ((1ull << ProgramBits) - 1);
+        const std::uint64_t material = materialId & ((1ull << MaterialBits) - 1);
+        const std::uint64_t mesh = meshId & ((1ull << MeshBits) - 1);
+
+        constexpr float maxDepth = static_cast<float>((1u << DepthBits) - 1);
+        const std::uint64_t depth = static_cast<std::uint64_t>(glm::clamp(normalizedDepth, 0.0f, 1.0f) * maxDepth);
+
+        if (materialType == MaterialType::transparent)
+        {
+            const std::uint64_t invertedDepth = static_cast<std::uint64_t>(maxDepth) - depth;
+
+            return pass << PassShift |
+                   invertedDepth << (ProgramBits + MaterialBits + MeshBits) |
+                   program << (MaterialBits + MeshBits) |
+                   material << MeshBits |
+                   mesh;
+        }
+
+        return pass << PassShift |
+               program << (MaterialBits + MeshBits + DepthBits) |
+               material << (MeshBits + DepthBits) |
+               mesh << DepthBits |
+               depth;
+    }
+}
@@ -0,0 +1,154 @@
+﻿#pragma once
+
+#include "FrustumCulling.h"
+#include "Resources/OpenGLMaterial.h"
+#include "Resources/OpenGLMesh.h"
+
+#include <Foundation/FrameArena.h>
+
+#include <cstdint>
+
+namespace BGLRenderer
+{
+    /// @brief Counters describing how much state switching was avoided by sorting, reset every frame
+    struct RenderQueueStats
+    {
+        int submitted = 0;
+        int culled = 0;
+        int drawCalls = 0;
+
+        int instancedDrawCalls = 0;
+        int instancedObjects = 0;
+
+        int multiDrawCalls = 0;
+        int indirectCommands = 0;
+
+        int programBinds = 0;
+        int materialBinds = 0;
+        int meshBinds = 0;
+
+        int programBindsSkipped = 0;
+        int materialBindsSkipped = 0;
+        int meshBindsSkipped = 0;
+
+        inline int stateChangesSkipped() const
+        {
+            return programBindsSkipped + materialBindsSkipped + meshBindsSkipped;
+        }
+    };
+
+    /// @brief Per instance vertex data used by instanced programs, see gbuffer_default_instanced.vert
+    struct RenderQueueInstanceData
+    {
+        glm::mat4 model;
+        glm::vec4 tint;
+        glm::vec4 surface; // x - roughness, y - metallic
+        glm::vec4 positionOffset; // w - 1 when normals are octahedral encoded
+        glm::vec4 positionScale;
+    };
+
+    namespace InstanceAttributeLocation
+    {
+        // mat4 occupies four consecutive locations
+        static constexpr GLuint model = 4;
+        static constexpr GLuint tint = 8;
+        static constexpr GLuint surface = 9;
+        static constexpr GLuint positionOffset = 10;
+        static constexpr GLuint positionScale = 11;
+    }
+
+    /// @brief Resources are referenced by handles, so queue doesn't touch reference counts. Program is the variant
+    /// material used at submission. Resolving returns nullptr only when resource was released after submission
+    struct RenderQueueEntry
+    {
+        OpenGLMaterialHandle materialHandle;
+        OpenGLMeshHandle meshHandle;
+        OpenGLProgramHandle programHandle;
+        glm::mat4 model;
+
+        inline OpenGLMaterial* material() const { return HandlePool<OpenGLMaterial>::global().get(materialHandle); }
+        inline OpenGLMesh* mesh() const { return HandlePool<OpenGLMesh>::global().get(meshHandle); }
+        inline OpenGLProgram* program() const { return HandlePool<OpenGLProgram>::global().get(programHandle); }
+    };
+
+    /// @brief Collects submitted draws and orders them by 64-bit sort key
+    ///
+    /// Key layout (from most significant bit):
+    ///  - opaque / unlit: pass (2) | program (14) | material (16) | mesh (16) | depth front to back (16)
+    ///  - transparent: pass (2) | depth back to front (16) | program (14) | material (16) | mesh (16)
+    ///
+    /// Resource ids are truncated to fit their fields, collisions only make the order less optimal,
+    /// redundant bind detection compares actual resources. Material instances use parent's id.
+    class RenderQueue
+    {
+    public:
+        /// @brief Starts new frame, storage of the previous one is dropped and the arena is used from now on.
+        /// Has to be called after FrameArena::beginFrame
+        void clear();
+
+        /// @brief Material has to be valid, fallback should be resolved by the caller
+        void submit(OpenGLMaterial& material,
+                    OpenGLMesh& mesh,
+                    const glm::mat4& model,
+                    float normalizedDepth);
+
+        /// @brief Appends count empty slots and returns index of the first one. Slots are filled by writeEntry,
+        /// which may run on several threads as long as every slot is written by one of them
+        std::size_t reserveEntries(std::size_t count);
+
+        /// @brief Same as submit for slot from reserveEntries, touches only the slot
+        void writeEntry(std::size_t slot,
+                        OpenGLMaterial& material,
+                        OpenGLMesh& mesh,
+                        const glm::mat4& model,
+                        float normalizedDepth);
+
+        /// @brief Drops reserved slots which weren't written, has to be called before next submit or reserveEntries
+        void commitEntries();
+
+        /// @brief Removes entries whose mesh bounds are outside of the frustum, has to be called before sort.
+        /// Sphere tests are spread across the job system when it's given
+        void cull(const Frustum& frustum, JobSystem* jobSystem = nullptr);
+
+        /// @brief Drops entries whose resources were released since submission and sorts the rest,
+        /// has to be called before iterating passes
+        void sort();
+
+        /// @brief Returns sorted entries that belong to given pass as [begin, end) range of indices into sortedEntry
+        void passRange(MaterialType materialType, std::size_t& begin, std::size_t& end) const;
+
+        inline const RenderQueueEntry& sortedEntry(std::size_t index) const { return _entries[_sortedIndices[index]]; }
+        inline std::size_t size() const { return _entries.size(); }
+
+        inline RenderQueueStats& stats() { return _stats; }
+        inline const RenderQueueStats& stats() const { return _stats; }
+
+        static std::uint64_t makeSortKey(MaterialType materialType,
+                                         std::uint32_t programId,
+                                         std::uint32_t materialId,
+                                         std::uint32_t meshId,
+                                         float normalizedDepth);
+
+    private:
+        // every array is transient, allocated from the frame arena
+        FrameVector<RenderQueueEntry> _entries;
+        FrameVector<std::uint64_t> _keys;
+        FrameVector<std::uint32_t> _sortedIndices;
+
+        FrameVector<std::uint64_t> _sortedKeys;
+        FrameVector<std::uint64_t> _keysScratch;
+        FrameVector<std::uint32_t> _indicesScratch;
+
+        FrustumCuller _culler;
+        FrameVector<std::uint8_t> _visibility;
+
+        // written flag of every entry, only used between reserveEntries and commitEntries
+        FrameVector<std::uint8_t> _writtenSlots;
+        std::size_t _firstReservedSlot = 0;
+
+        RenderQueueStats _stats;
+
+        /// @brief Keeps entries with non zero flag, keys stay paired with their entries
+        void compact(const FrameVector<std::uint8_t>& keep);
+    };
+}
@@ -0,0 +1,71 @@
+﻿#include "OpenGLBuffer.h"
+
+#include "../OpenGLDeletionQueue.h"
+
+namespace BGLRenderer
+{
+    OpenGLBuffer::OpenGLBuffer(const std::string& name, GLenum target, GLsizeiptr size, GLenum usage) :
+        _name(name),
+        _target(target),
+        _usage(usage),
+        _size(size)
+    {
+        GL_CALL(glGenBuffers(1, &_id));
+        ASSERT(_id != 0, "Failed to create opengl buffer");
+
+        bind();
+        GL_CALL(glBufferData(_target, _size, nullptr, _usage));
+    }
+
+    OpenGLBuffer::~OpenGLBuffer()
+    {
+        OpenGLDeletionQueue::global().deleteObject(OpenGLObjectType::buffer, _id);
+    }
+
+    void OpenGLBuffer::bind()
+    {
+        GL_CALL(glBindBuffer(_target, _id));
+    }
+
+    void OpenGLBuffer::unbind()
+    {
+        GL_CALL(glBindBuffer(_target, 0));
+    }
+
+    void OpenGLBuffer::bindBase(GLuint bindingPoint)
+    {
+        GL_CALL(glBindBufferBase(_target, bindingPoint, _id));
+    }
+
+    void OpenGLBuffer::bindRange(GLuint bindingPoint, GLintptr offset, GLsizeiptr size)
+    {
+        ASSERT(offset + size <= _size, "Buffer range is out of bounds");
+        GL_CALL(glBindBufferRange(_target, bindingPoint, _id, offset, size));
+    }
+
+    void OpenGLBuffer::resize(GLsizeiptr size)
+    {
+        _size = size;
+
+        bind();
+        GL_CALL(glBufferData(_target, _size, nullptr, _usage));
+    }
+
+    void OpenGLBuffer::setData(const void* data, GLsizeiptr size, GLintptr offset)
+    {
+        ASSERT(offset + size <= _size, "Trying to write outside of the buffer");
+
+        bind();
+        GL_CALL(glBufferSubData(_target, offset, size, data));
+    }
+
+    void OpenGLBuffer::copyFrom(const OpenGLBuffer& source, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
+    {
+        ASSERT(readOffset + size <= source._size, "Trying to read outside of the source buffer");
+        ASSERT(writeOffset + size <= _size, "Trying to write outside of the buffer");
+
+        GL_CALL(glBindBuffer(GL_COPY_READ_BUFFER, source._id));
+        GL_CALL(glBindBuffer(GL_COPY_WRITE_BUFFER, _id));
+        GL_CALL(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, readOffset, writeOffset, size));
+    }
+}
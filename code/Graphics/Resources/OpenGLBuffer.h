@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include "../OpenGLBase.h"
+
+#include <string>
+
+namespace BGLRenderer
+{
+    class OpenGLBuffer
+    {
+    public:
+        OpenGLBuffer(const std::string& name, GLenum target, GLsizeiptr size, GLenum usage = GL_DYNAMIC_DRAW);
+        ~OpenGLBuffer();
+
+        void bind();
+        void unbind();
+
+        /// @brief Binds whole buffer to indexed binding point, target has to be indexed (e.g. GL_UNIFORM_BUFFER)
+        void bindBase(GLuint bindingPoint);
+        void bindRange(GLuint bindingPoint, GLintptr offset, GLsizeiptr size);
+
+        /// @brief Reallocates buffer storage, previous content is lost
+        void resize(GLsizeiptr size);
+
+        void setData(const void* data, GLsizeiptr size, GLintptr offset = 0);
+
+        /// @brief GPU side copy, uses copy read/write targets so current bindings are not affected
+        void copyFrom(const OpenGLBuffer& source, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size);
+
+        template <class T>
+        inline void setData(const T& data, GLintptr offset = 0)
+        {
+            setData(&data, static_cast<GLsizeiptr>(sizeof(T)), offset);
+        }
+
+        inline const std::string& name() const { return _name; }
+        inline GLuint id() const { return _id; }
+        inline GLenum target() const { return _target; }
+        inline GLsizeiptr size() const { return _size; }
+
+    private:
+        std::string _name;
+        GLuint _id = 0;
+        GLenum _target;
+        GLenum _usage;
+        GLsizeiptr _size;
+    };
+}
@@ -2,6 +2,9 @@
 
 #include "OpenGLTexture2D.h"
 
+#include "../OpenGLDeletionQueue.h"
+#include "../OpenGLStateCache.h"
+
 namespace BGLRenderer
 {
     OpenGLCubemap::OpenGLCubemap(const std::string &name, GLuint faceSize, GLenum format) :
@@ -10,7 +13,7 @@ namespace BGLRenderer
         _format(format)
     {
         GL_CALL(glGenTextures(1, &_id));
-        GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, _id));
+        OpenGLStateCache::current().bindTexture(GL_TEXTURE_CUBE_MAP, _id);
 
         GLenum dataFormat = OpenGLTexture2D::getDefaultPixelDataFormatFor(format);
 
@@ -34,12 +37,11 @@ namespace BGLRenderer
 
     OpenGLCubemap::~OpenGLCubemap()
     {
-        GL_CALL(glDeleteTextures(1, &_id));
+        OpenGLDeletionQueue::global().deleteObject(OpenGLObjectType::texture, _id);
     }
 
     void OpenGLCubemap::bind(int slot)
     {
-        GL_CALL(glActiveTexture(GL_TEXTURE0 + slot));
-        GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, _id));
+        OpenGLStateCache::current().bindTexture(GL_TEXTURE_CUBE_MAP, _id, static_cast<GLuint>(slot));
     }
 }
@@ -1,5 +1,8 @@
 ﻿#include "OpenGLFramebuffer.h"
 
+#include "../OpenGLDeletionQueue.h"
+#include "../OpenGLStateCache.h"
+
 namespace BGLRenderer
 {
     OpenGLFramebuffer::OpenGLFramebuffer(const std::string& name, GLuint width, GLuint height) :
@@ -8,12 +11,12 @@ namespace BGLRenderer
         _height(height)
     {
         GL_CALL(glGenFramebuffers(1, &_id));
-        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, _id));
+        OpenGLStateCache::current().bindFramebuffer(_id);
     }
 
     OpenGLFramebuffer::~OpenGLFramebuffer()
     {
-        GL_CALL(glDeleteFramebuffers(1, &_id));
+        OpenGLDeletionQueue::global().deleteObject(OpenGLObjectType::framebuffer, _id);
     }
 
     int OpenGLFramebuffer::addColorAttachment(const std::shared_ptr<OpenGLTexture2D>& texture, bool autoResize)
@@ -114,12 +117,12 @@ namespace BGLRenderer
 
     void OpenGLFramebuffer::bind()
     {
-        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, _id));
+        OpenGLStateCache::current().bindFramebuffer(_id);
     }
 
     void OpenGLFramebuffer::unbind()
     {
-        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+        OpenGLStateCache::current().bindFramebuffer(0);
     }
 
     void OpenGLFramebuffer::resize(GLuint width, GLuint height)
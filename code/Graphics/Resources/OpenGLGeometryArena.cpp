@@ -0,0 +1,257 @@
+﻿#include "OpenGLGeometryArena.h"
+#include "OpenGLMesh.h"
+
+#include "../OpenGLDeletionQueue.h"
+#include "../OpenGLStateCache.h"
+
+namespace BGLRenderer
+{
+    OpenGLGeometryArena::OpenGLGeometryArena(const VertexLayout& vertexLayout, GLuint vertexCapacity,
+                                             GLuint indexCapacity) :
+        _vertexLayout(vertexLayout),
+        _vertexAllocator(vertexCapacity),
+        _indexAllocator(indexCapacity)
+    {
+        GL_CALL(glGenVertexArrays(1, &_vertexArrayObject));
+
+        _vertexBuffer = createVertexBuffer(vertexCapacity);
+        _indexBuffer = createIndexBuffer(indexCapacity);
+
+        setupVertexArray();
+        trackGPUMemory();
+    }
+
+    OpenGLGeometryArena::~OpenGLGeometryArena()
+    {
+        OpenGLMesh::trackSharedGPUMemory(_trackedGPUMemory, 0);
+        OpenGLDeletionQueue::global().deleteObject(OpenGLObjectType::vertexArray, _vertexArrayObject);
+    }
+
+    GeometryArenaHandle OpenGLGeometryArena::allocate(const void* vertices, GLuint vertexCount,
+                                                      const GLuint* indices, GLuint indexCount)
+    {
+        ASSERT(vertexCount > 0 && indexCount > 0, "Cannot allocate empty geometry");
+
+        GLuint firstVertex = _vertexAllocator.allocate(vertexCount);
+        if (firstVertex == FreeListAllocator::invalidOffset)
+        {
+            growVertexBuffer(vertexCount);
+            firstVertex = _vertexAllocator.allocate(vertexCount);
+        }
+
+        GLuint firstIndex = _indexAllocator.allocate(indexCount);
+        if (firstIndex == FreeListAllocator::invalidOffset)
+        {
+            growIndexBuffer(indexCount);
+            firstIndex = _indexAllocator.allocate(indexCount);
+        }
+
+        ASSERT(firstVertex != FreeListAllocator::invalidOffset && firstIndex != FreeListAllocator::invalidOffset,
+               "Failed to allocate geometry in the arena");
+
+        const GLsizeiptr stride = _vertexLayout.stride();
+        _vertexBuffer->setData(vertices, vertexCount * stride, firstVertex * stride);
+        _indexBuffer->setData(indices, static_cast<GLsizeiptr>(indexCount * sizeof(GLuint)),
+                              static_cast<GLintptr>(firstIndex * sizeof(GLuint)));
+
+        GeometryArenaHandle handle;
+        if (!_freeHandles.empty())
+        {
+            handle = _freeHandles.back();
+            _freeHandles.pop_back();
+        }
+        else
+        {
+            handle = static_cast<GeometryArenaHandle>(_ranges.size());
+            _ranges.emplace_back();
+            _rangeAlive.push_back(false);
+        }
+
+        _ranges[handle] = {firstVertex, vertexCount, firstIndex, indexCount};
+        _rangeAlive[handle] = true;
+        _aliveCount++;
+
+        return handle;
+    }
+
+    void OpenGLGeometryArena::free(GeometryArenaHandle handle)
+    {
+        ASSERT(handle < _ranges.size() && _rangeAlive[handle], "Invalid geometry arena handle");
+
+        const GeometryArenaRange& range = _ranges[handle];
+        _vertexAllocator.free(range.firstVertex, range.vertexCount);
+        _indexAllocator.free(range.firstIndex, range.indexCount);
+
+        _ranges[handle] = {};
+        _rangeAlive[handle] = false;
+        _freeHandles.push_back(handle);
+        _aliveCount--;
+    }
+
+    void OpenGLGeometryArena::defragment()
+    {
+        const float fragmentationBefore = fragmentation();
+
+        std::vector<GeometryArenaHandle> handles;
+        handles.reserve(_aliveCount);
+        for (GeometryArenaHandle handle = 0; handle < _ranges.size(); ++handle)
+        {
+            if (_rangeAlive[handle])
+            {
+                handles.push_back(handle);
+            }
+        }
+
+        // copy into fresh buffers, copying within the same buffer is undefined for overlapping ranges
+        std::shared_ptr<OpenGLBuffer> vertexBuffer = createVertexBuffer(_vertexAllocator.capacity());
+        std::shared_ptr<OpenGLBuffer> indexBuffer = createIndexBuffer(_indexAllocator.capacity());
+
+        std::sort(handles.begin(), handles.end(), [&](GeometryArenaHandle a, GeometryArenaHandle b)
+        {
+            return _ranges[a].firstVertex < _ranges[b].firstVertex;
+        });
+
+        const GLsizeiptr stride = _vertexLayout.stride();
+
+        GLuint vertexCursor = 0;
+        for (GeometryArenaHandle handle: handles)
+        {
+            GeometryArenaRange& range = _ranges[handle];
+            vertexBuffer->copyFrom(*_vertexBuffer, range.firstVertex * stride, vertexCursor * stride,
+                                   range.vertexCount * stride);
+            range.firstVertex = vertexCursor;
+            vertexCursor += range.vertexCount;
+        }
+
+        std::sort(handles.begin(), handles.end(), [&](GeometryArenaHandle a, GeometryArenaHandle b)
+        {
+            return _ranges[a].firstIndex < _ranges[b].firstIndex;
+        });
+
+        GLuint indexCursor = 0;
+        for (GeometryArenaHandle handle: handles)
+        {
+            GeometryArenaRange& range = _ranges[handle];
+            indexBuffer->copyFrom(*_indexBuffer,
+                                  static_cast<GLintptr>(range.firstIndex * sizeof(GLuint)),
+                                  static_cast<GLintptr>(indexCursor * sizeof(GLuint)),
+                                  static_cast<GLsizeiptr>(range.indexCount * sizeof(GLuint)));
+            range.firstIndex = indexCursor;
+            indexCursor += range.indexCount;
+        }
+
+        _vertexBuffer = vertexBuffer;
+        _indexBuffer = indexBuffer;
+        _vertexAllocator.reset(vertexCursor);
+        _indexAllocator.reset(indexCursor);
+
+        setupVertexArray();
+        trackGPUMemory();
+
+        _logger.debug("Defragmented {} ranges, fragmentation {:.3f} -> {:.3f}", handles.size(), fragmentationBefore,
+                      fragmentation());
+    }
+
+    void OpenGLGeometryArena::bind()
+    {
+        OpenGLStateCache::current().bindVertexArray(_vertexArrayObject);
+    }
+
+    DrawElementsIndirectCommand OpenGLGeometryArena::drawCommand(GeometryArenaHandle handle, GLuint instanceCount,
+                                                                 GLuint baseInstance) const
+    {
+        const GeometryArenaRange& range = _ranges[handle];
+
+        DrawElementsIndirectCommand command{};
+        command.count = range.indexCount;
+        command.instanceCount = instanceCount;
+        command.firstIndex = range.firstIndex;
+        command.baseVertex = static_cast<GLint>(range.firstVertex);
+        command.baseInstance = baseInstance;
+
+        return command;
+    }
+
+    GeometryArenaStats OpenGLGeometryArena::stats() const
+    {
+        GeometryArenaStats stats{};
+        stats.allocations = _aliveCount;
+        stats.vertexStride = _vertexLayout.stride();
+        stats.vertexCapacity = _vertexAllocator.capacity();
+        stats.verticesUsed = _vertexAllocator.used();
+        stats.vertexFragmentation = _vertexAllocator.fragmentation();
+        stats.indexCapacity = _indexAllocator.capacity();
+        stats.indicesUsed = _indexAllocator.used();
+        stats.indexFragmentation = _indexAllocator.fragmentation();
+
+        return stats;
+    }
+
+    float OpenGLGeometryArena::fragmentation() const
+    {
+        return std::max(_vertexAllocator.fragmentation(), _indexAllocator.fragmentation());
+    }
+
+    std::shared_ptr<OpenGLBuffer> OpenGLGeometryArena::createVertexBuffer(GLuint vertexCapacity)
+    {
+        return std::make_shared<OpenGLBuffer>("Geometry Arena Vertices", GL_ARRAY_BUFFER,
+                                              static_cast<GLsizeiptr>(vertexCapacity) * _vertexLayout.stride(),
+                                              GL_STATIC_DRAW);
+    }
+
+    std::shared_ptr<OpenGLBuffer> OpenGLGeometryArena::createIndexBuffer(GLuint indexCapacity)
+    {
+        // uploaded through copy target, binding GL_ELEMENT_ARRAY_BUFFER would modify currently bound vertex array
+        return std::make_shared<OpenGLBuffer>("Geometry Arena Indices", GL_COPY_WRITE_BUFFER,
+                                              static_cast<GLsizeiptr>(indexCapacity * sizeof(GLuint)),
+                                              GL_STATIC_DRAW);
+    }
+
+    void OpenGLGeometryArena::growVertexBuffer(GLuint requiredVertices)
+    {
+        GLuint oldCapacity = _vertexAllocator.capacity();
+        GLuint newCapacity = std::max(oldCapacity * 2, oldCapacity + requiredVertices);
+
+        _logger.debug("Growing vertex buffer from {} to {} vertices", oldCapacity, newCapacity);
+
+        std::shared_ptr<OpenGLBuffer> vertexBuffer = createVertexBuffer(newCapacity);
+        vertexBuffer->copyFrom(*_vertexBuffer, 0, 0, _vertexBuffer->size());
+        _vertexBuffer = vertexBuffer;
+        _vertexAllocator.grow(newCapacity);
+
+        setupVertexArray();
+        trackGPUMemory();
+    }
+
+    void OpenGLGeometryArena::growIndexBuffer(GLuint requiredIndices)
+    {
+        GLuint oldCapacity = _indexAllocator.capacity();
+        GLuint newCapacity = std::max(oldCapacity * 2, oldCapacity + requiredIndices);
+
+        _logger.debug("Growing index buffer from {} to {} indices", oldCapacity, newCapacity);
+
+        std::shared_ptr<OpenGLBuffer> indexBuffer = createIndexBuffer(newCapacity);
+        indexBuffer->copyFrom(*_indexBuffer, 0, 0, _indexBuffer->size());
+        _indexBuffer = indexBuffer;
+        _indexAllocator.grow(newCapacity);
+
+        setupVertexArray();
+        trackGPUMemory();
+    }
+
+    void OpenGLGeometryArena::setupVertexArray()
+    {
+        bind();
+
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer->id()));
+        GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer->id()));
+
+        _vertexLayout.apply();
+    }
+
+    void OpenGLGeometryArena::trackGPUMemory()
+    {
+        OpenGLMesh::trackSharedGPUMemory(_trackedGPUMemory,
+                                         static_cast<std::size_t>(_vertexBuffer->size() + _indexBuffer->size()));
+    }
+}
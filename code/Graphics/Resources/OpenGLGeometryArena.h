@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include "../OpenGLBase.h"
+#include "OpenGLBuffer.h"
+#include "VertexLayout.h"
+
+#include <Foundation/FreeListAllocator.h>
+#include <Foundation/GLMMath.h>
+
+#include <memory>
+#include <vector>
+
+namespace BGLRenderer
+{
+    struct GeometryArenaRange
+    {
+        GLuint firstVertex = 0;
+        GLuint vertexCount = 0;
+        GLuint firstIndex = 0;
+        GLuint indexCount = 0;
+    };
+
+    /// @brief Layout defined by the OpenGL spec for glMultiDrawElementsIndirect
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    using GeometryArenaHandle = std::uint32_t;
+    static constexpr GeometryArenaHandle geometryArenaHandleInvalid = std::numeric_limits<std::uint32_t>::max();
+
+    struct GeometryArenaStats
+    {
+        std::size_t allocations = 0;
+
+        GLuint vertexStride = 0;
+        GLuint vertexCapacity = 0;
+        GLuint verticesUsed = 0;
+        float vertexFragmentation = 0.0f;
+
+        GLuint indexCapacity = 0;
+        GLuint indicesUsed = 0;
+        float indexFragmentation = 0.0f;
+
+        inline std::size_t bytesUsed() const
+        {
+            return static_cast<std::size_t>(verticesUsed) * vertexStride + indicesUsed * sizeof(GLuint);
+        }
+
+        inline std::size_t bytesCapacity() const
+        {
+            return static_cast<std::size_t>(vertexCapacity) * vertexStride + indexCapacity * sizeof(GLuint);
+        }
+    };
+
+    /// @brief Single vertex and index buffer shared by many meshes, so draws can be merged into multi draw indirect.
+    /// Meshes reference their data by handle because ranges move during defragmentation.
+    /// Indices are stored relative to mesh's first vertex and have to be drawn with base vertex.
+    /// Every mesh in the arena uses the same vertex layout, per mesh decode parameters are passed as instance data.
+    class OpenGLGeometryArena
+    {
+    public:
+        OpenGLGeometryArena(const VertexLayout& vertexLayout, GLuint vertexCapacity, GLuint indexCapacity);
+        ~OpenGLGeometryArena();
+
+        /// @brief Copies geometry into the arena, grows buffers when there is no free range big enough.
+        /// Vertices have to be interleaved following vertexLayout()
+        GeometryArenaHandle allocate(const void* vertices, GLuint vertexCount,
+                                     const GLuint* indices, GLuint indexCount);
+        void free(GeometryArenaHandle handle);
+
+        /// @brief Moves all ranges to the beginning of the buffers, handles stay valid
+        void defragment();
+
+        void bind();
+
+        DrawElementsIndirectCommand drawCommand(GeometryArenaHandle handle, GLuint instanceCount,
+                                                GLuint baseInstance) const;
+
+        inline const GeometryArenaRange& range(GeometryArenaHandle handle) const { return _ranges[handle]; }
+
+        GeometryArenaStats stats() const;
+
+        inline const VertexLayout& vertexLayout() const { return _vertexLayout; }
+
+        /// @brief Fragmentation of the more fragmented buffer, see FreeListAllocator::fragmentation
+        float fragmentation() const;
+
+    private:
+        Log _logger{"Geometry Arena"};
+
+        VertexLayout _vertexLayout;
+
+        GLuint _vertexArrayObject = 0;
+        std::shared_ptr<OpenGLBuffer> _vertexBuffer;
+        std::shared_ptr<OpenGLBuffer> _indexBuffer;
+
+        FreeListAllocator _vertexAllocator;
+        FreeListAllocator _indexAllocator;
+
+        std::vector<GeometryArenaRange> _ranges;
+        std::vector<bool> _rangeAlive;
+        std::vector<GeometryArenaHandle> _freeHandles;
+        std::size_t _aliveCount = 0;
+
+        // size of both buffers as reported to OpenGLMesh::totalGPUMemory
+        std::size_t _trackedGPUMemory = 0;
+
+        std::shared_ptr<OpenGLBuffer> createVertexBuffer(GLuint vertexCapacity);
+        std::shared_ptr<OpenGLBuffer> createIndexBuffer(GLuint indexCapacity);
+
+        void growVertexBuffer(GLuint requiredVertices);
+        void growIndexBuffer(GLuint requiredIndices);
+
+        void setupVertexArray();
+        void trackGPUMemory();
+    };
+}
@@ -1,6 +1,12 @@
 ﻿#include "OpenGLMaterial.h"
 #include "OpenGLProgram.h"
 
+#include "../ShaderFeatures.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
 namespace BGLRenderer
 {
     namespace Debug
@@ -8,27 +14,22 @@ namespace BGLRenderer
         constexpr bool LogMaterialValuesSetters = false;
     }
 
-    namespace ValuesKeys
+    static bool isPerInstanceValue(const OpenGLMaterialValue& value)
     {
-        static constexpr const char* tintColor = "tint";
-        static constexpr const char* baseColor = "baseColor";
-        static constexpr const char* normalMap = "normalMap";
-        static constexpr const char* roughnessSingle = "roughnes";
-        static constexpr const char* roughnessMap = "roughnessMap";
-        static constexpr const char* metallicSingle = "metallic";
-        static constexpr const char* metallicMap = "metallicMap";
-
-        static constexpr const char* roughnessMetallicMap = "roughnessMetallicMap";
-
-        static constexpr const char* existsSuffix = "Exists";
+        return value.uniformId == MaterialInstanceValueIds::tint ||
+               value.uniformId == MaterialInstanceValueIds::roughness ||
+               value.uniformId == MaterialInstanceValueIds::metallic;
     }
 
     OpenGLMaterial::OpenGLMaterial(const std::string& name, MaterialType type, MaterialTag tag,
                                    const std::shared_ptr<OpenGLProgram>& program) :
         _name(name),
+        _uniqueId(nextOpenGLResourceId()),
+        _handle(HandlePool<OpenGLMaterial>::global().add(this)),
         _type(type),
         _tag(tag),
-        _program(program)
+        _program(program),
+        _baseProgram(program)
     {
         ASSERT(program != nullptr, "Program cannot be null when creating new material");
         _programLinkedListenerHandle = _program->programLinkedPublisher().listen([&] { programDidLinked(); });
@@ -36,10 +37,13 @@ namespace BGLRenderer
         openGLLogger.debug("Creating new material \"{}\" using program \"{}\"", name, program->name());
 
         updateValuesBasedOnTag();
+        _variantDirty = true;
     }
 
     OpenGLMaterial::OpenGLMaterial(const std::string& name, MaterialType type, MaterialTag tag) :
         _name(name),
+        _uniqueId(nextOpenGLResourceId()),
+        _handle(HandlePool<OpenGLMaterial>::global().add(this)),
         _type(type),
         _tag(tag),
         _program(nullptr)
@@ -47,15 +51,58 @@ namespace BGLRenderer
         openGLLogger.debug("Creating invalid material \"{}\" without the program", name);
     }
 
+    OpenGLMaterial::OpenGLMaterial(const std::string& name, const std::shared_ptr<OpenGLMaterial>& parent) :
+        _name(name),
+        _uniqueId(nextOpenGLResourceId()),
+        _handle(HandlePool<OpenGLMaterial>::global().add(this)),
+        _type(MaterialType::opaque),
+        _tag(MaterialTag::none),
+        _program(nullptr)
+    {
+        ASSERT(parent != nullptr, "Parent cannot be null when creating material instance");
+
+        // instance of an instance keeps the overrides of its source but points directly to the root
+        if (parent->_parent != nullptr)
+        {
+            _parent = parent->_parent;
+            _values = parent->_values;
+        }
+        else
+        {
+            _parent = parent;
+        }
+
+        _type = _parent->_type;
+        _tag = _parent->_tag;
+        _parent->registerInstance(*this);
+
+        openGLLogger.debug("Creating instance \"{}\" of material \"{}\"", name, _parent->_name);
+    }
+
     OpenGLMaterial::OpenGLMaterial(const OpenGLMaterial& material) :
         _name(material._name),
+        _uniqueId(nextOpenGLResourceId()),
+        _handle(HandlePool<OpenGLMaterial>::global().add(this)),
         _type(material._type),
         _tag(material._tag),
-        _program(material._program)
+        _program(material._program),
+        _baseProgram(material._baseProgram)
     {
         openGLLogger.debug("Duplicating material \"{}\"", _name);
 
-        _valuesMap = material._valuesMap;
+        if (material._parent != nullptr)
+        {
+            _parent = material._parent;
+            _parent->registerInstance(*this);
+        }
+
+        if (_program != nullptr)
+        {
+            _programLinkedListenerHandle = _program->programLinkedPublisher().listen([&] { programDidLinked(); });
+        }
+
+        _values = material._values;
+        _variantDirty = true;
 
         updateValuesBasedOnTag();
     }
@@ -64,61 +111,502 @@ namespace BGLRenderer
     {
         openGLLogger.debug("Destroying material \"{}\"", _name);
 
+        HandlePool<OpenGLMaterial>::global().remove(_handle);
+
         if (_programLinkedListenerHandle != PublisherEmpty::listenerHandleInvalid)
         {
             _program->programLinkedPublisher().removeListener(_programLinkedListenerHandle);
         }
+
+        if (_parent != nullptr)
+        {
+            _parent->unregisterInstance(*this);
+        }
     }
 
     void OpenGLMaterial::bind()
     {
-        _program->bind();
+        program()->bind();
+        bindValues();
+    }
+
+    void OpenGLMaterial::bindValues()
+    {
+        bindValues(*program());
+    }
+
+    void OpenGLMaterial::bindValues(OpenGLProgram& program)
+    {
+        if (_parent != nullptr)
+        {
+            _parent->prepareParameters();
+            _parent->bindTexturesAndUniforms(program);
+            _parent->bindParameterSlot(_instanceSlot);
+            bindOverrides(program);
+            return;
+        }
+
+        prepareParameters();
+        bindTexturesAndUniforms(program);
+        bindParameterSlot(0);
+    }
+
+    void OpenGLMaterial::prepareParameters()
+    {
+        if (_variantDirty)
+        {
+            selectProgramVariant();
+        }
+
+        if (_layoutDirty)
+        {
+            compile();
+        }
+
+        if (_instancesDirty && _parameterBuffer != nullptr)
+        {
+            for (OpenGLMaterial* instance: _instances)
+            {
+                if (instance != nullptr &&
+                    (instance->_instanceDirty || instance->_composedGeneration != _parameterGeneration))
+                {
+                    composeInstance(*instance);
+                }
+            }
+        }
+
+        _instancesDirty = false;
+
+        if (_parameterBlockDirty && _parameterBuffer != nullptr)
+        {
+            _parameterBuffer->setData(_parameterBlock.data(), static_cast<GLsizeiptr>(_parameterBlock.size()));
+            _parameterBlockDirty = false;
+        }
+    }
+
+    void OpenGLMaterial::composeInstance(OpenGLMaterial& instance)
+    {
+        std::byte* slot = _parameterBlock.data() + instance._instanceSlot * _parameterStride;
+        std::memcpy(slot, _parameterBlock.data(), _parameterBlockSize);
+
+        GLint blockIndex = static_cast<GLint>(_program->materialDataBlock()->index);
+
+        for (const OpenGLMaterialValue& value: instance._values)
+        {
+            if (value.type == OpenGLMaterialValueType::texture)
+            {
+                continue;
+            }
+
+            const OpenGLUniformInfo* uniform = _program->findUniform(value.uniformId);
+            if (uniform != nullptr && uniform->blockIndex == blockIndex)
+            {
+                std::size_t offset = static_cast<std::size_t>(uniform->blockOffset);
+                writeBlockValue(slot + offset, _parameterBlockSize - offset, value, uniform->matrixStride);
+            }
+        }
+
+        instance._instanceDirty = false;
+        instance._composedGeneration = _parameterGeneration;
+        _parameterBlockDirty = true;
+    }
+
+    void OpenGLMaterial::bindTexturesAndUniforms(OpenGLProgram& program)
+    {
+        bool ownProgram = &program == _program.get();
+
+        for (const TextureBinding& binding: _textureBindings)
+        {
+            GLint textureUnit = binding.textureUnit;
+
+            if (!ownProgram)
+            {
+                const OpenGLUniformInfo* uniform = program.findUniform(binding.uniformId);
+                textureUnit = uniform != nullptr ? uniform->textureUnit : -1;
+            }
+
+            OpenGLTexture2D* texture = HandlePool<OpenGLTexture2D>::global().get(binding.texture);
+            if (textureUnit != -1 && texture != nullptr)
+            {
+                texture->bind(textureUnit);
+            }
+        }
+
+        // programs without MaterialData block still get their values as regular uniforms
+        for (std::size_t valueIndex: _uniformValues)
+        {
+            const OpenGLMaterialValue& value = _values[valueIndex];
+            GLint uniformLocation = ownProgram
+                                        ? program.uniformLocation(value.uniform)
+                                        : program.getUniformLocation(value.uniformId);
+
+            bindUniformValue(program, value, uniformLocation);
+        }
+    }
+
+    void OpenGLMaterial::bindParameterSlot(std::uint32_t slot)
+    {
+        // variants of the program (e.g. instanced) include the same std140 block, so the buffer fits them too
+        if (_parameterBuffer != nullptr)
+        {
+            _parameterBuffer->bindRange(UniformBlockBinding::materialData,
+                                        static_cast<GLintptr>(slot * _parameterStride),
+                                        static_cast<GLsizeiptr>(_parameterBlockSize));
+        }
+    }
+
+    void OpenGLMaterial::bindOverrides(OpenGLProgram& program)
+    {
+        for (const OpenGLMaterialValue& value: _values)
+        {
+            const OpenGLUniformInfo* uniform = program.findUniform(value.uniformId);
+            if (uniform == nullptr)
+            {
+                continue;
+            }
+
+            if (value.type == OpenGLMaterialValueType::texture)
+            {
+                if (uniform->textureUnit != -1 && value.texture != nullptr)
+                {
+                    value.texture->bind(uniform->textureUnit);
+                }
+            }
+            else if (uniform->location != -1)
+            {
+                bindUniformValue(program, value, uniform->location);
+            }
+        }
+    }
+
+    void OpenGLMaterial::registerInstance(OpenGLMaterial& instance)
+    {
+        auto freeSlot = std::find(_instances.begin(), _instances.end(), nullptr);
+
+        if (freeSlot != _instances.end())
+        {
+            *freeSlot = &instance;
+            instance._instanceSlot = static_cast<std::uint32_t>(freeSlot - _instances.begin()) + 1;
+        }
+        else
+        {
+            _instances.push_back(&instance);
+            instance._instanceSlot = static_cast<std::uint32_t>(_instances.size());
+
+            // parameter buffer has to grow, it happens once on the next bind
+            _layoutDirty = true;
+        }
+
+        instance._instanceDirty = true;
+        _instancesDirty = true;
+    }
+
+    void OpenGLMaterial::unregisterInstance(const OpenGLMaterial& instance)
+    {
+        ASSERT(instance._instanceSlot > 0 && _instances[instance._instanceSlot - 1] == &instance,
+               "Material instance is not registered in its parent");
+
+        _instances[instance._instanceSlot - 1] = nullptr;
+    }
+
+    void OpenGLMaterial::bindUniformValue(OpenGLProgram& program, const OpenGLMaterialValue& value, GLint location)
+    {
+        switch (value.type)
+        {
+            case OpenGLMaterialValueType::int32:
+                program.setInt(location, static_cast<GLint>(value.intValue));
+                break;
+            case OpenGLMaterialValueType::float32:
+                program.setFloat(location, static_cast<GLfloat>(value.floatValue));
+                break;
+            case OpenGLMaterialValueType::vector2:
+                program.setVector2(location, value.vec2);
+                break;
+            case OpenGLMaterialValueType::vector3:
+                program.setVector3(location, value.vec3);
+                break;
+            case OpenGLMaterialValueType::vector4:
+                program.setVector4(location, value.vec4);
+                break;
+            case OpenGLMaterialValueType::matrix4x4:
+                program.setMatrix4x4(location, value.mat4x4);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    void OpenGLMaterial::compile()
+    {
+        _layoutDirty = false;
+        _textureBindings.clear();
+        _uniformValues.clear();
+
+        if (_program == nullptr)
+        {
+            return;
+        }
+
+        const OpenGLUniformBlockInfo* block = _program->materialDataBlock();
+        GLint blockIndex = -1;
+
+        if (block != nullptr && block->dataSize > 0)
+        {
+            blockIndex = static_cast<GLint>(block->index);
+
+            GLint offsetAlignment = 1;
+            GL_CALL(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment));
+            offsetAlignment = std::max(offsetAlignment, 1);
+
+            // parent and every instance get one slot, slots are aligned so they can be bound as ranges
+            _parameterBlockSize = static_cast<std::size_t>(block->dataSize);
+            _parameterStride = (_parameterBlockSize + static_cast<std::size_t>(offsetAlignment) - 1) /
+                               static_cast<std::size_t>(offsetAlignment) * static_cast<std::size_t>(offsetAlignment);
+
+            _parameterBlock.assign(_parameterStride * (_instances.size() + 1), std::byte{0});
+            GLsizeiptr bufferSize = static_cast<GLsizeiptr>(_parameterBlock.size());
+
+            if (_parameterBuffer == nullptr || _parameterBuffer->size() < bufferSize)
+            {
+                _parameterBuffer = std::make_unique<OpenGLBuffer>(_name + " parameters", GL_UNIFORM_BUFFER, bufferSize);
+            }
+        }
+        else
+        {
+            _parameterBlock.clear();
+            _parameterBuffer = nullptr;
+            _parameterBlockSize = 0;
+            _parameterStride = 0;
+        }
+
+        for (std::size_t valueIndex = 0; valueIndex < _values.size(); ++valueIndex)
+        {
+            OpenGLMaterialValue& value = _values[valueIndex];
+            value.blockOffset = -1;
+            value.matrixStride = 0;
+
+            const OpenGLUniformInfo* uniform = _program->findUniform(value.uniformId);
+
+            if (value.type == OpenGLMaterialValueType::texture)
+            {
+                _textureBindings.push_back({
+                    value.uniformId, uniform != nullptr ? uniform->textureUnit : -1,
+                    value.texture != nullptr ? value.texture->handle() : OpenGLTexture2DHandle{}
+                });
+            }
+            else if (uniform != nullptr && blockIndex != -1 && uniform->blockIndex == blockIndex)
+            {
+                value.blockOffset = uniform->blockOffset;
+                value.matrixStride = uniform->matrixStride;
+                writeToParameterBlock(value);
+            }
+            else
+            {
+                _uniformValues.push_back(valueIndex);
+            }
+        }
+
+        for (OpenGLMaterial* instance: _instances)
+        {
+            if (instance != nullptr)
+            {
+                instance->_instanceDirty = true;
+            }
+        }
+
+        _instancesDirty = !_instances.empty();
+        _parameterBlockDirty = _parameterBuffer != nullptr;
+    }
+
+    void OpenGLMaterial::writeToParameterBlock(const OpenGLMaterialValue& value)
+    {
+        // instances are composed from parent's slot when parameters are prepared
+        if (_parent != nullptr)
+        {
+            _instanceDirty = true;
+            _parent->_instancesDirty = true;
+            return;
+        }
+
+        if (_layoutDirty || value.blockOffset < 0)
+        {
+            return;
+        }
+
+        std::size_t offset = static_cast<std::size_t>(value.blockOffset);
+        writeBlockValue(_parameterBlock.data() + offset, _parameterBlockSize - offset, value, value.matrixStride);
+
+        _parameterGeneration++;
+        _instancesDirty = !_instances.empty();
+        _parameterBlockDirty = true;
+    }
+
+    void OpenGLMaterial::writeBlockValue(std::byte* destination, std::size_t available,
+                                         const OpenGLMaterialValue& value, GLint matrixStride)
+    {
+        auto write = [&](std::size_t offset, const void* data, std::size_t size)
+        {
+            ASSERT(offset + size <= available, "Material value doesn't fit into parameter block");
+            std::memcpy(destination + offset, data, size);
+        };
+
+        switch (value.type)
+        {
+            case OpenGLMaterialValueType::int32:
+                write(0, &value.intValue, sizeof(value.intValue));
+                break;
+            case OpenGLMaterialValueType::float32:
+                write(0, &value.floatValue, sizeof(value.floatValue));
+                break;
+            case OpenGLMaterialValueType::vector2:
+                write(0, &value.vec2, sizeof(value.vec2));
+                break;
+            case OpenGLMaterialValueType::vector3:
+                write(0, &value.vec3, sizeof(value.vec3));
+                break;
+            case OpenGLMaterialValueType::vector4:
+                write(0, &value.vec4, sizeof(value.vec4));
+                break;
+            case OpenGLMaterialValueType::matrix4x4:
+                // std140 matrices are stored column by column, each column is padded to matrix stride
+                for (glm::length_t column = 0; column < 4; ++column)
+                {
+                    write(static_cast<std::size_t>(column * matrixStride), &value.mat4x4[column], sizeof(glm::vec4));
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    std::float_t OpenGLMaterial::getFloat(StringId valueId, std::float_t defaultValue) const
+    {
+        const OpenGLMaterialValue* value = getValue(valueId);
+        if (value == nullptr && _parent != nullptr)
+        {
+            return _parent->getFloat(valueId, defaultValue);
+        }
+
+        if (value == nullptr || value->type != OpenGLMaterialValueType::float32)
+        {
+            return defaultValue;
+        }
+
+        return value->floatValue;
+    }
+
+    glm::vec4 OpenGLMaterial::getVector4(StringId valueId, const glm::vec4& defaultValue) const
+    {
+        const OpenGLMaterialValue* value = getValue(valueId);
+        if (value == nullptr && _parent != nullptr)
+        {
+            return _parent->getVector4(valueId, defaultValue);
+        }
+
+        if (value == nullptr || value->type != OpenGLMaterialValueType::vector4)
+        {
+            return defaultValue;
+        }
 
-        int textureSlot = 0;
+        return value->vec4;
+    }
 
-        for (auto& [key, value]: _valuesMap)
+    bool OpenGLMaterial::isInstancingCompatible(const OpenGLMaterial& other) const
+    {
+        if (this == &other)
         {
-            std::string uniformName = "u_" + value.name;
-            value.uniformLocation = _program->getUniformLocation(uniformName);
+            return true;
+        }
 
-            switch (value.type)
+        if (!overridesOnlyInstanceValues() || !other.overridesOnlyInstanceValues())
+        {
+            return false;
+        }
+
+        const OpenGLMaterial& root = _parent != nullptr ? *_parent : *this;
+        const OpenGLMaterial& otherRoot = other._parent != nullptr ? *other._parent : other;
+
+        if (&root == &otherRoot)
+        {
+            return true;
+        }
+
+        if (root.program() != otherRoot.program() || root._type != otherRoot._type)
+        {
+            return false;
+        }
+
+        auto it = root._values.begin();
+        auto otherIt = otherRoot._values.begin();
+
+        // both value lists are sorted by hash so they can be walked side by side
+        while (true)
+        {
+            while (it != root._values.end() && isPerInstanceValue(*it))
+            {
+                ++it;
+            }
+
+            while (otherIt != otherRoot._values.end() && isPerInstanceValue(*otherIt))
+            {
+                ++otherIt;
+            }
+
+            if (it == root._values.end() || otherIt == otherRoot._values.end())
             {
-                case OpenGLMaterialValueType::int32:
-                    _program->setInt(value.uniformLocation, static_cast<GLint>(value.intValue));
-                    break;
-                case OpenGLMaterialValueType::float32:
-                    _program->setFloat(value.uniformLocation, static_cast<GLfloat>(value.floatValue));
-                    break;
-                case OpenGLMaterialValueType::vector2:
-                    _program->setVector2(value.uniformLocation, value.vec2);
-                    break;
-                case OpenGLMaterialValueType::vector3:
-                    _program->setVector3(value.uniformLocation, value.vec3);
-                    break;
-                case OpenGLMaterialValueType::vector4:
-                    _program->setVector4(value.uniformLocation, value.vec4);
-                    break;
-                case OpenGLMaterialValueType::matrix4x4:
-                    _program->setMatrix4x4(value.uniformLocation, value.mat4x4);
-                    break;
-                case OpenGLMaterialValueType::texture:
-                    value.texture->bind(textureSlot);
-                    _program->setInt(value.uniformLocation, textureSlot);
-
-                    textureSlot++;
-                    break;
-
-                default:
-                    break;
+                return it == root._values.end() && otherIt == otherRoot._values.end();
             }
+
+            if (it->uniformId != otherIt->uniformId || !valuesEqual(*it, *otherIt))
+            {
+                return false;
+            }
+
+            ++it;
+            ++otherIt;
         }
     }
 
-    void OpenGLMaterial::setInt(const std::string& name, std::int32_t value)
+    bool OpenGLMaterial::overridesOnlyInstanceValues() const
     {
-        OpenGLMaterialValue* materialValue = getOrCreateValue(name);
-        materialValue->type = OpenGLMaterialValueType::int32;
+        return _parent == nullptr || std::all_of(_values.begin(), _values.end(), isPerInstanceValue);
+    }
+
+    bool OpenGLMaterial::valuesEqual(const OpenGLMaterialValue& a, const OpenGLMaterialValue& b)
+    {
+        if (a.type != b.type)
+        {
+            return false;
+        }
+
+        switch (a.type)
+        {
+            case OpenGLMaterialValueType::int32:
+                return a.intValue == b.intValue;
+            case OpenGLMaterialValueType::float32:
+                return a.floatValue == b.floatValue;
+            case OpenGLMaterialValueType::vector2:
+                return a.vec2 == b.vec2;
+            case OpenGLMaterialValueType::vector3:
+                return a.vec3 == b.vec3;
+            case OpenGLMaterialValueType::vector4:
+                return a.vec4 == b.vec4;
+            case OpenGLMaterialValueType::matrix4x4:
+                return a.mat4x4 == b.mat4x4;
+            case OpenGLMaterialValueType::texture:
+                return a.texture == b.texture;
+            default:
+                return true;
+        }
+    }
+
+    void OpenGLMaterial::setInt(std::string_view name, std::int32_t value)
+    {
+        OpenGLMaterialValue* materialValue = getOrCreateValue(name, OpenGLMaterialValueType::int32);
         materialValue->intValue = value;
+        writeToParameterBlock(*materialValue);
 
         if constexpr (Debug::LogMaterialValuesSetters)
         {
@@ -126,11 +614,11 @@ namespace BGLRenderer
         }
     }
 
-    void OpenGLMaterial::setFloat(const std::string& name, std::float_t value)
+    void OpenGLMaterial::setFloat(std::string_view name, std::float_t value)
     {
-        OpenGLMaterialValue* materialValue = getOrCreateValue(name);
-        materialValue->type = OpenGLMaterialValueType::float32;
+        OpenGLMaterialValue* materialValue = getOrCreateValue(name, OpenGLMaterialValueType::float32);
         materialValue->floatValue = value;
+        writeToParameterBlock(*materialValue);
 
         if constexpr (Debug::LogMaterialValuesSetters)
         {
@@ -138,11 +626,11 @@ namespace BGLRenderer
         }
     }
 
-    void OpenGLMaterial::setVector2(const std::string& name, const glm::vec2& value)
+    void OpenGLMaterial::setVector2(std::string_view name, const glm::vec2& value)
     {
-        OpenGLMaterialValue* materialValue = getOrCreateValue(name);
-        materialValue->type = OpenGLMaterialValueType::vector2;
+        OpenGLMaterialValue* materialValue = getOrCreateValue(name, OpenGLMaterialValueType::vector2);
         materialValue->vec2 = value;
+        writeToParameterBlock(*materialValue);
 
         if constexpr (Debug::LogMaterialValuesSetters)
         {
@@ -151,11 +639,11 @@ namespace BGLRenderer
         }
     }
 
-    void OpenGLMaterial::setVector3(const std::string& name, const glm::vec3& value)
+    void OpenGLMaterial::setVector3(std::string_view name, const glm::vec3& value)
     {
-        OpenGLMaterialValue* materialValue = getOrCreateValue(name);
-        materialValue->type = OpenGLMaterialValueType::vector3;
+        OpenGLMaterialValue* materialValue = getOrCreateValue(name, OpenGLMaterialValueType::vector3);
         materialValue->vec3 = value;
+        writeToParameterBlock(*materialValue);
 
         if constexpr (Debug::LogMaterialValuesSetters)
         {
@@ -164,11 +652,11 @@ namespace BGLRenderer
         }
     }
 
-    void OpenGLMaterial::setVector4(const std::string& name, const glm::vec4& value)
+    void OpenGLMaterial::setVector4(std::string_view name, const glm::vec4& value)
     {
-        OpenGLMaterialValue* materialValue = getOrCreateValue(name);
-        materialValue->type = OpenGLMaterialValueType::vector4;
+        OpenGLMaterialValue* materialValue = getOrCreateValue(name, OpenGLMaterialValueType::vector4);
         materialValue->vec4 = value;
+        writeToParameterBlock(*materialValue);
 
         if constexpr (Debug::LogMaterialValuesSetters)
         {
@@ -177,11 +665,11 @@ namespace BGLRenderer
         }
     }
 
-    void OpenGLMaterial::setMatrix4x4(const std::string& name, const glm::mat4x4& value)
+    void OpenGLMaterial::setMatrix4x4(std::string_view name, const glm::mat4x4& value)
     {
-        OpenGLMaterialValue* materialValue = getOrCreateValue(name);
-        materialValue->type = OpenGLMaterialValueType::matrix4x4;
+        OpenGLMaterialValue* materialValue = getOrCreateValue(name, OpenGLMaterialValueType::matrix4x4);
         materialValue->mat4x4 = value;
+        writeToParameterBlock(*materialValue);
 
         if constexpr (Debug::LogMaterialValuesSetters)
         {
@@ -190,16 +678,14 @@ namespace BGLRenderer
         }
     }
 
-    void OpenGLMaterial::setTexture2D(const std::string& name, const std::shared_ptr<OpenGLTexture2D>& texture)
+    void OpenGLMaterial::setTexture2D(std::string_view name, const std::shared_ptr<OpenGLTexture2D>& texture)
     {
-        OpenGLMaterialValue* materialValue = getOrCreateValue(name);
-        materialValue->type = OpenGLMaterialValueType::texture;
+        OpenGLMaterialValue* materialValue = getOrCreateValue(name, OpenGLMaterialValueType::texture);
         materialValue->texture = texture;
 
-        if (_tag == MaterialTag::pbr)
-        {
-            setInt(name + "Exists", 1);
-        }
+        // texture bindings hold their own references
+        _layoutDirty = true;
+        _variantDirty = true;
 
         if constexpr (Debug::LogMaterialValuesSetters)
         {
@@ -211,6 +697,7 @@ namespace BGLRenderer
     void OpenGLMaterial::setProgram(const std::shared_ptr<OpenGLProgram>& program)
     {
         ASSERT(program != nullptr, "Program cannot be nullptr!");
+        ASSERT(_parent == nullptr, "Material instances always use parent's program");
 
         openGLLogger.debug("Material \"{}\" is changing it's program, all values assigned to that material will reset",
                            _name);
@@ -222,73 +709,192 @@ namespace BGLRenderer
         }
 
         _program = program;
+        _baseProgram = program;
 
         _programLinkedListenerHandle = _program->programLinkedPublisher().listen([&] { programDidLinked(); });
 
         if (_program != nullptr)
         {
             updateValuesBasedOnTag();
+            _variantDirty = true;
         }
     }
 
+    const std::shared_ptr<OpenGLProgram>& OpenGLMaterial::program() const
+    {
+        if (_parent != nullptr)
+        {
+            return _parent->program();
+        }
+
+        // selection only swaps derived state, materials are never created as const objects
+        if (_variantDirty)
+        {
+            const_cast<OpenGLMaterial*>(this)->selectProgramVariant();
+        }
+
+        return _program;
+    }
+
+    void OpenGLMaterial::selectProgramVariant()
+    {
+        _variantDirty = false;
+
+        if (_parent != nullptr || _baseProgram == nullptr)
+        {
+            return;
+        }
+
+        // only pbr shaders are written with ShaderFeature defines in mind
+        std::uint32_t featureMask = 0;
+        if (_tag == MaterialTag::pbr)
+        {
+            for (const ShaderFeatureInfo& feature: shaderFeatures)
+            {
+                if (hasTexture(materialValueId(feature.textureName)))
+                {
+                    featureMask |= feature.bit;
+                }
+            }
+        }
+
+        std::shared_ptr<OpenGLProgram> program = featureMask == _baseProgram->featureMask()
+                                                     ? _baseProgram
+                                                     : _baseProgram->variant(featureMask);
+
+        // programs created outside of the asset manager have no variants
+        if (program == nullptr)
+        {
+            program = _baseProgram;
+        }
+
+        // current program is kept until the variant is linked, selection is repeated on the next access
+        if (!program->isReady() && _program->isReady())
+        {
+            _variantDirty = !program->hasErrors();
+            return;
+        }
+
+        if (program == _program)
+        {
+            return;
+        }
+
+        _program->programLinkedPublisher().removeListener(_programLinkedListenerHandle);
+        _program = program;
+        _programLinkedListenerHandle = _program->programLinkedPublisher().listen([&] { programDidLinked(); });
+
+        for (OpenGLMaterialValue& value: _values)
+        {
+            value.uniform = _program->uniformHandle(value.uniformId);
+        }
+
+        _layoutDirty = true;
+    }
+
     void OpenGLMaterial::updateValuesBasedOnTag()
     {
-        if (_tag != MaterialTag::pbr)
+        // instances inherit defaults from the parent
+        if (_tag != MaterialTag::pbr || _parent != nullptr)
         {
             return;
         }
 
-        setInt(std::string(ValuesKeys::baseColor) + ValuesKeys::existsSuffix, hasTexture(ValuesKeys::baseColor));
-        setInt(std::string(ValuesKeys::normalMap) + ValuesKeys::existsSuffix, hasTexture(ValuesKeys::normalMap));
-        setInt(std::string(ValuesKeys::roughnessMap) + ValuesKeys::existsSuffix, hasTexture(ValuesKeys::roughnessMap));
-        setInt(std::string(ValuesKeys::metallicMap) + ValuesKeys::existsSuffix, hasTexture(ValuesKeys::metallicMap));
-        setInt(std::string(ValuesKeys::roughnessMetallicMap) + ValuesKeys::existsSuffix,
-               hasTexture(ValuesKeys::roughnessMetallicMap));
+        // block members can't have initializers in glsl, so defaults have to come from the material
+        if (getValue(MaterialInstanceValueIds::tint) == nullptr)
+        {
+            setVector4(MaterialInstanceValues::tint, {1, 1, 1, 1});
+        }
+
+        if (getValue(MaterialInstanceValueIds::roughness) == nullptr)
+        {
+            setFloat(MaterialInstanceValues::roughness, 0.5f);
+        }
+
+        if (getValue(MaterialInstanceValueIds::metallic) == nullptr)
+        {
+            setFloat(MaterialInstanceValues::metallic, 0.0f);
+        }
     }
 
-    OpenGLMaterialValue *OpenGLMaterial::getOrCreateValue(const std::string& name)
+    OpenGLMaterialValue* OpenGLMaterial::getOrCreateValue(std::string_view name, OpenGLMaterialValueType type)
     {
-        if (!_valuesMap.contains(name))
+        StringId uniformId = materialValueId(name);
+
+        auto it = std::lower_bound(_values.begin(), _values.end(), uniformId,
+                                   [](const OpenGLMaterialValue& value, StringId id)
+                                   {
+                                       return value.uniformId < id;
+                                   });
+
+        if (it == _values.end() || it->uniformId != uniformId)
         {
             OpenGLMaterialValue value{};
+            value.type = type;
             value.name = name;
-            value.uniformLocation = _program->getUniformLocation("u_" + name);
-            _valuesMap[name] = value;
+            value.uniformId = uniformId;
+
+            if (_program != nullptr)
+            {
+                value.uniform = _program->uniformHandle(uniformId);
+            }
+
+            it = _values.insert(it, value);
+            _layoutDirty = true;
+        }
+        else if (it->type != type)
+        {
+            ASSERT(it->name == name, "Material value name hash collision");
+
+            it->type = type;
+            _layoutDirty = true;
         }
 
-        return &_valuesMap[name];
+        return &*it;
     }
 
-    OpenGLMaterialValue *OpenGLMaterial::getValue(const std::string& name)
+    const OpenGLMaterialValue* OpenGLMaterial::getValue(StringId valueId) const
     {
-        if (!_valuesMap.contains(name))
+        auto it = std::lower_bound(_values.begin(), _values.end(), valueId,
+                                   [](const OpenGLMaterialValue& value, StringId id)
+                                   {
+                                       return value.uniformId < id;
+                                   });
+
+        if (it == _values.end() || it->uniformId != valueId)
         {
             return nullptr;
         }
 
-        return &_valuesMap[name];
+        return &*it;
+    }
+
+    OpenGLMaterialValue* OpenGLMaterial::getValue(StringId valueId)
+    {
+        return const_cast<OpenGLMaterialValue*>(std::as_const(*this).getValue(valueId));
     }
 
     void OpenGLMaterial::programDidLinked()
     {
-        for (auto& [key, val]: _valuesMap)
+        // handles are resolved again by the program itself, only report values that lost their uniform
+        for (const OpenGLMaterialValue& value: _values)
         {
-            std::string uniformName = "u_" + val.name;
-            val.uniformLocation = _program->getUniformLocation(uniformName);
-
-            if (val.uniformLocation == -1)
+            if (_program->findUniform(value.uniformId) == nullptr)
             {
-                openGLLogger.warning("Material \"{}\": couldn't find uniform \"{}\" inside of new program.", _name,
-                                     uniformName);
+                openGLLogger.warning("Material \"{}\": couldn't find uniform \"u_{}\" inside of new program.", _name,
+                                     value.name);
             }
         }
 
+        // block layout and texture units may have changed with the new source
+        _layoutDirty = true;
+
         updateValuesBasedOnTag();
     }
 
-    bool OpenGLMaterial::hasTexture(const std::string& name)
+    bool OpenGLMaterial::hasTexture(StringId valueId)
     {
-        OpenGLMaterialValue* val = getValue(name);
-        return val != nullptr && val->type == OpenGLMaterialValueType::texture;
+        OpenGLMaterialValue* val = getValue(valueId);
+        return val != nullptr && val->type == OpenGLMaterialValueType::texture && val->texture != nullptr;
     }
 }
@@ -1,12 +1,16 @@
 ﻿#pragma once
 
+#include <cstddef>
 #include <memory>
 #include <string>
-#include <map>
+#include <string_view>
+#include <vector>
 
 #include <Foundation/GLMMath.h>
+#include <Foundation/StringId.h>
 
 #include "../OpenGLBase.h"
+#include "OpenGLBuffer.h"
 #include "OpenGLProgram.h"
 #include "OpenGLTexture2D.h"
 
@@ -28,7 +32,14 @@ namespace BGLRenderer
     {
         OpenGLMaterialValueType type;
         std::string name;
-        GLint uniformLocation;
+
+        /// @brief Id of "u_" + name, values are kept sorted by it
+        StringId uniformId;
+        OpenGLUniformHandle uniform;
+
+        /// @brief Offset inside MaterialData block, -1 when value is passed as a regular uniform or texture
+        GLint blockOffset = -1;
+        GLint matrixStride = 0;
 
         union
         {
@@ -56,57 +67,194 @@ namespace BGLRenderer
         pbr = 1
     };
 
+    /// @brief Values which are passed per instance, materials that differ only by them can be drawn in one batch
+    namespace MaterialInstanceValues
+    {
+        static constexpr std::string_view tint = "tint";
+        static constexpr std::string_view roughness = "roughness";
+        static constexpr std::string_view metallic = "metallic";
+    }
+
+    /// @brief Material values are keyed by id of the uniform they are passed to, value name prefixed with "u_"
+    constexpr StringId materialValueId(std::string_view name)
+    {
+        return "u_"_sid.append(name);
+    }
+
+    namespace MaterialInstanceValueIds
+    {
+        static constexpr StringId tint = materialValueId(MaterialInstanceValues::tint);
+        static constexpr StringId roughness = materialValueId(MaterialInstanceValues::roughness);
+        static constexpr StringId metallic = materialValueId(MaterialInstanceValues::metallic);
+    }
+
+    class OpenGLMaterial;
+    using OpenGLMaterialHandle = Handle<OpenGLMaterial>;
+
     class OpenGLMaterial
     {
     public:
         OpenGLMaterial(const std::string& name, MaterialType type, MaterialTag tag, const std::shared_ptr<OpenGLProgram>& program);
         OpenGLMaterial(const std::string& name, MaterialType type, MaterialTag tag);
+
+        /// @brief Creates material instance, it stores only values which override the parent and shares parent's
+        /// program, textures and parameter buffer. Instances of instances are flattened to the root material.
+        /// Program variant is chosen by the parent, so texture overrides can only replace parent's textures
+        OpenGLMaterial(const std::string& name, const std::shared_ptr<OpenGLMaterial>& parent);
+
         OpenGLMaterial(const OpenGLMaterial& material);
         ~OpenGLMaterial();
 
         void bind();
 
-        void setInt(const std::string& name, std::int32_t value);
-        void setFloat(const std::string& name, std::float_t value);
-        void setVector2(const std::string& name, const glm::vec2& value);
-        void setVector3(const std::string& name, const glm::vec3& value);
-        void setVector4(const std::string& name, const glm::vec4& value);
-        void setMatrix4x4(const std::string& name, const glm::mat4x4& value);
-        void setTexture2D(const std::string& name, const std::shared_ptr<OpenGLTexture2D>& texture);
+        /// @brief Uploads material values assuming that material's program is already bound
+        void bindValues();
 
-        inline void resetValues() { _valuesMap.clear(); }
+        /// @brief Uploads material values to different program (e.g. instanced variant) which is already bound
+        void bindValues(OpenGLProgram& program);
 
-        inline const std::shared_ptr<OpenGLProgram>& program() const { return _program; }
+        void setInt(std::string_view name, std::int32_t value);
+        void setFloat(std::string_view name, std::float_t value);
+        void setVector2(std::string_view name, const glm::vec2& value);
+        void setVector3(std::string_view name, const glm::vec3& value);
+        void setVector4(std::string_view name, const glm::vec4& value);
+        void setMatrix4x4(std::string_view name, const glm::mat4x4& value);
+        void setTexture2D(std::string_view name, const std::shared_ptr<OpenGLTexture2D>& texture);
+
+        /// @brief Getters take id from materialValueId, so per draw lookups don't hash or copy names
+        std::float_t getFloat(StringId valueId, std::float_t defaultValue) const;
+        glm::vec4 getVector4(StringId valueId, const glm::vec4& defaultValue) const;
+
+        /// @brief Checks if both materials can be drawn in single instanced batch, MaterialInstanceValues are ignored
+        bool isInstancingCompatible(const OpenGLMaterial& other) const;
+
+        inline void resetValues()
+        {
+            _values.clear();
+            _layoutDirty = true;
+        }
+
+        /// @brief Variant of the program chosen from bound textures, see selectProgramVariant
+        const std::shared_ptr<OpenGLProgram>& program() const;
+
+        /// @brief False while texture changes wait for variant selection, which may load programs.
+        /// When it's true program() and valid() only read, so they can be called from worker threads
+        inline bool programSelected() const { return _parent != nullptr ? _parent->programSelected() : !_variantDirty; }
 
         void setProgram(const std::shared_ptr<OpenGLProgram>& program);
 
         inline const std::string& name() const { return _name; }
         inline std::string& name() { return _name; }
 
-        inline MaterialType type() const { return _type; }
+        inline std::uint32_t uniqueId() const { return _uniqueId; }
+        inline OpenGLMaterialHandle handle() const { return _handle; }
+
+        /// @brief Id used by render queue sorting, instances use parent's id so they end up next to each other
+        inline std::uint32_t sortId() const { return _parent != nullptr ? _parent->_uniqueId : _uniqueId; }
+
+        inline const std::shared_ptr<OpenGLMaterial>& parent() const { return _parent; }
+        inline bool isInstance() const { return _parent != nullptr; }
+
+        inline MaterialType type() const { return _parent != nullptr ? _parent->_type : _type; }
         inline void changeType(MaterialType type) { _type = type; }
 
         inline MaterialTag tag() const { return _tag; }
 
-        inline bool valid() const { return _program != nullptr && !_program->hasErrors(); }
+        /// @brief Programs with pending first link are not valid yet
+        inline bool valid() const { return program() != nullptr && program()->isReady(); }
 
         void updateValuesBasedOnTag();
 
     private:
         std::string _name;
+        std::uint32_t _uniqueId;
+        OpenGLMaterialHandle _handle;
         MaterialType _type;
         MaterialTag _tag;
 
         std::shared_ptr<OpenGLProgram> _program;
+
+        /// @brief Program given by the user, _program is its variant
+        std::shared_ptr<OpenGLProgram> _baseProgram;
+
+        // variant is resolved when program is needed, so loading several textures doesn't build intermediate variants
+        bool _variantDirty = false;
         PublisherEmpty::ListenerHandle _programLinkedListenerHandle = PublisherEmpty::listenerHandleInvalid;
         
-        std::map<std::string, OpenGLMaterialValue> _valuesMap;
+        // for instances only overridden values
+        std::vector<OpenGLMaterialValue> _values;
+
+        std::shared_ptr<OpenGLMaterial> _parent;
+
+        // slot inside parent's parameter buffer, slot 0 belongs to the parent itself
+        std::uint32_t _instanceSlot = 0;
+        std::uint32_t _composedGeneration = 0;
+        bool _instanceDirty = true;
+
+        // parent side bookkeeping, indexed by slot - 1, nullptr marks free slot
+        std::vector<OpenGLMaterial*> _instances;
+        std::uint32_t _parameterGeneration = 1;
+        bool _instancesDirty = false;
+
+        struct TextureBinding
+        {
+            StringId uniformId;
+            GLint textureUnit;
+
+            // texture is owned by the value, binding only refers to it
+            OpenGLTexture2DHandle texture;
+        };
+
+        // compiled from values against program's reflection, rebuilt when values are added or program relinks
+        bool _layoutDirty = true;
+        bool _parameterBlockDirty = false;
+        std::vector<std::byte> _parameterBlock;
+        std::unique_ptr<OpenGLBuffer> _parameterBuffer;
+        std::size_t _parameterBlockSize = 0;
+        std::size_t _parameterStride = 0;
+        std::vector<TextureBinding> _textureBindings;
+        std::vector<std::size_t> _uniformValues;
+
+        OpenGLMaterialValue* getOrCreateValue(std::string_view name, OpenGLMaterialValueType type);
+        OpenGLMaterialValue* getValue(StringId valueId);
+        const OpenGLMaterialValue* getValue(StringId valueId) const;
+
+        /// @brief Lays values out into parameter block and texture bindings using reflection of material's program
+        void compile();
 
-        OpenGLMaterialValue* getOrCreateValue(const std::string& name);
-        OpenGLMaterialValue* getValue(const std::string& name);
+        /// @brief Copies value into CPU side parameter block, buffer is updated on next bind
+        void writeToParameterBlock(const OpenGLMaterialValue& value);
+
+        /// @brief Compiles if needed, composes dirty instance slots and uploads parameter buffer
+        void prepareParameters();
+
+        /// @brief Builds instance slot from parent's slot and instance overrides
+        void composeInstance(OpenGLMaterial& instance);
+
+        void bindTexturesAndUniforms(OpenGLProgram& program);
+        void bindParameterSlot(std::uint32_t slot);
+
+        /// @brief Binds instance overrides which are not part of parameter block (textures, regular uniforms)
+        void bindOverrides(OpenGLProgram& program);
+
+        void registerInstance(OpenGLMaterial& instance);
+        void unregisterInstance(const OpenGLMaterial& instance);
+
+        /// @brief Checks that instance overrides only MaterialInstanceValues
+        bool overridesOnlyInstanceValues() const;
+
+        static void writeBlockValue(std::byte* destination, std::size_t available, const OpenGLMaterialValue& value,
+                                    GLint matrixStride);
+
+        void bindUniformValue(OpenGLProgram& program, const OpenGLMaterialValue& value, GLint location);
 
         void programDidLinked();
 
-        bool hasTexture(const std::string& name);
+        /// @brief Pbr materials switch to program variant with ShaderFeature defines matching their textures
+        void selectProgramVariant();
+
+        bool hasTexture(StringId valueId);
+
+        static bool valuesEqual(const OpenGLMaterialValue& a, const OpenGLMaterialValue& b);
     };
 }
@@ -1,47 +1,134 @@
 ﻿#include "OpenGLMesh.h"
 
+#include "../OpenGLDeletionQueue.h"
+#include "../OpenGLStateCache.h"
+
 #include <Foundation/GLMMath.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
 namespace BGLRenderer
 {
-    OpenGLMesh::OpenGLMesh()
-    {
-        GL_CALL(glGenVertexArrays(1, &_vertexArrayObject));
-        GL_CALL(glBindVertexArray(_vertexArrayObject));
+    static std::atomic<std::size_t> meshesReleasedCPUMemory = 0;
+    static std::atomic<std::size_t> meshesGPUMemory = 0;
 
-        GL_CALL(glGenBuffers(1, &_vertexBufferObject));
-        GL_CALL(glGenBuffers(1, &_indicesBufferObject));
-        GL_CALL(glGenBuffers(1, &_normalsBufferObject));
-        GL_CALL(glGenBuffers(1, &_tangentsBufferObject));
-        GL_CALL(glGenBuffers(1, &_uv0BufferObject));
+    template<class T>
+    static void releaseVector(std::vector<T>& vector)
+    {
+        std::vector<T>().swap(vector);
+    }
 
+    OpenGLMesh::OpenGLMesh() :
+        _uniqueId(nextOpenGLResourceId()),
+        _handle(HandlePool<OpenGLMesh>::global().add(this))
+    {
         _indicesCount = 0;
     }
 
     OpenGLMesh::~OpenGLMesh()
     {
-        GL_CALL(glDeleteVertexArrays(1, &_vertexArrayObject));
-        GL_CALL(glDeleteBuffers(1, &_vertexBufferObject));
-        GL_CALL(glDeleteBuffers(1, &_normalsBufferObject));
-        GL_CALL(glDeleteBuffers(1, &_tangentsBufferObject));
-        GL_CALL(glDeleteBuffers(1, &_uv0BufferObject));
-        GL_CALL(glDeleteBuffers(1, &_indicesBufferObject));
+        HandlePool<OpenGLMesh>::global().remove(_handle);
+
+        meshesReleasedCPUMemory -= _releasedCPUMemory;
+        meshesGPUMemory -= gpuMemoryUsage();
+
+        // range may still be drawn by frames in flight and the arena is used only by the context thread,
+        // arena stays alive until the range is freed
+        if (isInArena())
+        {
+            OpenGLDeletionQueue::global().deferRelease([arena = _arena, handle = _arenaHandle]
+            {
+                arena->free(handle);
+            });
+        }
+
+        OpenGLDeletionQueue& deletionQueue = OpenGLDeletionQueue::global();
+        deletionQueue.deleteObject(OpenGLObjectType::vertexArray, _vertexArrayObject);
+        deletionQueue.deleteObject(OpenGLObjectType::buffer, _vertexBufferObject);
+        deletionQueue.deleteObject(OpenGLObjectType::buffer, _normalsBufferObject);
+        deletionQueue.deleteObject(OpenGLObjectType::buffer, _tangentsBufferObject);
+        deletionQueue.deleteObject(OpenGLObjectType::buffer, _uv0BufferObject);
+        deletionQueue.deleteObject(OpenGLObjectType::buffer, _indicesBufferObject);
 
         _vertexArrayObject = 0;
     }
 
     void OpenGLMesh::bind()
     {
-        GL_CALL(glBindVertexArray(_vertexArrayObject));
+        if (isInArena())
+        {
+            _arena->bind();
+            return;
+        }
+
+        OpenGLStateCache::current().bindVertexArray(_vertexArrayObject);
     }
 
     void OpenGLMesh::draw()
     {
-        GL_CALL(glDrawElements(GL_TRIANGLES, _indicesCount, GL_UNSIGNED_INT, 0));
+        if (isInArena())
+        {
+            // range is looked up at draw time, defragmentation moves it
+            const GeometryArenaRange& range = _arena->range(_arenaHandle);
+            GL_CALL(glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+                reinterpret_cast<const void*>(range.firstIndex * sizeof(GLuint)),
+                static_cast<GLint>(range.firstVertex)));
+            return;
+        }
+
+        GL_CALL(glDrawElements(GL_TRIANGLES, _indicesCount, _indexType, 0));
+    }
+
+    void OpenGLMesh::drawInstanced(GLsizei instanceCount, GLuint baseInstance)
+    {
+        if (isInArena())
+        {
+            const GeometryArenaRange& range = _arena->range(_arenaHandle);
+            GL_CALL(glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+                reinterpret_cast<const void*>(range.firstIndex * sizeof(GLuint)), instanceCount,
+                static_cast<GLint>(range.firstVertex), baseInstance));
+            return;
+        }
+
+        if (baseInstance != 0)
+        {
+            GL_CALL(glDrawElementsInstancedBaseInstance(GL_TRIANGLES, _indicesCount, _indexType, 0, instanceCount,
+                baseInstance));
+            return;
+        }
+
+        GL_CALL(glDrawElementsInstanced(GL_TRIANGLES, _indicesCount, _indexType, 0, instanceCount));
+    }
+
+    void OpenGLMesh::setVertexData(const VertexLayout& layout, const void* data, GLuint vertexCount,
+                                   const VertexDecodeParameters& decodeParameters)
+    {
+        ASSERT(!layout.empty(), "Vertex layout cannot be empty");
+
+        createBuffers();
+        bind();
+
+        const std::size_t size = static_cast<std::size_t>(layout.stride()) * vertexCount;
+
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject));
+        GL_CALL(glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(size), data, GL_STATIC_DRAW));
+
+        layout.apply();
+
+        _vertexLayout = layout;
+        _decodeParameters = decodeParameters;
+        _vertexCount = vertexCount;
+        trackBufferSize(_vertexBufferSize, size);
+
+        const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+        _vertexData = std::vector<std::uint8_t>(bytes, bytes + size);
     }
 
     void OpenGLMesh::setVertices(GLfloat* vertices, GLuint count)
     {
+        createBuffers();
         bind();
 
         GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferObject));
@@ -49,12 +136,14 @@ namespace BGLRenderer
 
         GL_CALL(glEnableVertexAttribArray(0));
         GL_CALL(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0));
+        trackBufferSize(_vertexBufferSize, sizeof(GLfloat) * count);
 
         _positions = std::vector<GLfloat>(vertices, vertices + count);
     }
 
     void OpenGLMesh::setNormals(GLfloat* normals, GLuint count)
     {
+        createBuffers();
         bind();
 
         GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, _normalsBufferObject));
@@ -62,12 +151,14 @@ namespace BGLRenderer
 
         GL_CALL(glEnableVertexAttribArray(1));
         GL_CALL(glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0));
+        trackBufferSize(_normalsBufferSize, sizeof(GLfloat) * count);
 
         _normals = std::vector<GLfloat>(normals, normals + count);
     }
 
     void OpenGLMesh::setTangents(GLfloat* tangents, GLuint count)
     {
+        createBuffers();
         bind();
 
         GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, _tangentsBufferObject));
@@ -75,12 +166,14 @@ namespace BGLRenderer
 
         GL_CALL(glEnableVertexAttribArray(2));
         GL_CALL(glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0));
+        trackBufferSize(_tangentsBufferSize, sizeof(GLfloat) * count);
 
         _tangents = std::vector<GLfloat>(tangents, tangents + count);
     }
 
     void OpenGLMesh::setUVs0(GLfloat* uvs, GLuint count)
     {
+        createBuffers();
         bind();
 
         GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, _uv0BufferObject));
@@ -88,21 +181,191 @@ namespace BGLRenderer
 
         GL_CALL(glEnableVertexAttribArray(3));
         GL_CALL(glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 0, 0));
+        trackBufferSize(_uv0BufferSize, sizeof(GLfloat) * count);
 
         _uvs = std::vector<GLfloat>(uvs, uvs + count);
     }
 
-    void OpenGLMesh::setIndices(GLuint* indices, GLuint count)
+    void OpenGLMesh::setIndices(GLuint* indices, GLuint count, bool allowShortIndices)
     {
+        createBuffers();
         bind();
         GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indicesBufferObject));
-        GL_CALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * count, indices, GL_STATIC_DRAW));
+
+        const bool shortIndices = allowShortIndices &&
+                                  std::all_of(indices, indices + count, [](GLuint index)
+                                  {
+                                      return index <= std::numeric_limits<GLushort>::max();
+                                  });
+
+        if (shortIndices)
+        {
+            std::vector<GLushort> shortIndicesData(indices, indices + count);
+            GL_CALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * count, shortIndicesData.data(),
+                GL_STATIC_DRAW));
+
+            _indexType = GL_UNSIGNED_SHORT;
+            trackBufferSize(_indicesBufferSize, sizeof(GLushort) * count);
+        }
+        else
+        {
+            GL_CALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * count, indices, GL_STATIC_DRAW));
+
+            _indexType = GL_UNSIGNED_INT;
+            trackBufferSize(_indicesBufferSize, sizeof(GLuint) * count);
+        }
 
         _indicesCount = count;
 
         _indices = std::vector<GLuint>(indices, indices + count);
     }
 
+    void OpenGLMesh::bindDecodeParameters(OpenGLProgram& program) const
+    {
+        program.setVector3("u_positionOffset", _decodeParameters.positionOffset);
+        program.setVector3("u_positionScale", _decodeParameters.positionScale);
+        program.setInt("u_octahedralNormals", _decodeParameters.octahedralNormals ? 1 : 0);
+    }
+
+    void OpenGLMesh::setArenaGeometry(const std::shared_ptr<OpenGLGeometryArena>& arena, const void* vertexData,
+                                      GLuint vertexCount, const VertexDecodeParameters& decodeParameters,
+                                      const GLuint* indices, GLuint indexCount)
+    {
+        ASSERT(arena != nullptr, "Arena cannot be nullptr");
+        ASSERT(!isInArena(), "Mesh is already stored in the arena");
+        ASSERT(_vertexArrayObject == 0, "Mesh already has its own buffers");
+
+        _arena = arena;
+        _arenaHandle = _arena->allocate(vertexData, vertexCount, indices, indexCount);
+
+        _vertexLayout = arena->vertexLayout();
+        _decodeParameters = decodeParameters;
+        _vertexCount = vertexCount;
+        _indicesCount = indexCount;
+        _indexType = GL_UNSIGNED_INT;
+
+        // CPU copies follow the same retention rules as for meshes with own buffers
+        const std::uint8_t* bytes = static_cast<const std::uint8_t*>(vertexData);
+        _vertexData = std::vector<std::uint8_t>(bytes, bytes + static_cast<std::size_t>(_vertexLayout.stride()) * vertexCount);
+        _indices = std::vector<GLuint>(indices, indices + indexCount);
+    }
+
+    void OpenGLMesh::applyRetention(MeshDataRetention retention)
+    {
+        if (retention == MeshDataRetention::all)
+        {
+            return;
+        }
+
+        const std::size_t usageBefore = cpuMemoryUsage();
+
+        if (retention == MeshDataRetention::positionsAndIndices && _positions.empty() && !_vertexData.empty())
+        {
+            // extract positions from interleaved data before it's dropped
+            const VertexAttributeFormat* position = _vertexLayout.find(VertexAttributeLocation::position);
+            if (position != nullptr && position->type == GL_FLOAT && position->components == 3)
+            {
+                _positions.resize(static_cast<std::size_t>(_vertexCount) * 3);
+                for (std::size_t i = 0; i < _vertexCount; ++i)
+                {
+                    std::memcpy(&_positions[i * 3], _vertexData.data() + i * _vertexLayout.stride() + position->offset,
+                                sizeof(GLfloat) * 3);
+                }
+            }
+            else if (position != nullptr && position->type == GL_SHORT && position->normalized)
+            {
+                // quantized positions are decoded the same way as in vertex_decode.glsl
+                _positions.resize(static_cast<std::size_t>(_vertexCount) * 3);
+                for (std::size_t i = 0; i < _vertexCount; ++i)
+                {
+                    GLshort packed[3];
+                    std::memcpy(packed, _vertexData.data() + i * _vertexLayout.stride() + position->offset,
+                                sizeof(packed));
+
+                    for (std::size_t component = 0; component < 3; ++component)
+                    {
+                        float normalized = std::max(static_cast<float>(packed[component]) / 32767.0f, -1.0f);
+                        _positions[i * 3 + component] = _decodeParameters.positionOffset[static_cast<int>(component)] +
+                                                        normalized *
+                                                        _decodeParameters.positionScale[static_cast<int>(component)];
+                    }
+                }
+            }
+            else
+            {
+                openGLLogger.warning("Mesh positions use unsupported format, they cannot be retained");
+            }
+        }
+
+        releaseVector(_vertexData);
+        releaseVector(_normals);
+        releaseVector(_tangents);
+        releaseVector(_uvs);
+
+        if (retention == MeshDataRetention::discard)
+        {
+            releaseVector(_positions);
+            releaseVector(_indices);
+        }
+
+        const std::size_t released = usageBefore > cpuMemoryUsage() ? usageBefore - cpuMemoryUsage() : 0;
+        _releasedCPUMemory += released;
+        meshesReleasedCPUMemory += released;
+    }
+
+    std::size_t OpenGLMesh::cpuMemoryUsage() const
+    {
+        return _vertexData.capacity() +
+               (_positions.capacity() + _normals.capacity() + _tangents.capacity() + _uvs.capacity()) * sizeof(GLfloat) +
+               _indices.capacity() * sizeof(GLuint);
+    }
+
+    std::size_t OpenGLMesh::releasedCPUMemory()
+    {
+        return meshesReleasedCPUMemory;
+    }
+
+    std::size_t OpenGLMesh::gpuMemoryUsage() const
+    {
+        return _vertexBufferSize + _normalsBufferSize + _tangentsBufferSize + _uv0BufferSize + _indicesBufferSize;
+    }
+
+    std::size_t OpenGLMesh::totalGPUMemory()
+    {
+        return meshesGPUMemory;
+    }
+
+    void OpenGLMesh::trackSharedGPUMemory(std::size_t& bufferSize, std::size_t newSize)
+    {
+        trackBufferSize(bufferSize, newSize);
+    }
+
+    void OpenGLMesh::trackBufferSize(std::size_t& bufferSize, std::size_t newSize)
+    {
+        meshesGPUMemory -= bufferSize;
+        meshesGPUMemory += newSize;
+        bufferSize = newSize;
+    }
+
+    void OpenGLMesh::createBuffers()
+    {
+        ASSERT(!isInArena(), "Mesh stored in the arena cannot have its own buffers");
+
+        if (_vertexArrayObject != 0)
+        {
+            return;
+        }
+
+        GL_CALL(glGenVertexArrays(1, &_vertexArrayObject));
+        OpenGLStateCache::current().bindVertexArray(_vertexArrayObject);
+
+        GL_CALL(glGenBuffers(1, &_vertexBufferObject));
+        GL_CALL(glGenBuffers(1, &_indicesBufferObject));
+        GL_CALL(glGenBuffers(1, &_normalsBufferObject));
+        GL_CALL(glGenBuffers(1, &_tangentsBufferObject));
+        GL_CALL(glGenBuffers(1, &_uv0BufferObject));
+    }
+
     void OpenGLMesh::calculateNormals(std::vector<GLfloat>& target, const std::vector<GLfloat>& positions, const std::vector<GLuint>& indices)
     {
         ASSERT(indices.size() % 3 == 0, "Invalid indices buffer size! Must be dividable by 3");
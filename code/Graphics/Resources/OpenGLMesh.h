@@ -1,27 +1,97 @@
 ﻿#pragma once
 
 #include "../OpenGLBase.h"
+#include "../Bounds.h"
+#include "OpenGLGeometryArena.h"
+#include "OpenGLProgram.h"
+#include "VertexLayout.h"
 
 namespace BGLRenderer
 {
+    /// @brief Which CPU side copies of uploaded geometry are kept by the mesh
+    enum class MeshDataRetention
+    {
+        discard,
+        positionsAndIndices, // e.g. for picking or CPU side collision
+        all
+    };
+
+    class OpenGLMesh;
+    using OpenGLMeshHandle = Handle<OpenGLMesh>;
+
     class OpenGLMesh
     {
     public:
         OpenGLMesh();
         ~OpenGLMesh();
 
+        /// @brief Binds mesh's own vertex array or the shared one of its arena
         void bind();
 
         void draw();
 
+        /// @brief Instance attributes are read from baseInstance, meshes in the arena always draw with base instance
+        void drawInstanced(GLsizei instanceCount, GLuint baseInstance = 0);
+
+        /// @brief Uploads all attributes as single interleaved buffer described by layout,
+        /// decode parameters are required when the layout is compressed
+        void setVertexData(const VertexLayout& layout, const void* data, GLuint vertexCount,
+                           const VertexDecodeParameters& decodeParameters = {});
+
+        // per attribute streams, each one is stored in separate buffer
         void setVertices(GLfloat* vertices, GLuint count);
         void setNormals(GLfloat* normals, GLuint count);
         void setTangents(GLfloat* tangents, GLuint count);
 
         void setUVs0(GLfloat* uvs, GLuint count);
 
-        void setIndices(GLuint* indices, GLuint count);
+        /// @brief Indices are uploaded as 16-bit values when allowed and every index fits,
+        /// CPU copy always stays 32-bit
+        void setIndices(GLuint* indices, GLuint count, bool allowShortIndices = false);
+
+        /// @brief Sets uniforms used by vertex_decode.glsl, has to be called for non instanced draws
+        void bindDecodeParameters(OpenGLProgram& program) const;
+
+        inline std::uint32_t uniqueId() const { return _uniqueId; }
+        inline OpenGLMeshHandle handle() const { return _handle; }
+
+        /// @brief Stores geometry only in the arena as a range of its buffers, the mesh doesn't create buffers
+        /// of its own. Vertices have to be interleaved in arena's layout, cannot be combined with other setters
+        void setArenaGeometry(const std::shared_ptr<OpenGLGeometryArena>& arena, const void* vertexData,
+                              GLuint vertexCount, const VertexDecodeParameters& decodeParameters,
+                              const GLuint* indices, GLuint indexCount);
+
+        inline bool isInArena() const { return _arenaHandle != geometryArenaHandleInvalid; }
+        inline GeometryArenaHandle arenaHandle() const { return _arenaHandle; }
+        inline const std::shared_ptr<OpenGLGeometryArena>& arena() const { return _arena; }
+
+        /// @brief Frees CPU copies which are not required by the policy, has to be called after data is uploaded
+        /// (including setArenaGeometry), dropped data cannot be restored
+        void applyRetention(MeshDataRetention retention);
+
+        /// @brief Size of geometry currently kept in CPU memory
+        std::size_t cpuMemoryUsage() const;
 
+        /// @brief Amount of bytes freed by applyRetention for all living meshes
+        static std::size_t releasedCPUMemory();
+
+        inline void setBounds(const MeshBounds& bounds) { _bounds = bounds; }
+        inline const MeshBounds& bounds() const { return _bounds; }
+
+        inline const VertexDecodeParameters& decodeParameters() const { return _decodeParameters; }
+        inline GLenum indexType() const { return _indexType; }
+
+        /// @brief Size of buffers owned by the mesh, 0 for meshes stored in the arena
+        std::size_t gpuMemoryUsage() const;
+
+        /// @brief Sum of gpuMemoryUsage for all living meshes and buffers of geometry arenas
+        static std::size_t totalGPUMemory();
+
+        /// @brief Geometry arena reports its buffers here, so they are counted once for all meshes inside
+        static void trackSharedGPUMemory(std::size_t& bufferSize, std::size_t newSize);
+
+        [[nodiscard]] const VertexLayout& vertexLayout() const { return _vertexLayout; }
+        [[nodiscard]] const std::vector<std::uint8_t>& vertexData() const { return _vertexData; }
         [[nodiscard]] const std::vector<GLfloat>& positions() const { return _positions; }
         [[nodiscard]] const std::vector<GLfloat>& normals() const { return _normals; }
         [[nodiscard]] const std::vector<GLfloat>& tangents() const { return _tangents; }
@@ -29,6 +99,14 @@ namespace BGLRenderer
         [[nodiscard]] const std::vector<GLuint>& indices() const { return _indices; }
 
     private:
+        std::uint32_t _uniqueId;
+        OpenGLMeshHandle _handle;
+        MeshBounds _bounds{};
+        std::size_t _releasedCPUMemory = 0;
+
+        std::shared_ptr<OpenGLGeometryArena> _arena = nullptr;
+        GeometryArenaHandle _arenaHandle = geometryArenaHandleInvalid;
+
         GLuint _vertexArrayObject = 0;
         GLuint _vertexBufferObject = 0;
         GLuint _normalsBufferObject = 0;
@@ -37,6 +115,19 @@ namespace BGLRenderer
         GLuint _indicesBufferObject = 0;
 
         GLuint _indicesCount;
+        GLuint _vertexCount = 0;
+        GLenum _indexType = GL_UNSIGNED_INT;
+
+        // uploaded sizes of matching buffer objects
+        std::size_t _vertexBufferSize = 0;
+        std::size_t _normalsBufferSize = 0;
+        std::size_t _tangentsBufferSize = 0;
+        std::size_t _uv0BufferSize = 0;
+        std::size_t _indicesBufferSize = 0;
+
+        VertexLayout _vertexLayout{};
+        VertexDecodeParameters _decodeParameters{};
+        std::vector<std::uint8_t> _vertexData;
 
         // TODO: make these values optional
         std::vector<GLfloat> _positions;
@@ -45,6 +136,11 @@ namespace BGLRenderer
         std::vector<GLfloat> _uvs;
         std::vector<GLuint> _indices;
 
+        static void trackBufferSize(std::size_t& bufferSize, std::size_t newSize);
+
+        /// @brief Buffers are created by the first setter, meshes stored in the arena never create them
+        void createBuffers();
+
     public:
         static void calculateNormals(std::vector<GLfloat>& target, const std::vector<GLfloat>& positions, const std::vector<GLuint>& indices);
         static void calculateTangents(std::vector<GLfloat>& target,
@@ -1,141 +1,392 @@
 ﻿#include "OpenGLProgram.h"
 
+#include "../OpenGLDeletionQueue.h"
+#include "../OpenGLStateCache.h"
+
+#include <utility>
 #include <vector>
 
 #include <gtc/type_ptr.hpp>
 
 namespace BGLRenderer
 {
+    namespace UniformBlockNames
+    {
+        static constexpr StringId frameData = "FrameData"_sid;
+        static constexpr StringId materialData = "MaterialData"_sid;
+    }
+
     OpenGLProgram::OpenGLProgram(const std::string& name, const std::string& vertexShaderCode,
                                  const std::string& fragmentShaderCode) :
         _name(name),
+        _uniqueId(nextOpenGLResourceId()),
+        _handle(HandlePool<OpenGLProgram>::global().add(this)),
         _vertexShaderCode(vertexShaderCode),
         _fragmentShaderCode(fragmentShaderCode)
     {
         openGLLogger.debug("Creating OpenGL program \"{}\":", name);
 
-        _program = glCreateProgram();
-        ASSERT(_program != 0, "Failed to create opengl program");
+        submitLink(vertexShaderCode, fragmentShaderCode);
+    }
+
+    OpenGLProgram::OpenGLProgram(const std::string& name, GLenum separableStage, const std::string& shaderCode) :
+        _name(name),
+        _uniqueId(nextOpenGLResourceId()),
+        _handle(HandlePool<OpenGLProgram>::global().add(this)),
+        _separableStage(separableStage)
+    {
+        ASSERT((separableStage == GL_VERTEX_SHADER || separableStage == GL_FRAGMENT_SHADER),
+               "Separable program supports only vertex or fragment stage");
 
-        //openGLLogger.debug("Vertex shader code:\n{}", vertexShaderCode);
-        _vertexShader = createShader(vertexShaderCode, GL_VERTEX_SHADER);
+        openGLLogger.debug("Creating separable OpenGL program \"{}\":", name);
 
-        if (_vertexShader == 0)
+        if (separableStage == GL_VERTEX_SHADER)
         {
-            openGLLogger.error("Failed to compile vertex shader for program \"{}\"", name);
-            _hasErrors = true;
-            return;
+            _vertexShaderCode = shaderCode;
+        }
+        else
+        {
+            _fragmentShaderCode = shaderCode;
         }
 
-        GL_CALL(glAttachShader(_program, _vertexShader));
+        submitLink(_vertexShaderCode, _fragmentShaderCode);
+    }
 
-        //openGLLogger.debug("Fragment shader code:\n{}", fragmentShaderCode);
-        _fragmentShader = createShader(fragmentShaderCode, GL_FRAGMENT_SHADER);
+    OpenGLProgram::OpenGLProgram(const std::string& name, const std::string& vertexShaderCode,
+                                 const std::string& fragmentShaderCode, const OpenGLProgramBinary& binary) :
+        _name(name),
+        _uniqueId(nextOpenGLResourceId()),
+        _handle(HandlePool<OpenGLProgram>::global().add(this)),
+        _vertexShaderCode(vertexShaderCode),
+        _fragmentShaderCode(fragmentShaderCode)
+    {
+        openGLLogger.debug("Creating OpenGL program \"{}\" from binary:", name);
+
+        GLuint program = glCreateProgram();
+        ASSERT(program != 0, "Failed to create opengl program");
 
-        if (_fragmentShader == 0)
+        if (loadBinary(program, binary))
         {
-            openGLLogger.error("Failed to compile fragment shader for program \"{}\"", name);
-            _hasErrors = true;
+            _program = program;
+            _state = OpenGLProgramState::ready;
+            _loadedFromBinary = true;
+
+            didLink();
             return;
         }
 
-        GL_CALL(glAttachShader(_program, _fragmentShader));
+        GL_CALL(glDeleteProgram(program));
 
-        link();
+        openGLLogger.debug("Driver rejected binary of program \"{}\", compiling from source", name);
+        submitLink(vertexShaderCode, fragmentShaderCode);
     }
 
     OpenGLProgram::~OpenGLProgram()
     {
-        if (_vertexShader != 0)
+        HandlePool<OpenGLProgram>::global().remove(_handle);
+
+        OpenGLDeletionQueue& deletionQueue = OpenGLDeletionQueue::global();
+
+        if (hasPendingLink())
         {
-            GL_CALL(glDeleteShader(_vertexShader));
+            if (_pendingLink.vertexShader != _vertexShader)
+            {
+                deletionQueue.deleteObject(OpenGLObjectType::shader, _pendingLink.vertexShader);
+            }
+
+            if (_pendingLink.fragmentShader != _fragmentShader)
+            {
+                deletionQueue.deleteObject(OpenGLObjectType::shader, _pendingLink.fragmentShader);
+            }
+
+            deletionQueue.deleteObject(OpenGLObjectType::program, _pendingLink.program);
         }
 
-        if (_fragmentShader != 0)
+        deletionQueue.deleteObject(OpenGLObjectType::shader, _vertexShader);
+        deletionQueue.deleteObject(OpenGLObjectType::shader, _fragmentShader);
+        deletionQueue.deleteObject(OpenGLObjectType::program, _program);
+    }
+
+    bool OpenGLProgram::binariesSupported()
+    {
+        static const bool supported = []
         {
-            GL_CALL(glDeleteShader(_fragmentShader));
-        }
+            if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary)
+            {
+                return false;
+            }
 
-        GL_CALL(glDeleteProgram(_program));
+            GLint formatsCount = 0;
+            GL_CALL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatsCount));
+            return formatsCount > 0;
+        }();
+
+        return supported;
     }
 
-    bool OpenGLProgram::tryToUpdateVertexShader(const std::string& shaderCode)
+    bool OpenGLProgram::parallelCompileSupported()
     {
-        bind();
+        static const bool supported = []
+        {
+            // 0xFFFFFFFF lets the driver pick number of compiler threads
+            if (GLAD_GL_KHR_parallel_shader_compile)
+            {
+                GL_CALL(glMaxShaderCompilerThreadsKHR(0xFFFFFFFF));
+                return true;
+            }
+
+            if (GLAD_GL_ARB_parallel_shader_compile)
+            {
+                GL_CALL(glMaxShaderCompilerThreadsARB(0xFFFFFFFF));
+                return true;
+            }
 
-        GLuint oldShader = _vertexShader;
-        GL_CALL(glDetachShader(_program, oldShader));
+            return false;
+        }();
 
-        _vertexShader = createShader(shaderCode, GL_VERTEX_SHADER);
+        return supported;
+    }
 
-        if (_vertexShader == 0)
+    bool OpenGLProgram::getBinary(OpenGLProgramBinary& binary) const
+    {
+        if (!isReady() || !binariesSupported())
         {
-            openGLLogger.error("Failed to update vertex shader!");
-            _vertexShader = oldShader;
             return false;
         }
 
-        GL_CALL(glAttachShader(_program, _vertexShader));
+        GLint binaryLength = 0;
+        GL_CALL(glGetProgramiv(_program, GL_PROGRAM_BINARY_LENGTH, &binaryLength));
 
-        if (!link())
+        if (binaryLength <= 0)
         {
-            GL_CALL(glDetachShader(_program, _vertexShader));
-            GL_CALL(glDeleteShader(_vertexShader));
-            _vertexShader = oldShader;
+            return false;
+        }
 
-            GL_CALL(glAttachShader(_program, _fragmentShader));
+        binary.data.resize(static_cast<std::size_t>(binaryLength));
+        GL_CALL(glGetProgramBinary(_program, binaryLength, nullptr, &binary.format, binary.data.data()));
 
-            link();
+        return true;
+    }
 
+    bool OpenGLProgram::loadBinary(GLuint program, const OpenGLProgramBinary& binary)
+    {
+        if (!binariesSupported() || binary.data.empty())
+        {
             return false;
         }
 
-        GL_CALL(glDeleteShader(oldShader));
+        // rejection is expected after driver updates, so it's not reported as an error
+        const bool muteDebugOutput = Debug::openGLDebugOutput && (GLAD_GL_VERSION_4_3 || GLAD_GL_KHR_debug);
+        if (muteDebugOutput)
+        {
+            // message control changes made inside the group are reverted when it's popped
+            glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, "Load program binary");
+            glDebugMessageControl(GL_DEBUG_SOURCE_API, GL_DEBUG_TYPE_ERROR, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+        }
+
+        glProgramBinary(program, binary.format, binary.data.data(), static_cast<GLsizei>(binary.data.size()));
+
+        if (muteDebugOutput)
+        {
+            glPopDebugGroup();
+        }
+
+#if BGL_GL_ERROR_CHECK == BGL_GL_ERROR_CHECK_GET_ERROR
+        // next GL_CALL would report the rejection
+        while (glGetError() != GL_NO_ERROR)
+        {
+        }
+#endif
+
+        GLint isLinked = GL_FALSE;
+        GL_CALL(glGetProgramiv(program, GL_LINK_STATUS, &isLinked));
+
+        return isLinked != GL_FALSE;
+    }
 
-        _vertexShaderCode = shaderCode;
+    void OpenGLProgram::submitLink(const std::string& vertexShaderCode, const std::string& fragmentShaderCode)
+    {
+        // pending sources have to be copied before the link is cancelled, they can be passed in from it
+        PendingLink pending{};
+        pending.vertexShaderCode = vertexShaderCode;
+        pending.fragmentShaderCode = fragmentShaderCode;
+
+        cancelPendingLink();
+
+        pending.program = glCreateProgram();
+        ASSERT(pending.program != 0, "Failed to create opengl program");
+
+        pending.vertexShader = _vertexShader != 0 && pending.vertexShaderCode == _vertexShaderCode
+                                   ? _vertexShader
+                                   : submitShader(pending.vertexShaderCode, GL_VERTEX_SHADER);
+        pending.fragmentShader = _fragmentShader != 0 && pending.fragmentShaderCode == _fragmentShaderCode
+                                     ? _fragmentShader
+                                     : submitShader(pending.fragmentShaderCode, GL_FRAGMENT_SHADER);
+
+        // linking waits for compilation on the driver side, status isn't queried until the link is done
+        if (pending.vertexShader != 0)
+        {
+            GL_CALL(glAttachShader(pending.program, pending.vertexShader));
+        }
+
+        if (pending.fragmentShader != 0)
+        {
+            GL_CALL(glAttachShader(pending.program, pending.fragmentShader));
+        }
+
+        if (isSeparable())
+        {
+            GL_CALL(glProgramParameteri(pending.program, GL_PROGRAM_SEPARABLE, GL_TRUE));
+        }
+
+        if (binariesSupported())
+        {
+            GL_CALL(glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+        }
+
+        GL_CALL(glLinkProgram(pending.program));
+
+        _pendingLink = std::move(pending);
+    }
+
+    void OpenGLProgram::cancelPendingLink()
+    {
+        if (!hasPendingLink())
+        {
+            return;
+        }
+
+        PendingLink pending = std::exchange(_pendingLink, {});
+        deletePendingShaders(pending);
+        GL_CALL(glDeleteProgram(pending.program));
+    }
+
+    void OpenGLProgram::deletePendingShaders(const PendingLink& pending)
+    {
+        if (pending.vertexShader != _vertexShader)
+        {
+            GL_CALL(glDeleteShader(pending.vertexShader));
+        }
+
+        if (pending.fragmentShader != _fragmentShader)
+        {
+            GL_CALL(glDeleteShader(pending.fragmentShader));
+        }
+    }
+
+    bool OpenGLProgram::pollLink()
+    {
+        if (!hasPendingLink())
+        {
+            return true;
+        }
+
+        if (parallelCompileSupported())
+        {
+            GLint isCompleted = GL_FALSE;
+            GL_CALL(glGetProgramiv(_pendingLink.program, GL_COMPLETION_STATUS_KHR, &isCompleted));
+
+            if (isCompleted == GL_FALSE)
+            {
+                return false;
+            }
+        }
+
+        finishLink();
         return true;
     }
 
-    bool OpenGLProgram::tryToUpdateFragmentShader(const std::string& shaderCode)
+    void OpenGLProgram::finishLink()
     {
-        bind();
+        if (!hasPendingLink())
+        {
+            return;
+        }
 
-        GLuint oldShader = _fragmentShader;
-        GL_CALL(glDetachShader(_program, oldShader));
+        PendingLink pending = std::exchange(_pendingLink, {});
 
-        _fragmentShader = createShader(shaderCode, GL_FRAGMENT_SHADER);
+        GLint isLinked = GL_FALSE;
+        GL_CALL(glGetProgramiv(pending.program, GL_LINK_STATUS, &isLinked));
 
-        if (_fragmentShader == 0)
+        if (isLinked == GL_FALSE)
         {
-            openGLLogger.error("Failed to update fragment shader!");
-            _fragmentShader = oldShader;
-            return false;
+            logShaderErrors(pending.vertexShader, "Vertex");
+            logShaderErrors(pending.fragmentShader, "Fragment");
+
+            GLint maxLength = 0;
+            GL_CALL(glGetProgramiv(pending.program, GL_INFO_LOG_LENGTH, &maxLength));
+
+            std::vector<GLchar> infoLog(static_cast<std::size_t>(std::max(maxLength, 1)));
+            GL_CALL(glGetProgramInfoLog(pending.program, maxLength, &maxLength, infoLog.data()));
+
+            openGLLogger.error("Program \"{}\" linking error:\n{}", _name, infoLog.data());
+
+            deletePendingShaders(pending);
+            GL_CALL(glDeleteProgram(pending.program));
+
+            // after hot reload the previous version keeps working
+            if (_program == 0)
+            {
+                _state = OpenGLProgramState::failed;
+            }
+
+            return;
+        }
+
+        if (_program != 0)
+        {
+            OpenGLStateCache::current().forgetProgram(_program);
+            GL_CALL(glDeleteProgram(_program));
         }
 
-        GL_CALL(glAttachShader(_program, _fragmentShader));
+        if (_vertexShader != 0 && _vertexShader != pending.vertexShader)
+        {
+            GL_CALL(glDeleteShader(_vertexShader));
+        }
 
-        if (!link())
+        if (_fragmentShader != 0 && _fragmentShader != pending.fragmentShader)
         {
-            GL_CALL(glDetachShader(_program, _fragmentShader));
             GL_CALL(glDeleteShader(_fragmentShader));
-            _fragmentShader = oldShader;
+        }
 
-            GL_CALL(glAttachShader(_program, _fragmentShader));
+        _program = pending.program;
+        _vertexShader = pending.vertexShader;
+        _fragmentShader = pending.fragmentShader;
+        _vertexShaderCode = std::move(pending.vertexShaderCode);
+        _fragmentShaderCode = std::move(pending.fragmentShaderCode);
 
-            link();
+        _state = OpenGLProgramState::ready;
+        _loadedFromBinary = false;
 
+        openGLLogger.debug("Program \"{}\" successfully linked!", _name);
+
+        didLink();
+    }
+
+    bool OpenGLProgram::tryToUpdateShaders(const std::string& vertexShaderCode, const std::string& fragmentShaderCode)
+    {
+        const std::string& currentVertexShaderCode = hasPendingLink() ? _pendingLink.vertexShaderCode : _vertexShaderCode;
+        const std::string& currentFragmentShaderCode = hasPendingLink() ? _pendingLink.fragmentShaderCode : _fragmentShaderCode;
+
+        // saving a file without changes still touches its write time
+        if (vertexShaderCode == currentVertexShaderCode && fragmentShaderCode == currentFragmentShaderCode)
+        {
             return false;
         }
 
-        GL_CALL(glDeleteShader(oldShader));
-
-        _fragmentShaderCode = shaderCode;
+        submitLink(vertexShaderCode, fragmentShaderCode);
         return true;
     }
 
     void OpenGLProgram::bind()
     {
-        GL_CALL(glUseProgram(_program));
+        if (_state == OpenGLProgramState::pending)
+        {
+            openGLLogger.debug("Program \"{}\" is bound before its link is done, waiting for the driver", _name);
+            finishLink();
+        }
+
+        OpenGLStateCache::current().useProgram(_program);
     }
 
     void OpenGLProgram::setInt(GLint location, GLint value)
@@ -168,44 +419,246 @@ namespace BGLRenderer
         glUniformMatrix4fv(location, 1, GL_FALSE, const_cast<float *>(glm::value_ptr(value)));
     }
 
-    GLint OpenGLProgram::getUniformLocation(const std::string& name)
+    GLint OpenGLProgram::getUniformLocation(StringId name) const
     {
-        GLint location = glGetUniformLocation(_program, name.c_str());
-        return location;
+        const OpenGLUniformInfo* uniform = findUniform(name);
+        return uniform != nullptr ? uniform->location : -1;
     }
 
-    bool OpenGLProgram::link()
+    OpenGLUniformHandle OpenGLProgram::uniformHandle(StringId name)
     {
-        openGLLogger.debug("Linking program...");
+        auto it = _uniformSlotIndices.find(name);
+        if (it != _uniformSlotIndices.end())
+        {
+            return {it->second};
+        }
 
-        GL_CALL(glLinkProgram(_program));
+        std::uint32_t slot = static_cast<std::uint32_t>(_uniformSlots.size());
+        _uniformSlots.push_back({name, getUniformLocation(name)});
+        _uniformSlotIndices[name] = slot;
 
-        GLint isLinked = GL_FALSE;
-        GL_CALL(glGetProgramiv(_program, GL_LINK_STATUS, &isLinked));
+        return {slot};
+    }
 
-        if (isLinked == GL_FALSE)
+    const OpenGLUniformInfo* OpenGLProgram::findUniform(StringId name) const
+    {
+        auto it = _uniformIndices.find(name);
+        return it != _uniformIndices.end() ? &_uniforms[it->second] : nullptr;
+    }
+
+    const OpenGLUniformBlockInfo* OpenGLProgram::findUniformBlock(StringId name) const
+    {
+        auto it = _uniformBlockIndices.find(name);
+        return it != _uniformBlockIndices.end() ? &_uniformBlocks[it->second] : nullptr;
+    }
+
+    void OpenGLProgram::setVariantSource(std::uint32_t featureMask, std::uint32_t variantBaseId,
+                                         const VariantProvider& provider)
+    {
+        _featureMask = featureMask;
+        _variantBaseId = variantBaseId;
+        _variantProvider = provider;
+    }
+
+    std::shared_ptr<OpenGLProgram> OpenGLProgram::variant(std::uint32_t featureMask)
+    {
+        if (!_variantProvider)
         {
-            GLint maxLength = 0;
-            GL_CALL(glGetProgramiv(_program, GL_INFO_LOG_LENGTH, &maxLength));
+            return nullptr;
+        }
 
-            std::vector<GLchar> infoLog(maxLength);
-            GL_CALL(glGetProgramInfoLog(_program, maxLength, &maxLength, infoLog.data()));
+        auto it = _variants.find(featureMask);
+        if (it != _variants.end())
+        {
+            return it->second;
+        }
 
-            openGLLogger.debug("Program \"{}\" linking error:\n{}", _name, infoLog.data());
+        std::shared_ptr<OpenGLProgram> program = _variantProvider(featureMask);
 
-            _hasErrors = true;
-            return false;
+        // program can't keep strong reference to itself
+        if (program.get() == this)
+        {
+            return program;
         }
-        _hasErrors = false;
 
-        openGLLogger.debug("Program \"{}\" successfully linked!", _name);
+        _variants[featureMask] = program;
+        return program;
+    }
+
+    const OpenGLUniformBlockInfo* OpenGLProgram::materialDataBlock() const
+    {
+        return findUniformBlock(UniformBlockNames::materialData);
+    }
+
+    void OpenGLProgram::didLink()
+    {
+        reflect();
+        bindUniformBlock(UniformBlockNames::frameData, UniformBlockBinding::frameData);
+        bindUniformBlock(UniformBlockNames::materialData, UniformBlockBinding::materialData);
 
         programLinkedPublisher().publish();
-        return true;
     }
 
-    GLuint OpenGLProgram::createShader(const std::string& code, GLuint shaderType)
+    void OpenGLProgram::reflect()
+    {
+        _uniforms.clear();
+        _uniformBlocks.clear();
+        _uniformIndices.clear();
+        _uniformBlockIndices.clear();
+
+        GLint uniformsCount = 0;
+        GLint maxNameLength = 0;
+        GL_CALL(glGetProgramiv(_program, GL_ACTIVE_UNIFORMS, &uniformsCount));
+        GL_CALL(glGetProgramiv(_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength));
+
+        std::vector<GLchar> nameBuffer(static_cast<std::size_t>(std::max(maxNameLength, 1)));
+
+        std::vector<GLuint> uniformIndices(static_cast<std::size_t>(uniformsCount));
+        for (GLuint uniformIndex = 0; uniformIndex < static_cast<GLuint>(uniformsCount); ++uniformIndex)
+        {
+            uniformIndices[uniformIndex] = uniformIndex;
+        }
+
+        std::vector<GLint> blockIndices(uniformIndices.size(), -1);
+        std::vector<GLint> blockOffsets(uniformIndices.size(), -1);
+        std::vector<GLint> arrayStrides(uniformIndices.size(), 0);
+        std::vector<GLint> matrixStrides(uniformIndices.size(), 0);
+
+        if (uniformsCount > 0)
+        {
+            GL_CALL(glGetActiveUniformsiv(_program, uniformsCount, uniformIndices.data(), GL_UNIFORM_BLOCK_INDEX, blockIndices.data()));
+            GL_CALL(glGetActiveUniformsiv(_program, uniformsCount, uniformIndices.data(), GL_UNIFORM_OFFSET, blockOffsets.data()));
+            GL_CALL(glGetActiveUniformsiv(_program, uniformsCount, uniformIndices.data(), GL_UNIFORM_ARRAY_STRIDE, arrayStrides.data()));
+            GL_CALL(glGetActiveUniformsiv(_program, uniformsCount, uniformIndices.data(), GL_UNIFORM_MATRIX_STRIDE, matrixStrides.data()));
+        }
+
+        GLint nextTextureUnit = 0;
+        GLint maxTextureUnits = 0;
+        GL_CALL(glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxTextureUnits));
+
+        for (GLuint uniformIndex = 0; uniformIndex < static_cast<GLuint>(uniformsCount); ++uniformIndex)
+        {
+            GLsizei nameLength = 0;
+            OpenGLUniformInfo uniform{};
+            GL_CALL(glGetActiveUniform(_program, uniformIndex, static_cast<GLsizei>(nameBuffer.size()), &nameLength,
+                &uniform.size, &uniform.type, nameBuffer.data()));
+
+            uniform.name = std::string(nameBuffer.data(), static_cast<std::size_t>(nameLength));
+            if (uniform.name.ends_with("[0]"))
+            {
+                uniform.name.resize(uniform.name.size() - 3);
+            }
+
+            uniform.nameId = StringId(uniform.name);
+            uniform.blockIndex = blockIndices[uniformIndex];
+
+            // members of uniform blocks don't have locations, they are accessed through the block
+            if (uniform.blockIndex != -1)
+            {
+                uniform.location = -1;
+                uniform.blockOffset = blockOffsets[uniformIndex];
+                uniform.arrayStride = arrayStrides[uniformIndex];
+                uniform.matrixStride = matrixStrides[uniformIndex];
+            }
+            else
+            {
+                uniform.location = glGetUniformLocation(_program, nameBuffer.data());
+            }
+
+            // every sampler gets its own unit once, so materials only have to bind textures
+            if (isSamplerType(uniform.type) && uniform.location != -1)
+            {
+                if (nextTextureUnit + uniform.size <= maxTextureUnits)
+                {
+                    uniform.textureUnit = nextTextureUnit;
+                    nextTextureUnit += uniform.size;
+
+                    OpenGLStateCache::current().useProgram(_program);
+                    for (GLint element = 0; element < uniform.size; ++element)
+                    {
+                        GL_CALL(glUniform1i(uniform.location + element, uniform.textureUnit + element));
+                    }
+                }
+                else
+                {
+                    openGLLogger.warning("Program \"{}\": no free texture unit for sampler \"{}\"", _name, uniform.name);
+                }
+            }
+
+            auto [it, inserted] = _uniformIndices.emplace(uniform.nameId, static_cast<std::uint32_t>(_uniforms.size()));
+            ASSERT(inserted, "Uniform name hash collision");
+            (void)it;
+
+            _uniforms.push_back(uniform);
+        }
+
+        GLint blocksCount = 0;
+        GL_CALL(glGetProgramiv(_program, GL_ACTIVE_UNIFORM_BLOCKS, &blocksCount));
+        GL_CALL(glGetProgramiv(_program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength));
+        nameBuffer.resize(static_cast<std::size_t>(std::max(maxNameLength, 1)));
+
+        for (GLuint blockIndex = 0; blockIndex < static_cast<GLuint>(blocksCount); ++blockIndex)
+        {
+            GLsizei nameLength = 0;
+            GL_CALL(glGetActiveUniformBlockName(_program, blockIndex, static_cast<GLsizei>(nameBuffer.size()),
+                &nameLength, nameBuffer.data()));
+
+            OpenGLUniformBlockInfo block{};
+            block.name = std::string(nameBuffer.data(), static_cast<std::size_t>(nameLength));
+            block.nameId = StringId(block.name);
+            block.index = blockIndex;
+            GL_CALL(glGetActiveUniformBlockiv(_program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize));
+
+            _uniformBlockIndices[block.nameId] = static_cast<std::uint32_t>(_uniformBlocks.size());
+            _uniformBlocks.push_back(block);
+        }
+
+        for (UniformSlot& slot: _uniformSlots)
+        {
+            slot.location = getUniformLocation(slot.nameId);
+        }
+    }
+
+    bool OpenGLProgram::isSamplerType(GLenum type)
     {
+        switch (type)
+        {
+            case GL_SAMPLER_1D:
+            case GL_SAMPLER_2D:
+            case GL_SAMPLER_3D:
+            case GL_SAMPLER_CUBE:
+            case GL_SAMPLER_2D_SHADOW:
+            case GL_SAMPLER_2D_ARRAY:
+            case GL_SAMPLER_2D_ARRAY_SHADOW:
+            case GL_SAMPLER_CUBE_SHADOW:
+            case GL_SAMPLER_2D_MULTISAMPLE:
+            case GL_INT_SAMPLER_2D:
+            case GL_UNSIGNED_INT_SAMPLER_2D:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    void OpenGLProgram::bindUniformBlock(StringId blockName, GLuint bindingPoint)
+    {
+        const OpenGLUniformBlockInfo* block = findUniformBlock(blockName);
+
+        if (block == nullptr)
+        {
+            return;
+        }
+
+        GL_CALL(glUniformBlockBinding(_program, block->index, bindingPoint));
+    }
+
+    GLuint OpenGLProgram::submitShader(const std::string& code, GLuint shaderType)
+    {
+        if (code.empty())
+        {
+            return 0;
+        }
+
         GLuint shader = glCreateShader(shaderType);
 
         const char* sourceCString = code.c_str();
@@ -214,24 +667,30 @@ namespace BGLRenderer
         GL_CALL(glShaderSource(shader, 1, &sourceCString, &sourceLength));
         GL_CALL(glCompileShader(shader));
 
-        GLint isCompiled = 0;
-        GL_CALL(glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled));
+        return shader;
+    }
 
-        if (isCompiled == GL_FALSE)
+    void OpenGLProgram::logShaderErrors(GLuint shader, const char* stageName) const
+    {
+        if (shader == 0)
         {
-            GLint maxLength = 0;
-            GL_CALL(glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength));
+            return;
+        }
 
-            std::vector<GLchar> infoLog(maxLength);
-            GL_CALL(glGetShaderInfoLog(shader, maxLength, &maxLength, infoLog.data()));
+        GLint isCompiled = 0;
+        GL_CALL(glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled));
 
-            openGLLogger.debug("Shader compilation error:\n{}", infoLog.data());
-            glDeleteShader(shader);
-            return 0;
+        if (isCompiled != GL_FALSE)
+        {
+            return;
         }
 
-        openGLLogger.debug("Shader successfully compiled!");
+        GLint maxLength = 0;
+        GL_CALL(glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength));
 
-        return shader;
+        std::vector<GLchar> infoLog(static_cast<std::size_t>(std::max(maxLength, 1)));
+        GL_CALL(glGetShaderInfoLog(shader, maxLength, &maxLength, infoLog.data()));
+
+        openGLLogger.error("{} shader of program \"{}\" compilation error:\n{}", stageName, _name, infoLog.data());
     }
 }
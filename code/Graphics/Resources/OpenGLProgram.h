@@ -1,25 +1,119 @@
 ﻿#pragma once
 
+#include <functional>
+#include <limits>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <Foundation/GLMMath.h>
+#include <Foundation/StringId.h>
 #include <Foundation/Publisher.h>
 
 #include "../OpenGLBase.h"
 
 namespace BGLRenderer
 {
+    /// @brief Active uniform reflected after link, arrays are stored under name without "[0]"
+    struct OpenGLUniformInfo
+    {
+        std::string name;
+        StringId nameId;
+        GLint location;
+        GLenum type;
+        GLint size;
+
+        /// @brief Samplers get fixed texture unit at link, -1 for other types
+        GLint textureUnit = -1;
+
+        /// @brief Block members have no location, they are described by offsets inside the block instead
+        GLint blockIndex = -1;
+        GLint blockOffset = -1;
+        GLint arrayStride = 0;
+        GLint matrixStride = 0;
+    };
+
+    struct OpenGLUniformBlockInfo
+    {
+        std::string name;
+        StringId nameId;
+        GLuint index;
+        GLint dataSize;
+    };
+
+    /// @brief Index of uniform slot inside the program, stays valid after relink (location is resolved again)
+    struct OpenGLUniformHandle
+    {
+        static constexpr std::uint32_t invalidSlot = std::numeric_limits<std::uint32_t>::max();
+
+        std::uint32_t slot = invalidSlot;
+
+        inline bool valid() const { return slot != invalidSlot; }
+    };
+
+    /// @brief Driver specific linked program, only valid for the same GL vendor, renderer and version
+    struct OpenGLProgramBinary
+    {
+        GLenum format = 0;
+        std::vector<std::uint8_t> data;
+    };
+
+    enum class OpenGLProgramState
+    {
+        /// @brief First link was submitted and the driver hasn't finished it yet
+        pending,
+        ready,
+        /// @brief First link failed, program stays unusable until hot reload fixes it
+        failed
+    };
+
+    class OpenGLProgram;
+    using OpenGLProgramHandle = Handle<OpenGLProgram>;
+
     class OpenGLProgram
     {
     public:
+        /// @brief Only submits compilation and link, program is pending until pollLink or finishLink completes it
         OpenGLProgram(const std::string& name,
                       const std::string& vertexShaderCode,
                       const std::string& fragmentShaderCode);
+
+        /// @brief Separable program with only one stage (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER),
+        /// stages are combined by OpenGLProgramPipeline
+        OpenGLProgram(const std::string& name, GLenum separableStage, const std::string& shaderCode);
+
+        /// @brief Tries to create program from binary, submits given source when driver rejects it
+        OpenGLProgram(const std::string& name,
+                      const std::string& vertexShaderCode,
+                      const std::string& fragmentShaderCode,
+                      const OpenGLProgramBinary& binary);
         ~OpenGLProgram();
 
-        bool tryToUpdateVertexShader(const std::string& shaderCode);
-        bool tryToUpdateFragmentShader(const std::string& shaderCode);
+        /// @brief Requires GL 4.1 or ARB_get_program_binary and at least one binary format
+        static bool binariesSupported();
+
+        /// @brief Reads linked program binary, returns false if program has errors or binaries are not supported
+        bool getBinary(OpenGLProgramBinary& binary) const;
+
+        inline bool loadedFromBinary() const { return _loadedFromBinary; }
+
+        /// @brief GL 4.6 KHR_parallel_shader_compile or ARB variant, without it completion can't be polled
+        /// and the first status query blocks until the driver is done
+        static bool parallelCompileSupported();
+
+        /// @brief Completes submitted link if the driver is done with it, never blocks when parallel compile
+        /// is supported. Returns true when nothing is pending anymore
+        bool pollLink();
 
+        /// @brief Blocks until submitted link is done and completes it
+        void finishLink();
+
+        /// @brief Submits relink with new sources, current version is used until the new link completes successfully.
+        /// Returns false when both sources are the same as the linked (or pending) ones
+        bool tryToUpdateShaders(const std::string& vertexShaderCode, const std::string& fragmentShaderCode);
+
+        /// @brief Binding pending program finishes its link first
         void bind();
 
         void setInt(GLint location, GLint value);
@@ -29,54 +123,183 @@ namespace BGLRenderer
         void setVector4(GLint location, const glm::vec4& value);
         void setMatrix4x4(GLint location, const glm::mat4x4& value);
 
-        GLint getUniformLocation(const std::string& name);
+        /// @brief Looks up reflection table, doesn't call the driver. Returns -1 for inactive uniforms
+        GLint getUniformLocation(StringId name) const;
+
+        /// @brief Block bound to UniformBlockBinding::materialData, nullptr if program doesn't declare it
+        const OpenGLUniformBlockInfo* materialDataBlock() const;
+
+        /// @brief Returns handle for the name, the same name always gets the same handle
+        OpenGLUniformHandle uniformHandle(StringId name);
+
+        inline GLint uniformLocation(OpenGLUniformHandle handle) const
+        {
+            return handle.valid() ? _uniformSlots[handle.slot].location : -1;
+        }
+
+        const OpenGLUniformInfo* findUniform(StringId name) const;
+        const OpenGLUniformBlockInfo* findUniformBlock(StringId name) const;
+
+        inline const std::vector<OpenGLUniformInfo>& uniforms() const { return _uniforms; }
+        inline const std::vector<OpenGLUniformBlockInfo>& uniformBlocks() const { return _uniformBlocks; }
 
-        inline void setInt(const std::string& name, GLint value) { setInt(getUniformLocation(name), value); }
-        inline void setFloat(const std::string& name, GLfloat value) { setFloat(getUniformLocation(name), value); }
+        inline void setInt(StringId name, GLint value) { setInt(getUniformLocation(name), value); }
+        inline void setFloat(StringId name, GLfloat value) { setFloat(getUniformLocation(name), value); }
 
-        inline void setVector2(const std::string& name, const glm::vec2& value)
+        inline void setVector2(StringId name, const glm::vec2& value)
         {
             setVector2(getUniformLocation(name), value);
         }
 
-        inline void setVector3(const std::string& name, const glm::vec3& value)
+        inline void setVector3(StringId name, const glm::vec3& value)
         {
             setVector3(getUniformLocation(name), value);
         }
 
-        inline void setVector4(const std::string& name, const glm::vec4& value)
+        inline void setVector4(StringId name, const glm::vec4& value)
         {
             setVector4(getUniformLocation(name), value);
         }
 
-        inline void setMatrix4x4(const std::string& name, const glm::mat4& value)
+        inline void setMatrix4x4(StringId name, const glm::mat4& value)
         {
             setMatrix4x4(getUniformLocation(name), value);
         }
 
+        inline void setInt(OpenGLUniformHandle handle, GLint value) { setInt(uniformLocation(handle), value); }
+        inline void setFloat(OpenGLUniformHandle handle, GLfloat value) { setFloat(uniformLocation(handle), value); }
+
+        inline void setVector2(OpenGLUniformHandle handle, const glm::vec2& value)
+        {
+            setVector2(uniformLocation(handle), value);
+        }
+
+        inline void setVector3(OpenGLUniformHandle handle, const glm::vec3& value)
+        {
+            setVector3(uniformLocation(handle), value);
+        }
+
+        inline void setVector4(OpenGLUniformHandle handle, const glm::vec4& value)
+        {
+            setVector4(uniformLocation(handle), value);
+        }
+
+        inline void setMatrix4x4(OpenGLUniformHandle handle, const glm::mat4& value)
+        {
+            setMatrix4x4(uniformLocation(handle), value);
+        }
+
         inline const std::string& name() const { return _name; }
+        inline std::uint32_t uniqueId() const { return _uniqueId; }
+        inline OpenGLProgramHandle handle() const { return _handle; }
+
+        /// @brief Program object changes after every hot reload, listen to programLinkedPublisher to follow it
+        inline GLuint id() const { return _program; }
+
+        /// @brief Stage of separable program, 0 for programs with both stages linked together
+        inline GLenum separableStage() const { return _separableStage; }
+        inline bool isSeparable() const { return _separableStage != 0; }
         inline PublisherEmpty& programLinkedPublisher() { return _programLinkedPublisher; }
 
-        inline bool hasErrors() const { return _hasErrors; }
+        inline OpenGLProgramState state() const { return _state; }
+        inline bool isReady() const { return _state == OpenGLProgramState::ready; }
+        inline bool hasErrors() const { return _state == OpenGLProgramState::failed; }
+
+        /// @brief True also for ready programs which wait for relink after hot reload
+        inline bool hasPendingLink() const { return _pendingLink.program != 0; }
 
         inline const std::string& vertexShaderCode() const { return _vertexShaderCode; }
         inline const std::string& fragmentShaderCode() const { return _fragmentShaderCode; }
 
+        using VariantProvider = std::function<std::shared_ptr<OpenGLProgram>(std::uint32_t featureMask)>;
+
+        /// @brief Set by the loader, variants are programs built from the same shaders with different ShaderFeature defines
+        void setVariantSource(std::uint32_t featureMask, std::uint32_t variantBaseId, const VariantProvider& provider);
+
+        /// @brief Returns variant with given feature mask, nullptr if program wasn't created by the loader.
+        /// Results are cached, so it can be called per draw
+        std::shared_ptr<OpenGLProgram> variant(std::uint32_t featureMask);
+
+        inline std::uint32_t featureMask() const { return _featureMask; }
+
+        /// @brief Unique id of the variant without features, the same for every variant of given shaders
+        inline std::uint32_t variantBaseId() const { return _variantBaseId; }
+
     private:
         std::string _name;
-        GLuint _program;
-        GLuint _fragmentShader;
-        GLuint _vertexShader;
+        std::uint32_t _uniqueId;
+        OpenGLProgramHandle _handle;
+        GLuint _program = 0;
+        GLuint _fragmentShader = 0;
+        GLuint _vertexShader = 0;
+        GLenum _separableStage = 0;
+
+        /// @brief Link runs on separate program object, so the linked one stays usable while the driver works
+        struct PendingLink
+        {
+            GLuint program = 0;
+            GLuint vertexShader = 0;
+            GLuint fragmentShader = 0;
+            std::string vertexShaderCode;
+            std::string fragmentShaderCode;
+        };
+
+        PendingLink _pendingLink{};
+
+        bool _loadedFromBinary = false;
 
         std::string _vertexShaderCode;
         std::string _fragmentShaderCode;
 
         PublisherEmpty _programLinkedPublisher{};
 
-        bool _hasErrors = true;
+        std::uint32_t _featureMask = 0;
+        std::uint32_t _variantBaseId = _uniqueId;
+        VariantProvider _variantProvider;
+        std::unordered_map<std::uint32_t, std::shared_ptr<OpenGLProgram>> _variants;
+
+        OpenGLProgramState _state = OpenGLProgramState::pending;
+
+        // rebuilt after every successful link
+        std::vector<OpenGLUniformInfo> _uniforms;
+        std::vector<OpenGLUniformBlockInfo> _uniformBlocks;
+        std::unordered_map<StringId, std::uint32_t> _uniformIndices;
+        std::unordered_map<StringId, std::uint32_t> _uniformBlockIndices;
+
+        struct UniformSlot
+        {
+            StringId nameId;
+            GLint location;
+        };
+
+        // slots are never removed, so handles survive relinks
+        std::vector<UniformSlot> _uniformSlots;
+        std::unordered_map<StringId, std::uint32_t> _uniformSlotIndices;
+
+        /// @brief Compiles and links new program object without waiting, replaces pending link if there is one.
+        /// Shader objects of current program are reused for stages with unchanged source
+        void submitLink(const std::string& vertexShaderCode, const std::string& fragmentShaderCode);
+        void cancelPendingLink();
+
+        /// @brief Deletes shaders of pending link which current program doesn't use
+        void deletePendingShaders(const PendingLink& pending);
+
+        bool loadBinary(GLuint program, const OpenGLProgramBinary& binary);
+
+        /// @brief Refreshes reflection and block bindings after successful link or binary load
+        void didLink();
+
+        /// @brief Reads active uniforms and blocks into lookup tables and resolves slots again
+        void reflect();
+
+        static bool isSamplerType(GLenum type);
 
-        bool link();
+        /// @brief Assigns block to the binding point if program uses it, binding is lost after every relink
+        void bindUniformBlock(StringId blockName, GLuint bindingPoint);
 
-        GLuint createShader(const std::string& code, GLuint shaderType);
+        /// @brief Only submits compilation, errors are reported after link by logShaderErrors.
+        /// Empty code creates no shader, separable programs have only one stage
+        static GLuint submitShader(const std::string& code, GLuint shaderType);
+        void logShaderErrors(GLuint shader, const char* stageName) const;
     };
 }
@@ -0,0 +1,208 @@
+﻿#include "OpenGLProgramPipeline.h"
+
+#include "../OpenGLDeletionQueue.h"
+#include "../OpenGLStateCache.h"
+
+#include <gtc/type_ptr.hpp>
+
+namespace BGLRenderer
+{
+    OpenGLProgramPipeline::OpenGLProgramPipeline(const std::string& name,
+                                                 const std::shared_ptr<OpenGLProgram>& vertexStage,
+                                                 const std::shared_ptr<OpenGLProgram>& fragmentStage) :
+        _name(name),
+        _vertexStage(vertexStage)
+    {
+        ASSERT(supported(), "Separable programs are not supported");
+        ASSERT(vertexStage != nullptr && vertexStage->separableStage() == GL_VERTEX_SHADER,
+               "Pipeline requires separable vertex stage");
+
+        GL_CALL(glGenProgramPipelines(1, &_pipeline));
+        ASSERT(_pipeline != 0, "Failed to create opengl program pipeline");
+
+        _vertexStageLinkedHandle = _vertexStage->programLinkedPublisher().listen([&] { _stagesDirty = true; });
+
+        setFragmentStage(fragmentStage);
+    }
+
+    OpenGLProgramPipeline::OpenGLProgramPipeline(const std::string& name, const std::shared_ptr<OpenGLProgram>& program) :
+        _name(name),
+        _program(program)
+    {
+        ASSERT(program != nullptr, "Pipeline requires program");
+    }
+
+    OpenGLProgramPipeline::~OpenGLProgramPipeline()
+    {
+        if (_vertexStage != nullptr)
+        {
+            _vertexStage->programLinkedPublisher().removeListener(_vertexStageLinkedHandle);
+        }
+
+        if (_fragmentStage != nullptr)
+        {
+            _fragmentStage->programLinkedPublisher().removeListener(_fragmentStageLinkedHandle);
+        }
+
+        OpenGLDeletionQueue::global().deleteObject(OpenGLObjectType::programPipeline, _pipeline);
+    }
+
+    bool OpenGLProgramPipeline::supported()
+    {
+        return GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_separate_shader_objects;
+    }
+
+    void OpenGLProgramPipeline::setFragmentStage(const std::shared_ptr<OpenGLProgram>& fragmentStage)
+    {
+        ASSERT(isSeparable(), "Only separable pipelines can swap stages");
+        ASSERT(fragmentStage != nullptr && fragmentStage->separableStage() == GL_FRAGMENT_SHADER,
+               "Pipeline requires separable fragment stage");
+
+        if (_fragmentStage == fragmentStage)
+        {
+            return;
+        }
+
+        if (_fragmentStage != nullptr)
+        {
+            _fragmentStage->programLinkedPublisher().removeListener(_fragmentStageLinkedHandle);
+        }
+
+        _fragmentStage = fragmentStage;
+        _fragmentStageLinkedHandle = _fragmentStage->programLinkedPublisher().listen([&] { _stagesDirty = true; });
+        _stagesDirty = true;
+    }
+
+    bool OpenGLProgramPipeline::isReady() const
+    {
+        if (!isSeparable())
+        {
+            return _program->isReady();
+        }
+
+        return _vertexStage->isReady() && _fragmentStage->isReady();
+    }
+
+    void OpenGLProgramPipeline::bind()
+    {
+        if (!isSeparable())
+        {
+            _program->bind();
+            return;
+        }
+
+        // stages are never bound on their own, so pending links have to be finished here
+        for (OpenGLProgram* stage: {_vertexStage.get(), _fragmentStage.get()})
+        {
+            if (stage->state() == OpenGLProgramState::pending)
+            {
+                stage->finishLink();
+            }
+        }
+
+        if (_stagesDirty)
+        {
+            useStages();
+        }
+
+        OpenGLStateCache::current().bindProgramPipeline(_pipeline);
+    }
+
+    void OpenGLProgramPipeline::useStages()
+    {
+        _stagesDirty = false;
+
+        GL_CALL(glUseProgramStages(_pipeline, GL_VERTEX_SHADER_BIT, _vertexStage->id()));
+        GL_CALL(glUseProgramStages(_pipeline, GL_FRAGMENT_SHADER_BIT, _fragmentStage->id()));
+    }
+
+    GLuint OpenGLProgramPipeline::findUniformStage(StringId name, GLint& location) const
+    {
+        location = _fragmentStage->getUniformLocation(name);
+        if (location != -1)
+        {
+            return _fragmentStage->id();
+        }
+
+        location = _vertexStage->getUniformLocation(name);
+        return _vertexStage->id();
+    }
+
+    void OpenGLProgramPipeline::setInt(StringId name, GLint value)
+    {
+        if (!isSeparable())
+        {
+            _program->setInt(name, value);
+            return;
+        }
+
+        GLint location = -1;
+        GLuint stage = findUniformStage(name, location);
+        glProgramUniform1i(stage, location, value);
+    }
+
+    void OpenGLProgramPipeline::setFloat(StringId name, GLfloat value)
+    {
+        if (!isSeparable())
+        {
+            _program->setFloat(name, value);
+            return;
+        }
+
+        GLint location = -1;
+        GLuint stage = findUniformStage(name, location);
+        glProgramUniform1f(stage, location, value);
+    }
+
+    void OpenGLProgramPipeline::setVector2(StringId name, const glm::vec2& value)
+    {
+        if (!isSeparable())
+        {
+            _program->setVector2(name, value);
+            return;
+        }
+
+        GLint location = -1;
+        GLuint stage = findUniformStage(name, location);
+        glProgramUniform2f(stage, location, value.x, value.y);
+    }
+
+    void OpenGLProgramPipeline::setVector3(StringId name, const glm::vec3& value)
+    {
+        if (!isSeparable())
+        {
+            _program->setVector3(name, value);
+            return;
+        }
+
+        GLint location = -1;
+        GLuint stage = findUniformStage(name, location);
+        glProgramUniform3f(stage, location, value.x, value.y, value.z);
+    }
+
+    void OpenGLProgramPipeline::setVector4(StringId name, const glm::vec4& value)
+    {
+        if (!isSeparable())
+        {
+            _program->setVector4(name, value);
+            return;
+        }
+
+        GLint location = -1;
+        GLuint stage = findUniformStage(name, location);
+        glProgramUniform4f(stage, location, value.x, value.y, value.z, value.w);
+    }
+
+    void OpenGLProgramPipeline::setMatrix4x4(StringId name, const glm::mat4& value)
+    {
+        if (!isSeparable())
+        {
+            _program->setMatrix4x4(name, value);
+            return;
+        }
+
+        GLint location = -1;
+        GLuint stage = findUniformStage(name, location);
+        glProgramUniformMatrix4fv(stage, location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+}
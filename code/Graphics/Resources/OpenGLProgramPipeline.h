@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#include "OpenGLProgram.h"
+
+#include <memory>
+#include <string>
+
+namespace BGLRenderer
+{
+    /// @brief Vertex and fragment stage combined at bind time, stages are separable programs shared between pipelines.
+    /// Without separable programs support the pipeline wraps regular program linked from both stages
+    class OpenGLProgramPipeline
+    {
+    public:
+        OpenGLProgramPipeline(const std::string& name,
+                              const std::shared_ptr<OpenGLProgram>& vertexStage,
+                              const std::shared_ptr<OpenGLProgram>& fragmentStage);
+
+        /// @brief Fallback used when separable programs are not supported
+        OpenGLProgramPipeline(const std::string& name, const std::shared_ptr<OpenGLProgram>& program);
+        ~OpenGLProgramPipeline();
+
+        /// @brief Requires GL 4.1 or ARB_separate_shader_objects
+        static bool supported();
+
+        /// @brief Finishes pending stages, program pipeline is used only while no program is current
+        void bind();
+
+        /// @brief Swaps only the fragment stage, vertex stage stays attached. Only for separable pipelines
+        void setFragmentStage(const std::shared_ptr<OpenGLProgram>& fragmentStage);
+
+        bool isReady() const;
+
+        /// @brief Uniforms are looked up in the fragment stage first, values are written directly to the owning stage
+        void setInt(StringId name, GLint value);
+        void setFloat(StringId name, GLfloat value);
+        void setVector2(StringId name, const glm::vec2& value);
+        void setVector3(StringId name, const glm::vec3& value);
+        void setVector4(StringId name, const glm::vec4& value);
+        void setMatrix4x4(StringId name, const glm::mat4& value);
+
+        inline const std::string& name() const { return _name; }
+        inline bool isSeparable() const { return _program == nullptr; }
+
+        inline const std::shared_ptr<OpenGLProgram>& vertexStage() const { return _vertexStage; }
+        inline const std::shared_ptr<OpenGLProgram>& fragmentStage() const { return _fragmentStage; }
+
+    private:
+        std::string _name;
+        GLuint _pipeline = 0;
+
+        std::shared_ptr<OpenGLProgram> _program;
+        std::shared_ptr<OpenGLProgram> _vertexStage;
+        std::shared_ptr<OpenGLProgram> _fragmentStage;
+
+        PublisherEmpty::ListenerHandle _vertexStageLinkedHandle = PublisherEmpty::listenerHandleInvalid;
+        PublisherEmpty::ListenerHandle _fragmentStageLinkedHandle = PublisherEmpty::listenerHandleInvalid;
+
+        // relinked stages are new program objects, so they have to be attached again
+        bool _stagesDirty = true;
+
+        /// @brief Returns stage with active uniform, location is written to the second parameter
+        GLuint findUniformStage(StringId name, GLint& location) const;
+
+        void useStages();
+    };
+}
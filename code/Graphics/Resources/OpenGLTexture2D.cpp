@@ -1,10 +1,14 @@
 ﻿#include "OpenGLTexture2D.h"
 
+#include "../OpenGLDeletionQueue.h"
+#include "../OpenGLStateCache.h"
+
 namespace BGLRenderer
 {
     OpenGLTexture2D::OpenGLTexture2D(const std::string& name, GLuint width, GLuint height, GLenum format,
                                      WrapMode wrapMode, FilterMode filterMode) :
         _name(name),
+        _handle(HandlePool<OpenGLTexture2D>::global().add(this)),
         _width(width),
         _height(height),
         _format(format),
@@ -12,14 +16,15 @@ namespace BGLRenderer
         _filterMode(filterMode)
     {
         GL_CALL(glGenTextures(1, &_id));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, _id));
+        OpenGLStateCache::current().bindTexture(GL_TEXTURE_2D, _id);
         updateTextureParametersNoBinding();
         generatePixelsBuffer();
     }
 
     OpenGLTexture2D::~OpenGLTexture2D()
     {
-        GL_CALL(glDeleteTextures(1, &_id));
+        HandlePool<OpenGLTexture2D>::global().remove(_handle);
+        OpenGLDeletionQueue::global().deleteObject(OpenGLObjectType::texture, _id);
     }
 
     void OpenGLTexture2D::resize(GLuint width, GLuint height)
@@ -34,19 +39,19 @@ namespace BGLRenderer
 
     void OpenGLTexture2D::setPixels(GLuint format, GLbyte* pixels)
     {
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, _id));
+        OpenGLStateCache::current().bindTexture(GL_TEXTURE_2D, _id);
         GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, _format, _width, _height, 0, format, GL_BYTE, pixels));
     }
 
     void OpenGLTexture2D::setPixels(GLuint format, GLubyte* pixels)
     {
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, _id));
+        OpenGLStateCache::current().bindTexture(GL_TEXTURE_2D, _id);
         GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, _format, _width, _height, 0, format, GL_UNSIGNED_BYTE, pixels));
     }
 
     void OpenGLTexture2D::setPixels(GLuint format, GLfloat* pixels)
     {
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, _id));
+        OpenGLStateCache::current().bindTexture(GL_TEXTURE_2D, _id);
         GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, _format, _width, _height, 0, format, GL_FLOAT, pixels));
     }
 
@@ -63,14 +68,12 @@ namespace BGLRenderer
     {
         _bindSlot = slot;
 
-        GL_CALL(glActiveTexture(GL_TEXTURE0 + slot));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, _id));
+        OpenGLStateCache::current().bindTexture(GL_TEXTURE_2D, _id, static_cast<GLuint>(slot));
     }
 
     void OpenGLTexture2D::unbind()
     {
-        GL_CALL(glActiveTexture(GL_TEXTURE0 + _bindSlot));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+        OpenGLStateCache::current().bindTexture(GL_TEXTURE_2D, 0, static_cast<GLuint>(_bindSlot));
     }
 
     void OpenGLTexture2D::setWrapMode(WrapMode wrapMode)
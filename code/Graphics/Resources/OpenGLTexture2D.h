@@ -16,6 +16,9 @@ namespace BGLRenderer
         clampToEdge
     };
     
+    class OpenGLTexture2D;
+    using OpenGLTexture2DHandle = Handle<OpenGLTexture2D>;
+
     class OpenGLTexture2D
     {
     public:
@@ -39,6 +42,7 @@ namespace BGLRenderer
         void generateMipmaps(int max = -1);
 
         inline GLuint id() { return _id; }
+        inline OpenGLTexture2DHandle handle() const { return _handle; }
 
         inline const std::string& name() const { return _name; }
 
@@ -46,6 +50,7 @@ namespace BGLRenderer
 
     private:
         std::string _name;
+        OpenGLTexture2DHandle _handle;
         GLuint _id;
         GLuint _width;
         GLuint _height;
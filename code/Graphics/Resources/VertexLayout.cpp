@@ -0,0 +1,280 @@
+﻿#include "VertexLayout.h"
+
+#include <../../lib/glm/gtc/packing.hpp>
+
+#include <cmath>
+#include <cstring>
+
+namespace BGLRenderer
+{
+    static glm::vec3 quantizationScale(const BoundingBox& bounds)
+    {
+        glm::vec3 extents = bounds.extents();
+
+        // flat meshes (e.g. planes) would divide by zero
+        return glm::vec3(extents.x > 1e-6f ? extents.x : 1.0f,
+                         extents.y > 1e-6f ? extents.y : 1.0f,
+                         extents.z > 1e-6f ? extents.z : 1.0f);
+    }
+
+    static GLshort packSnorm16(float value)
+    {
+        return static_cast<GLshort>(std::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    VertexDecodeParameters VertexDecodeParameters::forLayout(const VertexLayout& layout,
+                                                             const BoundingBox& positionBounds)
+    {
+        VertexDecodeParameters parameters{};
+
+        const VertexAttributeFormat* position = layout.find(VertexAttributeLocation::position);
+        if (position != nullptr && position->type != GL_FLOAT)
+        {
+            parameters.positionOffset = positionBounds.center();
+            parameters.positionScale = quantizationScale(positionBounds);
+        }
+
+        const VertexAttributeFormat* normal = layout.find(VertexAttributeLocation::normal);
+        parameters.octahedralNormals = normal != nullptr && normal->components == 2;
+
+        return parameters;
+    }
+
+    VertexLayout& VertexLayout::add(GLuint location, GLint components, GLenum type, bool normalized)
+    {
+        ASSERT(location < VertexAttributeLocation::count, "Unknown vertex attribute location");
+        ASSERT(!has(location), "Vertex attribute is already part of the layout");
+
+        VertexAttributeFormat attribute{};
+        attribute.location = location;
+        attribute.components = components;
+        attribute.type = type;
+        attribute.normalized = normalized ? GL_TRUE : GL_FALSE;
+        attribute.offset = static_cast<GLuint>(_stride);
+
+        _attributes.push_back(attribute);
+        _stride += static_cast<GLsizei>(vertexAttributeSize(type, components));
+
+        return *this;
+    }
+
+    void VertexLayout::apply() const
+    {
+        for (GLuint location = 0; location < VertexAttributeLocation::count; ++location)
+        {
+            const VertexAttributeFormat* attribute = find(location);
+            if (attribute == nullptr)
+            {
+                GL_CALL(glDisableVertexAttribArray(location));
+                continue;
+            }
+
+            GL_CALL(glEnableVertexAttribArray(location));
+            GL_CALL(glVertexAttribPointer(location, attribute->components, attribute->type, attribute->normalized,
+                _stride, reinterpret_cast<const void*>(static_cast<std::uintptr_t>(attribute->offset))));
+        }
+    }
+
+    std::vector<std::uint8_t> VertexLayout::interleave(const VertexStreams& streams, std::size_t vertexCount,
+                                                       const BoundingBox& positionBounds) const
+    {
+        std::vector<std::uint8_t> result(vertexCount * _stride);
+
+        const glm::vec3 positionOffset = positionBounds.center();
+        const glm::vec3 positionScale = quantizationScale(positionBounds);
+
+        for (const VertexAttributeFormat& attribute: _attributes)
+        {
+            const GLfloat* source = nullptr;
+            GLint sourceComponents = 3;
+
+            switch (attribute.location)
+            {
+                case VertexAttributeLocation::position:
+                    source = streams.positions;
+                    break;
+                case VertexAttributeLocation::normal:
+                    source = streams.normals;
+                    break;
+                case VertexAttributeLocation::tangent:
+                    source = streams.tangents;
+                    break;
+                case VertexAttributeLocation::uv0:
+                    source = streams.uvs0;
+                    sourceComponents = 2;
+                    break;
+                default:
+                    break;
+            }
+
+            // missing streams stay zeroed
+            if (source == nullptr)
+            {
+                continue;
+            }
+
+            for (std::size_t vertex = 0; vertex < vertexCount; ++vertex)
+            {
+                const GLfloat* value = source + vertex * sourceComponents;
+                std::uint8_t* target = result.data() + vertex * _stride + attribute.offset;
+
+                if (attribute.type == GL_FLOAT)
+                {
+                    std::memcpy(target, value, sizeof(GLfloat) * attribute.components);
+                }
+                else if (attribute.type == GL_HALF_FLOAT)
+                {
+                    for (GLint component = 0; component < attribute.components; ++component)
+                    {
+                        GLhalf half = glm::packHalf1x16(value[component]);
+                        std::memcpy(target + component * sizeof(GLhalf), &half, sizeof(GLhalf));
+                    }
+                }
+                else if (attribute.type == GL_SHORT && attribute.location == VertexAttributeLocation::position)
+                {
+                    glm::vec3 normalized = (glm::vec3(value[0], value[1], value[2]) - positionOffset) / positionScale;
+                    GLshort packed[4] = {packSnorm16(normalized.x), packSnorm16(normalized.y),
+                                         packSnorm16(normalized.z), 0};
+                    std::memcpy(target, packed, sizeof(GLshort) * attribute.components);
+                }
+                else if (attribute.type == GL_SHORT && attribute.components == 2)
+                {
+                    glm::vec2 encoded = octahedralEncode(glm::vec3(value[0], value[1], value[2]));
+                    GLshort packed[2] = {packSnorm16(encoded.x), packSnorm16(encoded.y)};
+                    std::memcpy(target, packed, sizeof(packed));
+                }
+                else
+                {
+                    ASSERT(false, "Unsupported vertex attribute encoding");
+                }
+            }
+        }
+
+        return result;
+    }
+
+    VertexLayout VertexLayout::compressed() const
+    {
+        VertexLayout layout;
+
+        for (const VertexAttributeFormat& attribute: _attributes)
+        {
+            switch (attribute.location)
+            {
+                case VertexAttributeLocation::position:
+                    // 4th component keeps attribute 4 bytes aligned
+                    layout.add(attribute.location, 4, GL_SHORT, true);
+                    break;
+                case VertexAttributeLocation::normal:
+                case VertexAttributeLocation::tangent:
+                    layout.add(attribute.location, 2, GL_SHORT, true);
+                    break;
+                case VertexAttributeLocation::uv0:
+                    layout.add(attribute.location, 2, GL_HALF_FLOAT);
+                    break;
+                default:
+                    layout.add(attribute.location, attribute.components, attribute.type, attribute.normalized);
+                    break;
+            }
+        }
+
+        return layout;
+    }
+
+    bool VertexLayout::isCompressed() const
+    {
+        for (const VertexAttributeFormat& attribute: _attributes)
+        {
+            if (attribute.type != GL_FLOAT)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    const VertexAttributeFormat* VertexLayout::find(GLuint location) const
+    {
+        for (const VertexAttributeFormat& attribute: _attributes)
+        {
+            if (attribute.location == location)
+            {
+                return &attribute;
+            }
+        }
+
+        return nullptr;
+    }
+
+    VertexLayout VertexLayout::standard()
+    {
+        VertexLayout layout;
+        layout.add(VertexAttributeLocation::position, 3, GL_FLOAT)
+              .add(VertexAttributeLocation::normal, 3, GL_FLOAT)
+              .add(VertexAttributeLocation::tangent, 3, GL_FLOAT)
+              .add(VertexAttributeLocation::uv0, 2, GL_FLOAT);
+
+        return layout;
+    }
+
+    VertexLayout VertexLayout::positionNormal()
+    {
+        VertexLayout layout;
+        layout.add(VertexAttributeLocation::position, 3, GL_FLOAT)
+              .add(VertexAttributeLocation::normal, 3, GL_FLOAT);
+
+        return layout;
+    }
+
+    VertexLayout VertexLayout::position()
+    {
+        VertexLayout layout;
+        layout.add(VertexAttributeLocation::position, 3, GL_FLOAT);
+
+        return layout;
+    }
+
+    glm::vec2 octahedralEncode(const glm::vec3& direction)
+    {
+        glm::vec3 n = direction / (std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z));
+
+        glm::vec2 encoded(n.x, n.y);
+        if (n.z < 0.0f)
+        {
+            encoded = glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                                (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+        }
+
+        return encoded;
+    }
+
+    GLuint vertexAttributeSize(GLenum type, GLint components)
+    {
+        const GLuint count = static_cast<GLuint>(components);
+
+        switch (type)
+        {
+            case GL_FLOAT:
+                return sizeof(GLfloat) * count;
+            case GL_HALF_FLOAT:
+                return sizeof(GLhalf) * count;
+            case GL_SHORT:
+            case GL_UNSIGNED_SHORT:
+                return sizeof(GLshort) * count;
+            case GL_BYTE:
+            case GL_UNSIGNED_BYTE:
+                return sizeof(GLbyte) * count;
+            case GL_INT:
+            case GL_UNSIGNED_INT:
+                return sizeof(GLint) * count;
+            // packed formats store all 4 components in single 32-bit value
+            case GL_INT_2_10_10_10_REV:
+            case GL_UNSIGNED_INT_2_10_10_10_REV:
+                return sizeof(GLuint);
+            default:
+                ASSERT(false, "Unsupported vertex attribute type");
+                return 0;
+        }
+    }
+}
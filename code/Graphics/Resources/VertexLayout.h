@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include "../OpenGLBase.h"
+#include "../Bounds.h"
+
+#include <Foundation/GLMMath.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace BGLRenderer
+{
+    /// @brief Attribute locations shared by every mesh vertex shader
+    namespace VertexAttributeLocation
+    {
+        static constexpr GLuint position = 0;
+        static constexpr GLuint normal = 1;
+        static constexpr GLuint tangent = 2;
+        static constexpr GLuint uv0 = 3;
+
+        static constexpr GLuint count = 4;
+    }
+
+    struct VertexAttributeFormat
+    {
+        GLuint location;
+        GLint components;
+        GLenum type;
+        GLboolean normalized;
+        GLuint offset;
+
+        bool operator==(const VertexAttributeFormat& other) const = default;
+    };
+
+    /// @brief Float vertex with every attribute, matches VertexLayout::standard()
+    struct StandardVertex
+    {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec3 tangent;
+        glm::vec2 uv0;
+    };
+
+    /// @brief Non interleaved float streams used as source for interleaving, missing streams can be nullptr
+    struct VertexStreams
+    {
+        const GLfloat* positions = nullptr; // xyz
+        const GLfloat* normals = nullptr; // xyz
+        const GLfloat* tangents = nullptr; // xyz
+        const GLfloat* uvs0 = nullptr; // uv
+    };
+
+    class VertexLayout;
+
+    /// @brief Values required by vertex shaders to decode compressed attributes, see vertex_decode.glsl
+    struct VertexDecodeParameters
+    {
+        glm::vec3 positionOffset = glm::vec3(0.0f);
+        glm::vec3 positionScale = glm::vec3(1.0f);
+        bool octahedralNormals = false;
+
+        static VertexDecodeParameters forLayout(const VertexLayout& layout, const BoundingBox& positionBounds);
+    };
+
+    /// @brief Describes attributes stored in single interleaved vertex buffer
+    class VertexLayout
+    {
+    public:
+        VertexLayout& add(GLuint location, GLint components, GLenum type, bool normalized = false);
+
+        /// @brief Sets attribute pointers of currently bound vertex array to currently bound GL_ARRAY_BUFFER,
+        /// attributes which are not part of the layout are disabled
+        void apply() const;
+
+        /// @brief Packs float streams into interleaved buffer following this layout, compressed attributes are encoded
+        /// (positions are quantized relative to the given bounds)
+        std::vector<std::uint8_t> interleave(const VertexStreams& streams, std::size_t vertexCount,
+                                             const BoundingBox& positionBounds = {}) const;
+
+        /// @brief Returns layout with the same attributes in compressed formats:
+        /// snorm16 positions relative to mesh bounds, octahedral snorm16 normals and tangents, half float uvs
+        VertexLayout compressed() const;
+
+        /// @brief True when at least one attribute is not stored as float
+        bool isCompressed() const;
+
+        const VertexAttributeFormat* find(GLuint location) const;
+        inline bool has(GLuint location) const { return find(location) != nullptr; }
+
+        inline const std::vector<VertexAttributeFormat>& attributes() const { return _attributes; }
+        inline GLsizei stride() const { return _stride; }
+        inline bool empty() const { return _attributes.empty(); }
+
+        bool operator==(const VertexLayout& other) const = default;
+
+        /// @brief Position, normal, tangent and uv0 as floats
+        static VertexLayout standard();
+
+        /// @brief Position and normal as floats, e.g. for gizmos
+        static VertexLayout positionNormal();
+
+        static VertexLayout position();
+
+    private:
+        std::vector<VertexAttributeFormat> _attributes;
+        GLsizei _stride = 0;
+    };
+
+    /// @brief Encodes unit vector with octahedral mapping into [-1, 1] range
+    glm::vec2 octahedralEncode(const glm::vec3& direction);
+
+    /// @brief Size in bytes of single attribute value
+    GLuint vertexAttributeSize(GLenum type, GLint components);
+}
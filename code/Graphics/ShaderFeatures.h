@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace BGLRenderer
+{
+    /// @brief Bits of program feature mask, every set bit adds its define to both shader stages
+    namespace ShaderFeature
+    {
+        static constexpr std::uint32_t baseColorMap = 1u << 0;
+        static constexpr std::uint32_t normalMap = 1u << 1;
+        static constexpr std::uint32_t roughnessMap = 1u << 2;
+        static constexpr std::uint32_t metallicMap = 1u << 3;
+        static constexpr std::uint32_t roughnessMetallicMap = 1u << 4;
+    }
+
+    struct ShaderFeatureInfo
+    {
+        std::uint32_t bit;
+        const char* define;
+
+        /// @brief Material texture value which enables the feature
+        const char* textureName;
+    };
+
+    static constexpr ShaderFeatureInfo shaderFeatures[] = {
+        {ShaderFeature::baseColorMap, "HAS_BASE_COLOR_MAP", "baseColor"},
+        {ShaderFeature::normalMap, "HAS_NORMAL_MAP", "normalMap"},
+        {ShaderFeature::roughnessMap, "HAS_ROUGHNESS_MAP", "roughnessMap"},
+        {ShaderFeature::metallicMap, "HAS_METALLIC_MAP", "metallicMap"},
+        {ShaderFeature::roughnessMetallicMap, "HAS_ROUGHNESS_METALLIC_MAP", "roughnessMetallicMap"},
+    };
+
+    /// @brief Lines with "#define" for every feature in the mask
+    inline std::string shaderFeatureDefines(std::uint32_t featureMask)
+    {
+        std::string defines;
+
+        for (const ShaderFeatureInfo& feature: shaderFeatures)
+        {
+            if ((featureMask & feature.bit) != 0)
+            {
+                defines += "#define ";
+                defines += feature.define;
+                defines += '\n';
+            }
+        }
+
+        return defines;
+    }
+}
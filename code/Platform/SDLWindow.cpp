@@ -1,6 +1,6 @@
 ﻿#include "SDLWindow.h"
 
-#include <glad/glad.h>
+#include <Graphics/OpenGLBase.h>
 
 namespace BGLRenderer
 {
@@ -79,6 +79,11 @@ namespace BGLRenderer
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
 
+        if constexpr (Debug::openGLDebugOutput)
+        {
+            SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+        }
+
         SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
         SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
 
@@ -94,6 +99,7 @@ namespace BGLRenderer
         _glContext = SDL_GL_CreateContext(_sdlWindow);
 
         gladLoadGLLoader(SDL_GL_GetProcAddress);
+        installOpenGLDebugOutput();
     }
 
     void SDLWindow::destroyWindow()
@@ -34,7 +34,13 @@ namespace BGLRenderer
 
         auto pbrProgram = _engine->assets()->getProgram("shaders/gbuffer_default");
 
-        std::shared_ptr<OpenGLRenderObject> sphereRenderObject = _engine->assets()->getModel("sphere_hres.gltf", pbrProgram);
+        // scene objects are culled by bounds computed during loading, nothing reads their geometry on CPU
+        ModelLoadOptions sceneModelOptions{};
+        sceneModelOptions.compressVertices = true;
+        sceneModelOptions.retention = MeshDataRetention::discard;
+
+        std::shared_ptr<OpenGLRenderObject> sphereRenderObject = _engine->assets()->getModel("sphere_hres.gltf", pbrProgram,
+                                                                                             sceneModelOptions);
 
 #if 1
         auto pbrMaterial = std::make_shared<OpenGLMaterial>("PBR", MaterialType::opaque, MaterialTag::pbr, pbrProgram);
@@ -55,7 +61,8 @@ namespace BGLRenderer
                 sphere->transform().scale = {0.5, 0.5, 0.5};
                 sphere->setSubmeshes(sphereRenderObject->submeshes());
 
-                std::shared_ptr<OpenGLMaterial> sphereMaterial = std::make_shared<OpenGLMaterial>(*pbrMaterial);
+                std::shared_ptr<OpenGLMaterial> sphereMaterial = std::make_shared<OpenGLMaterial>(
+                    std::format("PBR {}x{}", x, y), pbrMaterial);
                 sphereMaterial->setFloat("roughness", static_cast<float>(x) / static_cast<float>(numX));
                 sphereMaterial->setFloat("metallic", static_cast<float>(y) / static_cast<float>(numY));
 
@@ -65,7 +72,8 @@ namespace BGLRenderer
 #endif
 
         std::shared_ptr<OpenGLMaterial> monkeyMaterial = _engine->assets()->getMaterial("basic_blue.json");
-        std::shared_ptr<OpenGLRenderObject> monkeyRenderObject = _engine->assets()->getModel("monkey.gltf", pbrProgram);
+        std::shared_ptr<OpenGLRenderObject> monkeyRenderObject = _engine->assets()->getModel("monkey.gltf", pbrProgram,
+                                                                                             sceneModelOptions);
 
         _monkey = _scene->createSceneObject("Monkey");
         _monkey->transform().position = {0, 5, 0};
@@ -161,21 +169,27 @@ namespace BGLRenderer
         _quad->transform().rotation = glm::rotate(glm::mat4(1.0f), _quadRot, glm::vec3(0, 1, 0));
         _testSphere->transform().rotation = glm::rotate(glm::mat4(1.0f), t * glm::pi<float>() * 2.0f,
                                                         glm::vec3(0, 1, 0));
+
+        _scene->updateWorldMatrices(_engine->jobs().get());
     }
 
     void ApplicationSandbox::onRender(const std::shared_ptr<OpenGLRenderer>& renderer)
     {
         renderer->setCamera(_camera);
 
-        for (const auto& sceneObject: _scene->objects())
+        const std::vector<glm::mat4>& worldMatrices = _scene->worldMatrices();
+        renderer->submitParallel(_scene->size(), [&](std::size_t begin, std::size_t end, DrawList& drawList)
         {
-            glm::mat4x4 model = sceneObject->transform().modelMatrix();
-
-            for (const auto& submesh: sceneObject->submeshes())
+            for (std::size_t i = begin; i < end; ++i)
             {
-                renderer->submit(submesh.material, submesh.mesh, model);
+                const glm::mat4x4& model = worldMatrices[i];
+
+                for (const auto& submesh: _scene->submeshes(i))
+                {
+                    drawList.submit(submesh.material, submesh.mesh, model);
+                }
             }
-        }
+        });
 
         renderer->gizmos().coordinateSystem(_monkey->transform().position, _monkey->transform().modelMatrix());
         renderer->gizmos().wireCube(_monkey->transform().position, {1, 1, 1});
@@ -0,0 +1,227 @@
+﻿#include <Foundation/JobSystem.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace BGLRenderer;
+
+// assert() is compiled out of release builds, tests have to fail in every configuration
+#define CHECK(condition) checkCondition(condition, #condition, __FILE__, __LINE__)
+
+static int failedChecks = 0;
+
+static void checkCondition(bool condition, const char* text, const char* file, int line)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+        failedChecks++;
+    }
+}
+
+/// @brief Spins until predicate holds or timeout passes, tests never hang on a broken scheduler
+template <class TPredicate>
+static bool waitUntil(const TPredicate& predicate, std::chrono::milliseconds timeout = std::chrono::seconds(10))
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!predicate())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+
+        std::this_thread::yield();
+    }
+
+    return true;
+}
+
+static void counterCompletion(JobSystem& jobSystem)
+{
+    constexpr int jobCount = 1000;
+
+    std::atomic<int> executed = 0;
+    JobCounter counter;
+
+    for (int i = 0; i < jobCount; ++i)
+    {
+        jobSystem.run([&executed] { executed.fetch_add(1, std::memory_order_relaxed); }, counter);
+    }
+
+    jobSystem.wait(counter);
+
+    CHECK(counter.done());
+    CHECK(executed.load() == jobCount);
+
+    // counter can be reused once it's done
+    jobSystem.run([&executed] { executed.fetch_add(1, std::memory_order_relaxed); }, counter);
+    jobSystem.wait(counter);
+
+    CHECK(counter.done());
+    CHECK(executed.load() == jobCount + 1);
+}
+
+static void parentWaitsForChildren(JobSystem& jobSystem)
+{
+    constexpr int parentJobs = 16;
+    constexpr int childJobsPerParent = 32;
+
+    std::atomic<int> executedChildren = 0;
+    JobCounter parent;
+
+    // child counters have to outlive their jobs, which finish after the parent jobs that spawned them
+    std::vector<std::unique_ptr<JobCounter>> children;
+    for (int i = 0; i < parentJobs; ++i)
+    {
+        children.push_back(std::make_unique<JobCounter>(parent));
+    }
+
+    for (int i = 0; i < parentJobs; ++i)
+    {
+        JobCounter& child = *children[i];
+        jobSystem.run([&jobSystem, &child, &executedChildren]
+        {
+            for (int j = 0; j < childJobsPerParent; ++j)
+            {
+                jobSystem.run([&executedChildren]
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                    executedChildren.fetch_add(1, std::memory_order_relaxed);
+                }, child);
+            }
+        }, parent);
+    }
+
+    jobSystem.wait(parent);
+
+    CHECK(executedChildren.load() == parentJobs * childJobsPerParent);
+    for (const std::unique_ptr<JobCounter>& child: children)
+    {
+        CHECK(child->done());
+    }
+}
+
+static bool coversEveryIndexOnce(JobSystem& jobSystem, std::size_t count, std::size_t grainSize)
+{
+    std::vector<std::atomic<int>> hits(count);
+    std::atomic<bool> chunksValid = true;
+    std::atomic<bool> firstChunkOnCaller = false;
+    const std::thread::id caller = std::this_thread::get_id();
+    const std::size_t chunkSize = std::max<std::size_t>(grainSize, 1);
+
+    jobSystem.parallelFor(count, grainSize, [&](std::size_t begin, std::size_t end)
+    {
+        if (begin >= end || end > count || end - begin > chunkSize || begin % chunkSize != 0)
+        {
+            chunksValid = false;
+        }
+
+        if (begin == 0 && std::this_thread::get_id() == caller)
+        {
+            firstChunkOnCaller = true;
+        }
+
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            hits[i].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    bool everyIndexOnce = true;
+    for (const std::atomic<int>& hit: hits)
+    {
+        everyIndexOnce = everyIndexOnce && hit.load() == 1;
+    }
+
+    return everyIndexOnce && chunksValid && (count == 0 || firstChunkOnCaller);
+}
+
+static void parallelForCoverage(JobSystem& jobSystem)
+{
+    constexpr std::size_t grainSize = 64;
+    const std::size_t counts[] = {0, 1, grainSize - 1, grainSize, grainSize + 1, grainSize * 7, grainSize * 7 + 13};
+
+    for (std::size_t count: counts)
+    {
+        CHECK(coversEveryIndexOnce(jobSystem, count, grainSize));
+    }
+
+    // grain size 0 is treated as 1
+    CHECK(coversEveryIndexOnce(jobSystem, 100, 0));
+
+    // workers calling parallelFor run the first chunk themselves and push the rest into their own queue
+    JobCounter counter;
+    std::atomic<bool> coveredFromWorker = false;
+    jobSystem.run([&]
+    {
+        coveredFromWorker = coversEveryIndexOnce(jobSystem, grainSize * 5 + 3, grainSize);
+    }, counter);
+
+    jobSystem.wait(counter);
+    CHECK(coveredFromWorker.load());
+}
+
+static void blockedWorkerIsRobbed(JobSystem& jobSystem)
+{
+    constexpr int jobCount = 64;
+
+    JobCounter outer;
+    JobCounter stolen;
+    std::atomic<int> executed = 0;
+    std::atomic<bool> stolenWhileBlocked = false;
+    std::atomic<bool> executedByBlockedWorker = false;
+
+    // the job pushes everything into its worker's own deque and then blocks without executing jobs,
+    // so only other workers can finish them
+    jobSystem.run([&]
+    {
+        const std::thread::id blockedWorker = std::this_thread::get_id();
+
+        for (int i = 0; i < jobCount; ++i)
+        {
+            jobSystem.run([&executed, &executedByBlockedWorker, blockedWorker]
+            {
+                if (std::this_thread::get_id() == blockedWorker)
+                {
+                    executedByBlockedWorker = true;
+                }
+
+                executed.fetch_add(1, std::memory_order_relaxed);
+            }, stolen);
+        }
+
+        stolenWhileBlocked = waitUntil([&stolen] { return stolen.done(); }) && !executedByBlockedWorker;
+    }, outer);
+
+    // main thread doesn't call wait(), it would execute the jobs itself
+    CHECK(waitUntil([&outer] { return outer.done(); }));
+
+    CHECK(stolenWhileBlocked.load());
+    CHECK(executed.load() == jobCount);
+}
+
+int main()
+{
+    // stealing requires at least one worker besides the blocked one
+    JobSystem jobSystem(4);
+
+    counterCompletion(jobSystem);
+    parentWaitsForChildren(jobSystem);
+    parallelForCoverage(jobSystem);
+    blockedWorkerIsRobbed(jobSystem);
+
+    if (failedChecks > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", failedChecks);
+        return 1;
+    }
+
+    std::printf("All job system tests passed\n");
+    return 0;
+}
@@ -1,7 +1,92 @@
 ﻿#include "Scene.h"
 
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BGL_SCENE_TRANSFORMS_SIMD 1
+#include <immintrin.h>
+#else
+#define BGL_SCENE_TRANSFORMS_SIMD 0
+#endif
+
 namespace BGLRenderer
 {
+    /// @brief Same as MathUtils::modelMatrix (translation * scale * rotation) for 4 objects per iteration,
+    /// returns index where SIMD loop stopped
+    static std::size_t computeWorldMatricesSIMD(const glm::vec3* positions, const glm::quat* rotations,
+                                                const glm::vec3* scales, glm::mat4* worldMatrices, std::size_t count)
+    {
+        std::size_t index = 0;
+
+#if BGL_SCENE_TRANSFORMS_SIMD
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+
+        for (; index + 4 <= count; index += 4)
+        {
+            const glm::quat* q = rotations + index;
+            const glm::vec3* s = scales + index;
+            const glm::vec3* p = positions + index;
+
+            const __m128 qx = _mm_setr_ps(q[0].x, q[1].x, q[2].x, q[3].x);
+            const __m128 qy = _mm_setr_ps(q[0].y, q[1].y, q[2].y, q[3].y);
+            const __m128 qz = _mm_setr_ps(q[0].z, q[1].z, q[2].z, q[3].z);
+            const __m128 qw = _mm_setr_ps(q[0].w, q[1].w, q[2].w, q[3].w);
+
+            const __m128 sx = _mm_setr_ps(s[0].x, s[1].x, s[2].x, s[3].x);
+            const __m128 sy = _mm_setr_ps(s[0].y, s[1].y, s[2].y, s[3].y);
+            const __m128 sz = _mm_setr_ps(s[0].z, s[1].z, s[2].z, s[3].z);
+
+            const __m128 xx = _mm_mul_ps(qx, qx);
+            const __m128 yy = _mm_mul_ps(qy, qy);
+            const __m128 zz = _mm_mul_ps(qz, qz);
+            const __m128 xy = _mm_mul_ps(qx, qy);
+            const __m128 xz = _mm_mul_ps(qx, qz);
+            const __m128 yz = _mm_mul_ps(qy, qz);
+            const __m128 wx = _mm_mul_ps(qw, qx);
+            const __m128 wy = _mm_mul_ps(qw, qy);
+            const __m128 wz = _mm_mul_ps(qw, qz);
+
+            // rotation as in glm::mat3_cast, m[column][row], scale multiplies rows because it's applied after rotation
+            __m128 columns[4][4];
+            columns[0][0] = _mm_mul_ps(sx, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))));
+            columns[0][1] = _mm_mul_ps(sy, _mm_mul_ps(two, _mm_add_ps(xy, wz)));
+            columns[0][2] = _mm_mul_ps(sz, _mm_mul_ps(two, _mm_sub_ps(xz, wy)));
+            columns[0][3] = zero;
+
+            columns[1][0] = _mm_mul_ps(sx, _mm_mul_ps(two, _mm_sub_ps(xy, wz)));
+            columns[1][1] = _mm_mul_ps(sy, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))));
+            columns[1][2] = _mm_mul_ps(sz, _mm_mul_ps(two, _mm_add_ps(yz, wx)));
+            columns[1][3] = zero;
+
+            columns[2][0] = _mm_mul_ps(sx, _mm_mul_ps(two, _mm_add_ps(xz, wy)));
+            columns[2][1] = _mm_mul_ps(sy, _mm_mul_ps(two, _mm_sub_ps(yz, wx)));
+            columns[2][2] = _mm_mul_ps(sz, _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))));
+            columns[2][3] = zero;
+
+            columns[3][0] = _mm_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x);
+            columns[3][1] = _mm_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y);
+            columns[3][2] = _mm_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z);
+            columns[3][3] = one;
+
+            // lanes hold objects, transposing turns every column into 4 consecutive floats of one matrix
+            for (int column = 0; column < 4; ++column)
+            {
+                __m128* rows = columns[column];
+                _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+
+                for (int lane = 0; lane < 4; ++lane)
+                {
+                    _mm_storeu_ps(glm::value_ptr(worldMatrices[index + lane][column]), rows[lane]);
+                }
+            }
+        }
+#endif
+
+        return index;
+    }
+
     Scene::Scene(const std::string& name) :
         _name(name)
     {
@@ -11,16 +96,200 @@ namespace BGLRenderer
     {
     }
 
+    SceneEntity Scene::createEntity(const std::string& name)
+    {
+        std::uint32_t entityIndex;
+        if (!_freeEntities.empty())
+        {
+            entityIndex = _freeEntities.back();
+            _freeEntities.pop_back();
+        }
+        else
+        {
+            entityIndex = static_cast<std::uint32_t>(_entityDenseIndices.size());
+            _entityDenseIndices.push_back(invalidIndex);
+            _entityGenerations.push_back(0);
+        }
+
+        const SceneEntity entity{entityIndex, _entityGenerations[entityIndex]};
+        _entityDenseIndices[entityIndex] = static_cast<std::uint32_t>(_entities.size());
+
+        _positions.emplace_back(0.0f, 0.0f, 0.0f);
+        _rotations.push_back(glm::identity<glm::quat>());
+        _scales.emplace_back(1.0f, 1.0f, 1.0f);
+        _worldMatrices.emplace_back(1.0f);
+        _submeshRanges.push_back({});
+        _entities.push_back(entity);
+        _names.push_back(name);
+
+        return entity;
+    }
+
+    void Scene::destroyEntity(SceneEntity entity)
+    {
+        const std::uint32_t removedIndex = denseIndexOrInvalid(entity);
+        if (removedIndex == invalidIndex)
+        {
+            return;
+        }
+
+        releaseSubmeshes(removedIndex);
+
+        // last object takes the freed place, so arrays stay dense
+        const std::uint32_t lastIndex = static_cast<std::uint32_t>(_entities.size() - 1);
+        if (removedIndex != lastIndex)
+        {
+            _positions[removedIndex] = _positions[lastIndex];
+            _rotations[removedIndex] = _rotations[lastIndex];
+            _scales[removedIndex] = _scales[lastIndex];
+            _worldMatrices[removedIndex] = _worldMatrices[lastIndex];
+            _submeshRanges[removedIndex] = _submeshRanges[lastIndex];
+            _entities[removedIndex] = _entities[lastIndex];
+            _names[removedIndex] = std::move(_names[lastIndex]);
+
+            _entityDenseIndices[_entities[removedIndex].index] = removedIndex;
+        }
+
+        _positions.pop_back();
+        _rotations.pop_back();
+        _scales.pop_back();
+        _worldMatrices.pop_back();
+        _submeshRanges.pop_back();
+        _entities.pop_back();
+        _names.pop_back();
+
+        _entityDenseIndices[entity.index] = invalidIndex;
+        _entityGenerations[entity.index]++;
+        _freeEntities.push_back(entity.index);
+    }
+
     std::shared_ptr<SceneObject> Scene::createSceneObject(const std::string& name)
     {
-        std::shared_ptr<SceneObject> object = std::make_shared<SceneObject>(name);
-        _sceneObjects.push_back(object);
+        return std::make_shared<SceneObject>(this, createEntity(name));
+    }
 
-        return object;
+    std::shared_ptr<SceneObject> Scene::sceneObject(SceneEntity entity)
+    {
+        return alive(entity) ? std::make_shared<SceneObject>(this, entity) : nullptr;
     }
 
     void Scene::clear()
     {
-        _sceneObjects.clear();
+        for (const SceneEntity& entity: _entities)
+        {
+            _entityDenseIndices[entity.index] = invalidIndex;
+            _entityGenerations[entity.index]++;
+            _freeEntities.push_back(entity.index);
+        }
+
+        _positions.clear();
+        _rotations.clear();
+        _scales.clear();
+        _worldMatrices.clear();
+        _submeshRanges.clear();
+        _entities.clear();
+        _names.clear();
+
+        _submeshPool.clear();
+        _unusedSubmeshes = 0;
+    }
+
+    void Scene::updateWorldMatrices(JobSystem* jobSystem)
+    {
+        auto computeRange = [this](std::size_t begin, std::size_t end)
+        {
+            const std::size_t processed = begin + computeWorldMatricesSIMD(
+                _positions.data() + begin, _rotations.data() + begin, _scales.data() + begin,
+                _worldMatrices.data() + begin, end - begin);
+
+            for (std::size_t i = processed; i < end; ++i)
+            {
+                _worldMatrices[i] = MathUtils::modelMatrix(_positions[i], _scales[i], _rotations[i]);
+            }
+        };
+
+        if (jobSystem == nullptr || size() <= worldMatrixChunkSize)
+        {
+            computeRange(0, size());
+            return;
+        }
+
+        // chunks write disjoint parts of the matrix array
+        jobSystem->parallelFor(size(), worldMatrixChunkSize, computeRange);
+    }
+
+    TransformRef Scene::transform(SceneEntity entity)
+    {
+        const std::uint32_t index = denseIndex(entity);
+        return {_positions[index], _scales[index], _rotations[index]};
+    }
+
+    void Scene::setSubmeshes(SceneEntity entity, const std::vector<RenderObjectSubmesh>& submeshes)
+    {
+        const std::uint32_t index = denseIndex(entity);
+        SceneSubmeshRange& range = _submeshRanges[index];
+
+        // same amount is overwritten in place, otherwise the object moves to the end of the pool
+        if (range.count == submeshes.size())
+        {
+            std::copy(submeshes.begin(), submeshes.end(), _submeshPool.begin() + range.first);
+            return;
+        }
+
+        releaseSubmeshes(index);
+
+        range.first = static_cast<std::uint32_t>(_submeshPool.size());
+        range.count = static_cast<std::uint32_t>(submeshes.size());
+        _submeshPool.insert(_submeshPool.end(), submeshes.begin(), submeshes.end());
+
+        if (_unusedSubmeshes > _submeshPool.size() / 2)
+        {
+            compactSubmeshPool();
+        }
+    }
+
+    const std::string& Scene::name(SceneEntity entity) const
+    {
+        return _names[denseIndex(entity)];
+    }
+
+    void Scene::setName(SceneEntity entity, const std::string& name)
+    {
+        _names[denseIndex(entity)] = name;
+    }
+
+    void Scene::releaseSubmeshes(std::uint32_t denseIndex)
+    {
+        SceneSubmeshRange& range = _submeshRanges[denseIndex];
+
+        // resources are released right away, the slots are reclaimed by compaction
+        for (std::uint32_t i = range.first; i < range.first + range.count; ++i)
+        {
+            _submeshPool[i] = {};
+        }
+
+        _unusedSubmeshes += range.count;
+        range = {};
+    }
+
+    void Scene::compactSubmeshPool()
+    {
+        // objects are visited in dense order, so submeshes end up in iteration order too
+        std::vector<RenderObjectSubmesh> pool;
+        pool.reserve(_submeshPool.size() - _unusedSubmeshes);
+
+        for (SceneSubmeshRange& range: _submeshRanges)
+        {
+            const std::uint32_t first = static_cast<std::uint32_t>(pool.size());
+            for (std::uint32_t i = range.first; i < range.first + range.count; ++i)
+            {
+                pool.push_back(std::move(_submeshPool[i]));
+            }
+
+            range.first = first;
+        }
+
+        _submeshPool.swap(pool);
+        _unusedSubmeshes = 0;
     }
 }
@@ -1,31 +1,123 @@
 ﻿#pragma once
 
+#include <cstdint>
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
 #include <Foundation/Base.h>
+#include <Foundation/JobSystem.h>
 #include "SceneObject.h"
 
 namespace BGLRenderer
 {
+    struct SceneSubmeshRange
+    {
+        std::uint32_t first = 0;
+        std::uint32_t count = 0;
+    };
+
+    /// @brief Scene objects stored as structure of arrays. Every array is dense and indexed the same way,
+    /// destroying an object moves the last one into its place, so code that keeps objects uses SceneEntity
+    /// (or SceneObject facade) and only iteration works with dense indices. Submeshes of all objects share one pool
     class Scene
     {
     public:
         Scene(const std::string& name);
         ~Scene();
 
+        /// @brief Objects whose world matrices are computed by one job of updateWorldMatrices, multiple of SIMD width
+        static constexpr std::size_t worldMatrixChunkSize = 4096;
+
+        SceneEntity createEntity(const std::string& name);
+        void destroyEntity(SceneEntity entity);
+        inline bool alive(SceneEntity entity) const { return denseIndexOrInvalid(entity) != invalidIndex; }
+
+        /// @brief Creates entity together with facade, which is handy when the object is set up in place
         std::shared_ptr<SceneObject> createSceneObject(const std::string& name);
-        
+        std::shared_ptr<SceneObject> sceneObject(SceneEntity entity);
+
         void clear();
 
+        /// @brief Recomputes world matrix of every object from position, rotation and scale, 4 objects at once
+        /// when SIMD is available. Chunks are spread across the job system when it's given
+        void updateWorldMatrices(JobSystem* jobSystem = nullptr);
+
+        TransformRef transform(SceneEntity entity);
+
+        void setSubmeshes(SceneEntity entity, const std::vector<RenderObjectSubmesh>& submeshes);
+
+        const std::string& name(SceneEntity entity) const;
+        void setName(SceneEntity entity, const std::string& name);
+
+        inline std::uint32_t denseIndex(SceneEntity entity) const
+        {
+            const std::uint32_t index = denseIndexOrInvalid(entity);
+            ASSERT(index != invalidIndex, "Scene entity was destroyed");
+            return index;
+        }
+
+        // dense arrays, indexed by [0, size())
+        inline std::size_t size() const { return _entities.size(); }
+        inline SceneEntity entity(std::size_t index) const { return _entities[index]; }
+        inline const std::vector<glm::vec3>& positions() const { return _positions; }
+        inline const std::vector<glm::quat>& rotations() const { return _rotations; }
+        inline const std::vector<glm::vec3>& scales() const { return _scales; }
+
+        /// @brief Valid after updateWorldMatrices, objects created since then have identity matrix
+        inline const std::vector<glm::mat4>& worldMatrices() const { return _worldMatrices; }
+
+        inline std::span<const RenderObjectSubmesh> submeshes(std::size_t index) const
+        {
+            const SceneSubmeshRange& range = _submeshRanges[index];
+            return {_submeshPool.data() + range.first, range.count};
+        }
+
+        inline std::span<RenderObjectSubmesh> submeshes(std::size_t index)
+        {
+            const SceneSubmeshRange& range = _submeshRanges[index];
+            return {_submeshPool.data() + range.first, range.count};
+        }
+
         inline const std::string& name() const { return _name; }
-        inline const std::vector<std::shared_ptr<SceneObject>>& objects() const { return _sceneObjects; }
 
     private:
+        static constexpr std::uint32_t invalidIndex = SceneEntity::invalidIndex;
+
         std::string _name;
 
-        // HDR Handle
-        std::vector<std::shared_ptr<SceneObject>> _sceneObjects;
+        // entity index -> dense index, generation is bumped when entity is destroyed
+        std::vector<std::uint32_t> _entityDenseIndices;
+        std::vector<std::uint32_t> _entityGenerations;
+        std::vector<std::uint32_t> _freeEntities;
+
+        // hot data touched every frame
+        std::vector<glm::vec3> _positions;
+        std::vector<glm::quat> _rotations;
+        std::vector<glm::vec3> _scales;
+        std::vector<glm::mat4> _worldMatrices;
+        std::vector<SceneSubmeshRange> _submeshRanges;
+
+        // cold data
+        std::vector<SceneEntity> _entities;
+        std::vector<std::string> _names;
+
+        std::vector<RenderObjectSubmesh> _submeshPool;
+        // pool slots left by objects whose submeshes were replaced or which were destroyed
+        std::size_t _unusedSubmeshes = 0;
+
+        inline std::uint32_t denseIndexOrInvalid(SceneEntity entity) const
+        {
+            if (entity.index >= _entityDenseIndices.size() || _entityGenerations[entity.index] != entity.generation)
+            {
+                return invalidIndex;
+            }
+
+            return _entityDenseIndices[entity.index];
+        }
+
+        void releaseSubmeshes(std::uint32_t denseIndex);
+        void compactSubmeshPool();
     };
 }
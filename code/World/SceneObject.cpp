@@ -1,9 +1,13 @@
 ﻿#include "SceneObject.h"
+#include "Scene.h"
+
+#include <utility>
 
 namespace BGLRenderer
 {
-    SceneObject::SceneObject(const std::string& name) :
-        _name(name)
+    SceneObject::SceneObject(Scene* scene, SceneEntity entity) :
+        _scene(scene),
+        _entity(entity)
     {
     }
 
@@ -13,6 +17,41 @@ namespace BGLRenderer
 
     void SceneObject::setSubmeshes(const std::vector<RenderObjectSubmesh>& submeshes)
     {
-        _submeshes = submeshes;
+        _scene->setSubmeshes(_entity, submeshes);
+    }
+
+    std::span<const RenderObjectSubmesh> SceneObject::submeshes() const
+    {
+        return std::as_const(*_scene).submeshes(_scene->denseIndex(_entity));
+    }
+
+    std::span<RenderObjectSubmesh> SceneObject::submeshes()
+    {
+        return _scene->submeshes(_scene->denseIndex(_entity));
+    }
+
+    TransformRef SceneObject::transform()
+    {
+        return _scene->transform(_entity);
+    }
+
+    Transform SceneObject::transform() const
+    {
+        return _scene->transform(_entity);
+    }
+
+    const std::string& SceneObject::name() const
+    {
+        return _scene->name(_entity);
+    }
+
+    void SceneObject::setName(const std::string& name)
+    {
+        _scene->setName(_entity, name);
+    }
+
+    bool SceneObject::valid() const
+    {
+        return _scene != nullptr && _scene->alive(_entity);
     }
 }
@@ -1,6 +1,9 @@
 ﻿#pragma once
 
 #include "../Foundation/Base.h"
+#include <Foundation/HandlePool.h>
+
+#include <span>
 #include <string>
 
 #include "Transform.h"
@@ -8,26 +11,39 @@
 
 namespace BGLRenderer
 {
+    class Scene;
+
+    /// @brief Tag of ids issued by Scene, they index its dense arrays and never resolve through HandlePool
+    struct SceneEntityTag;
+
+    /// @brief Stable id of scene object, stays the same when dense arrays of the scene are reordered
+    using SceneEntity = Handle<SceneEntityTag>;
+
+    /// @brief Facade over one entity of Scene, data lives in the scene arrays.
+    /// Has to be dropped before the scene, methods can't be used after the entity is destroyed
     class SceneObject
     {
     public:
-        SceneObject(const std::string& name);
+        SceneObject(Scene* scene, SceneEntity entity);
         ~SceneObject();
 
         void setSubmeshes(const std::vector<RenderObjectSubmesh>& submeshes);
-        inline const std::vector<RenderObjectSubmesh>& submeshes() const { return _submeshes; }
-        inline std::vector<RenderObjectSubmesh>& submeshes() { return _submeshes; }
+        std::span<const RenderObjectSubmesh> submeshes() const;
+        std::span<RenderObjectSubmesh> submeshes();
+
+        TransformRef transform();
+        Transform transform() const;
+
+        const std::string& name() const;
+        void setName(const std::string& name);
 
-        inline Transform& transform() { return _transform; }
-        inline const Transform& transform() const { return _transform; }
+        bool valid() const;
 
-        inline const std::string& name() const { return _name; }
-        inline void setName(const std::string& name) { _name = name; }
+        inline SceneEntity entity() const { return _entity; }
+        inline Scene* scene() const { return _scene; }
 
     private:
-        std::string _name;
-        Transform _transform{};
-        
-        std::vector<RenderObjectSubmesh> _submeshes;
+        Scene* _scene;
+        SceneEntity _entity;
     };
 }
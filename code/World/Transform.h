@@ -15,4 +15,20 @@ namespace BGLRenderer
             return MathUtils::modelMatrix(position, scale, rotation);
         }
     };
+
+    /// @brief Transform whose components live in separate arrays (e.g. Scene storage),
+    /// references stay valid only until the storage grows, so don't keep it around
+    struct TransformRef
+    {
+        glm::vec3& position;
+        glm::vec3& scale;
+        glm::quat& rotation;
+
+        inline glm::mat4x4 modelMatrix() const
+        {
+            return MathUtils::modelMatrix(position, scale, rotation);
+        }
+
+        inline operator Transform() const { return {position, scale, rotation}; }
+    };
 }